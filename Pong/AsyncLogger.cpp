@@ -0,0 +1,182 @@
+#include "AsyncLogger.h"
+#include <chrono>
+
+namespace
+{
+	const char* levelName(LogLevel level)
+	{
+		switch (level)
+		{
+		case LogLevel::Debug: return "DEBUG";
+		case LogLevel::Info: return "INFO ";
+		case LogLevel::Warning: return "WARN ";
+		case LogLevel::Error: return "ERROR";
+		default: return "     ";
+		}
+	}
+
+	// How long the drain thread sleeps when the ring is empty
+	const auto IdleSleep = std::chrono::milliseconds(2);
+
+	const std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+}
+
+bool LogRateLimiter::allow(uint32_t nowMs, uint32_t& outSuppressed)
+{
+	outSuppressed = 0;
+
+	// Open a new window once the interval has passed (one caller wins the reset)
+	uint32_t windowStart = m_windowStartMs.load(std::memory_order_relaxed);
+	if (nowMs - windowStart >= m_intervalMs &&
+		m_windowStartMs.compare_exchange_strong(windowStart, nowMs, std::memory_order_relaxed))
+	{
+		m_count.store(0, std::memory_order_relaxed);
+	}
+
+	if (m_count.fetch_add(1, std::memory_order_relaxed) >= m_burst)
+	{
+		m_suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	outSuppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+	return true;
+}
+
+AsyncLogger& AsyncLogger::instance()
+{
+	static AsyncLogger logger;
+	return logger;
+}
+
+AsyncLogger::AsyncLogger()
+#ifdef _DEBUG
+	: m_level(LogLevel::Debug)
+#else
+	: m_level(LogLevel::Info)
+#endif
+{
+	for (size_t i = 0; i < Capacity; ++i)
+		m_records[i].sequence.store(i, std::memory_order_relaxed);
+
+	m_thread = std::thread(&AsyncLogger::drainLoop, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+	m_running = false;
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+uint32_t AsyncLogger::nowMs() const
+{
+	auto elapsed = std::chrono::steady_clock::now() - StartTime;
+	return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+void AsyncLogger::write(LogLevel level, uint32_t suppressed, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	writeV(level, suppressed, format, args);
+	va_end(args);
+}
+
+void AsyncLogger::writeV(LogLevel level, uint32_t suppressed, const char* format, va_list args)
+{
+	// Claim a free slot (bounded MPMC queue, D. Vyukov)
+	size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+	Record* record = nullptr;
+	while (true)
+	{
+		record = &m_records[pos & (Capacity - 1)];
+		size_t sequence = record->sequence.load(std::memory_order_acquire);
+		intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+		if (difference == 0)
+		{
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+		{
+			// Ring full: the drain thread is behind, so lose this message rather than wait
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else
+		{
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Format straight into the slot
+	record->timeMs = nowMs();
+	record->level = level;
+	record->suppressed = suppressed;
+	std::vsnprintf(record->text, MaxMessage, format, args);
+
+	record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+size_t AsyncLogger::drain()
+{
+	size_t count = 0;
+	while (true)
+	{
+		Record& record = m_records[m_dequeuePos & (Capacity - 1)];
+		if (record.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1)
+			break;
+
+		if (record.suppressed > 0)
+		{
+			std::fprintf(m_out, "[%8u ms] %s %s (%u similar suppressed)\n",
+				record.timeMs, levelName(record.level), record.text, record.suppressed);
+		}
+		else
+		{
+			std::fprintf(m_out, "[%8u ms] %s %s\n", record.timeMs, levelName(record.level), record.text);
+		}
+
+		// Hand the slot back to the producers for the next lap of the ring
+		record.sequence.store(m_dequeuePos + Capacity, std::memory_order_release);
+		m_dequeuePos++;
+		count++;
+	}
+
+	uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+	if (dropped != m_droppedReported)
+	{
+		std::fprintf(m_out, "[%8u ms] %s AsyncLogger: %llu message(s) dropped, ring full\n", nowMs(),
+			levelName(LogLevel::Warning), static_cast<unsigned long long>(dropped - m_droppedReported));
+		m_droppedReported = dropped;
+		count++;
+	}
+
+	if (count > 0)
+	{
+		std::fflush(m_out);
+		m_drainedPos.store(m_dequeuePos, std::memory_order_release);
+	}
+	return count;
+}
+
+void AsyncLogger::drainLoop()
+{
+	while (m_running.load(std::memory_order_relaxed))
+	{
+		if (drain() == 0)
+			std::this_thread::sleep_for(IdleSleep);
+	}
+
+	// Whatever was queued before shutdown still gets out
+	drain();
+}
+
+void AsyncLogger::flush()
+{
+	// Every slot claimed before now has been written once the drain passes it
+	size_t target = m_enqueuePos.load(std::memory_order_acquire);
+	while (m_running.load(std::memory_order_relaxed) && m_drainedPos.load(std::memory_order_acquire) < target)
+		std::this_thread::yield();
+}
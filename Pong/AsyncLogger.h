@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+// Lets GCC/Clang check LOG_* arguments against the format string
+#if defined(__GNUC__)
+#define PONG_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#define PONG_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
+enum class LogLevel : uint8_t {
+	Debug = 0,
+	Info = 1,
+	Warning = 2,
+	Error = 3,
+	Off = 4
+};
+
+/// <summary>
+/// @brief Per-call-site rate limit: at most burst messages per intervalMs window.
+///
+/// Each LOG_* macro keeps one of these as a function-local static, so a message printed from
+///  a per-frame or per-packet path can't flood the console. Messages over the limit are
+///  counted, and the count is reported with the next message that gets through.
+/// </summary>
+class LogRateLimiter
+{
+public:
+	LogRateLimiter(uint32_t intervalMs, uint32_t burst) : m_intervalMs(intervalMs), m_burst(burst) {}
+
+	/// <summary>
+	/// @brief True if the message may be logged; outSuppressed is how many were dropped since the last one.
+	/// </summary>
+	bool allow(uint32_t nowMs, uint32_t& outSuppressed);
+
+private:
+	const uint32_t m_intervalMs;
+	const uint32_t m_burst;
+	std::atomic<uint32_t> m_windowStartMs{ 0 };
+	std::atomic<uint32_t> m_count{ 0 };
+	std::atomic<uint32_t> m_suppressed{ 0 };
+};
+
+/// <summary>
+/// @brief Logger whose callers never touch the console.
+///
+/// write() formats straight into a slot of a fixed ring of records (bounded multi-producer
+///  queue, one atomic sequence per slot) and returns; a background thread drains the ring
+///  to stdout and flushes once per batch. Nothing is allocated after construction, and a
+///  full ring drops the message and counts it instead of blocking the game loop.
+/// Use the LOG_* macros rather than calling write() directly, so disabled levels cost one
+///  compare and every call site gets its own rate limit:
+///		LOG_INFO("HostNetworkController: Bound on port %u", port);
+///		LOG_DEBUG_EVERY(1000, "No host found yet.");	// at most once a second
+///		LOG_WARN("Sent to " LOG_IPV4_FMT, LOG_IPV4_ARGS(address));
+/// </summary>
+class AsyncLogger
+{
+public:
+	static const size_t Capacity = 1024;		// records in the ring (power of two)
+	static const size_t MaxMessage = 160;	// longer messages are truncated
+
+	// Default per-call-site limit for the plain LOG_* macros
+	static const uint32_t DefaultIntervalMs = 1000;
+	static const uint32_t DefaultBurst = 10;
+
+	static AsyncLogger& instance();
+
+	~AsyncLogger();
+
+	bool isEnabled(LogLevel level) const { return level >= m_level.load(std::memory_order_relaxed); }
+	void setLevel(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+
+	/// <summary>
+	/// @brief Queues a printf-style message. suppressed is appended as "(N similar suppressed)" when non-zero.
+	/// </summary>
+	void write(LogLevel level, uint32_t suppressed, const char* format, ...) PONG_PRINTF_FORMAT(4, 5);
+	void writeV(LogLevel level, uint32_t suppressed, const char* format, va_list args);
+
+	/// <summary>
+	/// @brief Blocks until everything queued so far has been written.
+	/// </summary>
+	void flush();
+
+	// Milliseconds since the logger started; the timestamp on every line
+	uint32_t nowMs() const;
+
+	// Messages lost because the ring was full
+	uint64_t getDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+	AsyncLogger();
+	AsyncLogger(const AsyncLogger&) = delete;
+	AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+	struct Record {
+		std::atomic<size_t> sequence{ 0 };	// == position when free, position + 1 when filled
+		uint32_t timeMs = 0;
+		uint32_t suppressed = 0;
+		LogLevel level = LogLevel::Info;
+		char text[MaxMessage];
+	};
+
+	void drainLoop();
+	// Writes every filled record to the output; returns how many were written
+	size_t drain();
+
+	Record m_records[Capacity];
+	alignas(64) std::atomic<size_t> m_enqueuePos{ 0 };
+	alignas(64) size_t m_dequeuePos{ 0 };			// drain thread only
+	std::atomic<size_t> m_drainedPos{ 0 };		// m_dequeuePos as of the last flushed batch, for flush()
+
+	std::atomic<LogLevel> m_level;
+	std::atomic<uint64_t> m_dropped{ 0 };
+	uint64_t m_droppedReported{ 0 };
+
+	std::atomic<bool> m_running{ true };
+	std::thread m_thread;
+	FILE* m_out{ stdout };
+};
+
+// Dotted-quad form of an sf::IpAddress without building a std::string
+#define LOG_IPV4_FMT "%u.%u.%u.%u"
+#define LOG_IPV4_ARGS(address) \
+	static_cast<unsigned>(((address).toInteger() >> 24) & 0xFF), static_cast<unsigned>(((address).toInteger() >> 16) & 0xFF), \
+	static_cast<unsigned>(((address).toInteger() >> 8) & 0xFF), static_cast<unsigned>((address).toInteger() & 0xFF)
+
+#define PONG_LOG_LIMITED(level, intervalMs, burst, ...) \
+	do { \
+		AsyncLogger& pongLogger_ = AsyncLogger::instance(); \
+		if (pongLogger_.isEnabled(level)) { \
+			static LogRateLimiter pongLimiter_((intervalMs), (burst)); \
+			uint32_t pongSuppressed_ = 0; \
+			if (pongLimiter_.allow(pongLogger_.nowMs(), pongSuppressed_)) \
+				pongLogger_.write((level), pongSuppressed_, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define PONG_LOG(level, ...) PONG_LOG_LIMITED(level, AsyncLogger::DefaultIntervalMs, AsyncLogger::DefaultBurst, __VA_ARGS__)
+
+#define LOG_DEBUG(...) PONG_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) PONG_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) PONG_LOG(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) PONG_LOG(LogLevel::Error, __VA_ARGS__)
+
+// At most one message per intervalMs from this call site (for per-frame / per-packet paths)
+#define LOG_DEBUG_EVERY(intervalMs, ...) PONG_LOG_LIMITED(LogLevel::Debug, intervalMs, 1, __VA_ARGS__)
+#define LOG_INFO_EVERY(intervalMs, ...) PONG_LOG_LIMITED(LogLevel::Info, intervalMs, 1, __VA_ARGS__)
+#define LOG_WARN_EVERY(intervalMs, ...) PONG_LOG_LIMITED(LogLevel::Warning, intervalMs, 1, __VA_ARGS__)
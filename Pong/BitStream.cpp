@@ -0,0 +1,80 @@
+#include "BitStream.h"
+#include <cmath>
+
+BitWriter::BitWriter(uint8_t* buffer, size_t capacity)
+	: m_buffer(buffer),
+	m_capacity(capacity)
+{
+}
+
+void BitWriter::write(uint32_t value, int bits)
+{
+	if (m_overflow || m_bitPos + bits > m_capacity * 8)
+	{
+		m_overflow = true;
+		return;
+	}
+
+	for (int i = bits - 1; i >= 0; --i)
+	{
+		size_t byteIndex = m_bitPos / 8;
+		int bitIndex = 7 - static_cast<int>(m_bitPos % 8);
+
+		// Start each byte clean so the caller doesn't have to zero the buffer
+		if (bitIndex == 7)
+			m_buffer[byteIndex] = 0;
+
+		if ((value >> i) & 1u)
+			m_buffer[byteIndex] |= static_cast<uint8_t>(1u << bitIndex);
+		m_bitPos++;
+	}
+}
+
+BitReader::BitReader(const uint8_t* buffer, size_t size)
+	: m_buffer(buffer),
+	m_size(size)
+{
+}
+
+uint32_t BitReader::read(int bits)
+{
+	if (m_overflow || m_bitPos + bits > m_size * 8)
+	{
+		m_overflow = true;
+		return 0;
+	}
+
+	uint32_t value = 0;
+	for (int i = 0; i < bits; ++i)
+	{
+		size_t byteIndex = m_bitPos / 8;
+		int bitIndex = 7 - static_cast<int>(m_bitPos % 8);
+		value = (value << 1) | ((m_buffer[byteIndex] >> bitIndex) & 1u);
+		m_bitPos++;
+	}
+	return value;
+}
+
+int QuantizedRange::getBits() const
+{
+	uint32_t steps = static_cast<uint32_t>(std::ceil((max - min) / precision));
+	int bits = 1;
+	while (bits < 32 && (steps >> bits) != 0)
+		bits++;
+	return bits;
+}
+
+uint32_t QuantizedRange::quantize(float value) const
+{
+	if (value < min)
+		value = min;
+	if (value > max)
+		value = max;
+	// In double, so the offset from min is exact and the result is never more than half a step off
+	return static_cast<uint32_t>(std::lround((static_cast<double>(value) - min) / precision));
+}
+
+float QuantizedRange::dequantize(uint32_t quantized) const
+{
+	return min + static_cast<float>(quantized) * precision;
+}
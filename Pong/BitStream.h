@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// @brief Writes values of any bit width into a byte buffer, most significant bit first.
+///
+/// The byte order on the wire is fixed by the writer, not by the host CPU,
+///  so packets decode the same on any platform.
+/// Writing past the capacity sets the overflow flag instead of touching memory.
+/// </summary>
+class BitWriter
+{
+public:
+	BitWriter(uint8_t* buffer, size_t capacity);
+
+	void write(uint32_t value, int bits);
+
+	// Bytes used so far (a partial last byte counts as a whole byte)
+	size_t getBytesWritten() const { return (m_bitPos + 7) / 8; }
+	bool hasOverflowed() const { return m_overflow; }
+
+private:
+	uint8_t* m_buffer;
+	size_t m_capacity;
+	size_t m_bitPos{ 0 };
+	bool m_overflow{ false };
+};
+
+/// <summary>
+/// @brief Reads values written by BitWriter.
+/// Reading past the end returns 0 and sets the overflow flag, so a truncated packet is detectable.
+/// </summary>
+class BitReader
+{
+public:
+	BitReader(const uint8_t* buffer, size_t size);
+
+	uint32_t read(int bits);
+
+	bool hasOverflowed() const { return m_overflow; }
+
+private:
+	const uint8_t* m_buffer;
+	size_t m_size;
+	size_t m_bitPos{ 0 };
+	bool m_overflow{ false };
+};
+
+/// <summary>
+/// @brief Fixed-point mapping of a float range onto an unsigned integer of just enough bits.
+/// Values outside [min, max] are clamped. Round-trip error is at most precision / 2.
+/// </summary>
+struct QuantizedRange
+{
+	float min;
+	float max;
+	float precision;
+
+	int getBits() const;
+	uint32_t quantize(float value) const;
+	float dequantize(uint32_t quantized) const;
+};
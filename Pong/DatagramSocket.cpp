@@ -0,0 +1,445 @@
+#include "DatagramSocket.h"
+#include <cstring>
+#include "NetConditioner.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Longest the I/O thread waits on the socket before checking for datagrams to send
+	const sf::Time IoWait = sf::milliseconds(1);
+
+#ifdef _WIN32
+	const sf::SocketHandle InvalidHandle = INVALID_SOCKET;
+	void closeHandle(sf::SocketHandle handle) { closesocket(handle); }
+#else
+	const sf::SocketHandle InvalidHandle = -1;
+	void closeHandle(sf::SocketHandle handle) { ::close(handle); }
+#endif
+}
+
+DatagramSocket::DatagramSocket()
+{
+	setBlocking(false);
+	m_sendQueue.reserve(BatchSize);
+}
+
+DatagramSocket::~DatagramSocket()
+{
+	stopIoThread();
+}
+
+bool DatagramSocket::bindMulticast(const sf::IpAddress& group, unsigned short port)
+{
+	unbind();
+
+	// Bound by hand instead of through sf::UdpSocket::bind, so SO_REUSEADDR is set before
+	//  the bind and every process on the machine can listen on the group's port
+	sf::SocketHandle handle = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == InvalidHandle)
+		return false;
+
+	int reuse = 1;
+	sockaddr_in local;
+	std::memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_port = htons(port);
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	ip_mreq membership;
+	std::memset(&membership, 0, sizeof(membership));
+	membership.imr_multiaddr.s_addr = htonl(group.toInteger());
+	membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+	if (setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse)) != 0 ||
+		::bind(handle, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0 ||
+		setsockopt(handle, IPPROTO_IP, IP_ADD_MEMBERSHIP, reinterpret_cast<const char*>(&membership), sizeof(membership)) != 0)
+	{
+		closeHandle(handle);
+		return false;
+	}
+
+	// sf::Socket takes it over: applies the blocking mode now and closes it on unbind()
+	create(handle);
+	return true;
+}
+
+sf::Time DatagramSocket::now()
+{
+	static const sf::Clock clock;
+	return clock.getElapsedTime();
+}
+
+sf::Time DatagramSocket::threadCpuTime()
+{
+#ifdef _WIN32
+	// Kernel and user time, in 100 ns units
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return sf::Time::Zero;
+	uint64_t kernelTicks = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+	uint64_t userTicks = (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+	return sf::microseconds(static_cast<int64_t>((kernelTicks + userTicks) / 10));
+#else
+	timespec cpu;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu) != 0)
+		return sf::Time::Zero;
+	return sf::microseconds(static_cast<int64_t>(cpu.tv_sec) * 1000000 + cpu.tv_nsec / 1000);
+#endif
+}
+
+bool DatagramSocket::hasBatchedIo()
+{
+#ifdef PONG_USE_MMSG
+	return true;
+#else
+	return false;
+#endif
+}
+
+size_t DatagramSocket::readSocket(Datagram* out, size_t maxCount)
+{
+#ifdef PONG_USE_MMSG
+	if (m_batchedIo)
+		return readBatched(out, maxCount);
+#endif
+	return readEach(out, maxCount);
+}
+
+size_t DatagramSocket::writeSocket(std::vector<Datagram>& queue)
+{
+#ifdef PONG_USE_MMSG
+	if (m_batchedIo)
+		return writeBatched(queue);
+#endif
+	return writeEach(queue);
+}
+
+#ifdef PONG_USE_MMSG
+
+size_t DatagramSocket::readBatched(Datagram* out, size_t maxCount)
+{
+	if (maxCount > BatchSize)
+		maxCount = BatchSize;
+
+	mmsghdr messages[BatchSize];
+	iovec buffers[BatchSize];
+	sockaddr_in senders[BatchSize];
+
+	for (size_t i = 0; i < maxCount; ++i)
+	{
+		buffers[i].iov_base = out[i].data;
+		buffers[i].iov_len = Datagram::MaxSize;
+		std::memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+		messages[i].msg_hdr.msg_name = &senders[i];
+		messages[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+		messages[i].msg_hdr.msg_iov = &buffers[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	m_receiveCalls.fetch_add(1, std::memory_order_relaxed);
+	int count = recvmmsg(getNativeHandle(), messages, static_cast<unsigned int>(maxCount), MSG_DONTWAIT, nullptr);
+	if (count <= 0)
+		return 0;
+
+	sf::Time arrival = now();
+	for (int i = 0; i < count; ++i)
+	{
+		out[i].size = messages[i].msg_len;
+		out[i].address = sf::IpAddress(ntohl(senders[i].sin_addr.s_addr));
+		out[i].port = ntohs(senders[i].sin_port);
+		out[i].arrival = arrival;
+	}
+	m_packetsReceived.fetch_add(count, std::memory_order_relaxed);
+	return static_cast<size_t>(count);
+}
+
+size_t DatagramSocket::writeBatched(std::vector<Datagram>& queue)
+{
+	size_t failed = 0;
+	size_t next = 0;
+
+	mmsghdr messages[BatchSize];
+	iovec buffers[BatchSize];
+	sockaddr_in targets[BatchSize];
+
+	while (next < queue.size())
+	{
+		size_t count = queue.size() - next;
+		if (count > BatchSize)
+			count = BatchSize;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			Datagram& datagram = queue[next + i];
+			std::memset(&targets[i], 0, sizeof(targets[i]));
+			targets[i].sin_family = AF_INET;
+			targets[i].sin_addr.s_addr = htonl(datagram.address.toInteger());
+			targets[i].sin_port = htons(datagram.port);
+			buffers[i].iov_base = datagram.data;
+			buffers[i].iov_len = datagram.size;
+			std::memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+			messages[i].msg_hdr.msg_name = &targets[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(targets[i]);
+			messages[i].msg_hdr.msg_iov = &buffers[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		m_sendCalls.fetch_add(1, std::memory_order_relaxed);
+		int sent = sendmmsg(getNativeHandle(), messages, static_cast<unsigned int>(count), MSG_DONTWAIT);
+		if (sent <= 0)
+		{
+			// The first datagram of the batch was rejected; skip it and retry the rest
+			failed++;
+			next++;
+			continue;
+		}
+		m_packetsSent.fetch_add(sent, std::memory_order_relaxed);
+		next += static_cast<size_t>(sent);
+	}
+
+	queue.clear();
+	return failed;
+}
+
+#endif // PONG_USE_MMSG
+
+size_t DatagramSocket::readEach(Datagram* out, size_t maxCount)
+{
+	size_t count = 0;
+	while (count < maxCount)
+	{
+		std::optional<sf::IpAddress> sender;
+		Datagram& datagram = out[count];
+
+		m_receiveCalls.fetch_add(1, std::memory_order_relaxed);
+		auto status = receive(datagram.data, Datagram::MaxSize, datagram.size, sender, datagram.port);
+		if (status != sf::Socket::Status::Done)
+			break;
+		if (!sender.has_value())
+			continue;
+
+		datagram.address = sender.value();
+		datagram.arrival = now();
+		count++;
+	}
+	m_packetsReceived.fetch_add(count, std::memory_order_relaxed);
+	return count;
+}
+
+size_t DatagramSocket::writeEach(std::vector<Datagram>& queue)
+{
+	size_t failed = 0;
+	for (Datagram& datagram : queue)
+	{
+		m_sendCalls.fetch_add(1, std::memory_order_relaxed);
+		if (send(datagram.data, datagram.size, datagram.address, datagram.port) != sf::Socket::Status::Done)
+		{
+			failed++;
+			continue;
+		}
+		m_packetsSent.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	queue.clear();
+	return failed;
+}
+
+size_t DatagramSocket::receiveConditioned(Datagram* out, size_t maxCount)
+{
+	if (!m_inConditioner)
+		return readSocket(out, maxCount);
+
+	// Everything waiting on the socket goes into the conditioner; only what is due comes out
+	size_t count;
+	do
+	{
+		count = readSocket(m_conditionBatch.data(), m_conditionBatch.size());
+		for (size_t i = 0; i < count; ++i)
+			m_inConditioner->submit(m_conditionBatch[i], m_conditionBatch[i].arrival);
+	} while (count == m_conditionBatch.size());
+
+	return m_inConditioner->release(now(), out, maxCount);
+}
+
+size_t DatagramSocket::sendConditioned(std::vector<Datagram>& queue)
+{
+	if (!m_outConditioner)
+		return writeSocket(queue);
+
+	sf::Time sendTime = now();
+	for (const Datagram& datagram : queue)
+		m_outConditioner->submit(datagram, sendTime);
+	queue.clear();
+
+	m_outConditioner->release(sendTime, queue);
+	if (queue.empty())
+		return 0;
+	return writeSocket(queue);
+}
+
+void DatagramSocket::setConditioner(const NetConditionerConfig& config)
+{
+	m_outConditioner.reset();
+	m_inConditioner.reset();
+	if (!config.isEnabled())
+		return;
+
+	if (static_cast<uint8_t>(config.direction) & static_cast<uint8_t>(ConditionerDirection::Outgoing))
+		m_outConditioner = std::make_unique<NetConditioner>(config);
+	if (static_cast<uint8_t>(config.direction) & static_cast<uint8_t>(ConditionerDirection::Incoming))
+	{
+		// A different seed each way, so the two directions don't lose the same packets
+		NetConditionerConfig incoming = config;
+		incoming.seed = config.seed ^ 0x9E3779B9u;
+		m_inConditioner = std::make_unique<NetConditioner>(incoming);
+	}
+	m_conditionBatch.resize(BatchSize);
+	m_conditionDue.reserve(BatchSize);
+}
+
+size_t DatagramSocket::receiveBatch(Datagram* out, size_t maxCount)
+{
+	if (!m_ioRunning)
+	{
+		// Without the I/O thread held sends only move when the owner calls in, so let them out here too
+		if (m_outConditioner && m_outConditioner->isHolding())
+			sendConditioned(m_conditionDue);
+		return receiveConditioned(out, maxCount);
+	}
+
+	size_t count = 0;
+	while (count < maxCount && m_recieved.tryPop(out[count]))
+		count++;
+	return count;
+}
+
+void DatagramSocket::queueSend(const void* data, size_t size, const sf::IpAddress& address, unsigned short port)
+{
+	if (size > Datagram::MaxSize)
+		return;
+
+	Datagram& datagram = stageSend(address, port);
+	std::memcpy(datagram.data, data, size);
+	datagram.size = size;
+}
+
+Datagram& DatagramSocket::stageSend(const sf::IpAddress& address, unsigned short port)
+{
+	m_sendQueue.emplace_back();
+	Datagram& datagram = m_sendQueue.back();
+	datagram.address = address;
+	datagram.port = port;
+	return datagram;
+}
+
+size_t DatagramSocket::flush()
+{
+	if (!m_ioRunning)
+		return sendConditioned(m_sendQueue);
+
+	// Hand the whole batch over at once so the I/O thread can send it in as few calls as possible
+	size_t failed = 0;
+	for (const Datagram& datagram : m_sendQueue)
+	{
+		if (!m_outgoing.tryPush(datagram))
+		{
+			m_queueDrops.fetch_add(1, std::memory_order_relaxed);
+			failed++;
+		}
+	}
+	m_sendQueue.clear();
+	return failed + m_ioSendFailures.exchange(0, std::memory_order_relaxed);
+}
+
+bool DatagramSocket::startIoThread()
+{
+	if (m_ioRunning)
+		return true;
+	if (getLocalPort() == 0)
+		return false; // not bound
+
+	m_recieved.clear();
+	m_outgoing.clear();
+	m_ioSendFailures = 0;
+	m_ioThreadCpuMicros = 0;
+	m_ioRunning = true;
+	m_ioThread = std::thread(&DatagramSocket::ioLoop, this);
+	return true;
+}
+
+void DatagramSocket::stopIoThread()
+{
+	m_ioRunning = false;
+	if (m_ioThread.joinable())
+		m_ioThread.join();
+
+	m_recieved.clear();
+	m_outgoing.clear();
+}
+
+void DatagramSocket::ioLoop()
+{
+	sf::SocketSelector selector;
+	selector.add(*this);
+
+	std::vector<Datagram> batch(BatchSize);
+	std::vector<Datagram> sending;
+	sending.reserve(BatchSize);
+
+	while (m_ioRunning)
+	{
+		// Wake as soon as something lands, or after IoWait to send what the owner flushed
+		bool readable = selector.wait(IoWait);
+		if (readable || (m_inConditioner && m_inConditioner->isHolding()))
+		{
+			size_t count;
+			do
+			{
+				count = receiveConditioned(batch.data(), batch.size());
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (!m_recieved.tryPush(batch[i]))
+						m_queueDrops.fetch_add(1, std::memory_order_relaxed);
+				}
+			} while (count == batch.size());
+		}
+
+		Datagram datagram;
+		while (m_outgoing.tryPop(datagram))
+			sending.push_back(datagram);
+		if (!sending.empty() || (m_outConditioner && m_outConditioner->isHolding()))
+			m_ioSendFailures.fetch_add(sendConditioned(sending), std::memory_order_relaxed);
+
+		m_ioThreadCpuMicros.store(threadCpuTime().asMicroseconds(), std::memory_order_relaxed);
+	}
+}
+
+DatagramIoCounters DatagramSocket::getCounters() const
+{
+	DatagramIoCounters counters;
+	counters.packetsReceived = m_packetsReceived.load(std::memory_order_relaxed);
+	counters.packetsSent = m_packetsSent.load(std::memory_order_relaxed);
+	counters.receiveCalls = m_receiveCalls.load(std::memory_order_relaxed);
+	counters.sendCalls = m_sendCalls.load(std::memory_order_relaxed);
+	counters.queueDrops = m_queueDrops.load(std::memory_order_relaxed);
+	return counters;
+}
+
+void DatagramSocket::resetCounters()
+{
+	m_packetsReceived = 0;
+	m_packetsSent = 0;
+	m_receiveCalls = 0;
+	m_sendCalls = 0;
+	m_queueDrops = 0;
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <SFML/Network.hpp>
+#include "SpscQueue.h"
+
+// PONG_BATCHED_IO compiles in the recvmmsg/sendmmsg backend, which moves the receive drain and
+//  the outgoing fan-out onto one syscall per batch instead of one per datagram. It defaults to 1
+//  on Linux, the only platform with those calls; build with PONG_BATCHED_IO=0 to leave it out.
+// Without it every datagram takes its own UdpSocket call.
+#ifndef PONG_BATCHED_IO
+#ifdef __linux__
+#define PONG_BATCHED_IO 1
+#else
+#define PONG_BATCHED_IO 0
+#endif
+#endif
+#if PONG_BATCHED_IO && defined(__linux__)
+#define PONG_USE_MMSG
+#endif
+
+struct Datagram {
+	static const size_t MaxSize = 128;
+
+	char data[MaxSize];
+	size_t size = 0;
+	sf::IpAddress address = sf::IpAddress::Any;
+	unsigned short port = 0;
+	sf::Time arrival = sf::Time::Zero;	// when it was read off the socket, on DatagramSocket::now()
+};
+
+class NetConditioner;
+struct NetConditionerConfig;
+
+// Syscall and packet counters, used to compare the batched and per-datagram backends
+struct DatagramIoCounters {
+	uint64_t packetsReceived = 0;
+	uint64_t packetsSent = 0;
+	uint64_t receiveCalls = 0;
+	uint64_t sendCalls = 0;
+	uint64_t queueDrops = 0;	// datagrams lost because an I/O thread queue was full
+};
+
+/// <summary>
+/// @brief Non-blocking UDP socket that receives and sends in batches.
+///
+/// Derives from sf::UdpSocket so bind/unbind/getLocalPort are unchanged, and so the
+///  native handle is reachable for recvmmsg/sendmmsg when PONG_USE_MMSG is set. Builds with
+///  both backends use the batched one unless setBatchedIo(false) picks the per-datagram one.
+/// Outgoing datagrams are queued with queueSend() and leave together on flush().
+///
+/// After startIoThread() a dedicated thread owns the socket: it waits on it, reads and
+///  timestamps datagrams the moment they land and hands them over through an SPSC queue,
+///  and sends whatever flush() passes back through a second one. receiveBatch/queueSend/flush
+///  keep their meaning, so the owner's code is the same either way; only when packets are
+///  read and sent stops depending on how often the owner gets to call them.
+///
+/// setConditioner() puts a NetConditioner between the socket and the queues, so delay,
+///  jitter, loss, duplication and reordering can be added to a loopback session.
+/// </summary>
+class DatagramSocket : public sf::UdpSocket
+{
+public:
+	static const size_t BatchSize = 64;
+	static const size_t IoQueueSize = 1024;	// datagrams each way between the I/O thread and the owner
+
+	DatagramSocket();
+	~DatagramSocket();
+
+	/// <summary>
+	/// @brief Reads up to maxCount pending datagrams into out. Returns how many were read (0 when drained).
+	/// With the I/O thread running these are the datagrams it has already read, oldest first.
+	/// </summary>
+	size_t receiveBatch(Datagram* out, size_t maxCount);
+
+	/// <summary>
+	/// @brief Binds port with address reuse and joins the IPv4 multicast group on it, so any number
+	///  of processes on one machine can listen to the same group. Replaces any earlier binding.
+	/// </summary>
+	bool bindMulticast(const sf::IpAddress& group, unsigned short port);
+
+	/// <summary>
+	/// @brief Copies a datagram into the send queue. Nothing is sent until flush().
+	/// </summary>
+	void queueSend(const void* data, size_t size, const sf::IpAddress& address, unsigned short port);
+
+	/// <summary>
+	/// @brief Appends an empty datagram to the send queue for the caller to encode straight into.
+	/// Set its size before the next stageSend/queueSend; cancelStaged() takes it back if encoding fails.
+	/// </summary>
+	Datagram& stageSend(const sf::IpAddress& address, unsigned short port);
+	void cancelStaged() { if (!m_sendQueue.empty()) m_sendQueue.pop_back(); }
+
+	/// <summary>
+	/// @brief Sends everything queued since the last flush. Returns the number of datagrams that failed.
+	/// With the I/O thread running the batch is handed to it, and failures it met since the
+	///  previous flush are reported instead.
+	/// </summary>
+	size_t flush();
+
+	/// <summary>
+	/// @brief Moves all socket calls onto a dedicated thread. Call after bind().
+	/// </summary>
+	bool startIoThread();
+
+	/// <summary>
+	/// @brief Joins the I/O thread and drops anything still queued either way. Call before unbind().
+	/// </summary>
+	void stopIoThread();
+
+	bool hasIoThread() const { return m_ioThread.joinable(); }
+
+	/// <summary>
+	/// @brief Chooses recvmmsg/sendmmsg (true, the default) or one call per datagram. Only builds with
+	///  PONG_USE_MMSG have a choice; elsewhere this is ignored. Call while the I/O thread is stopped.
+	/// </summary>
+	void setBatchedIo(bool enabled) { m_batchedIo = enabled && hasBatchedIo(); }
+	bool isBatchedIo() const { return m_batchedIo; }
+	static bool hasBatchedIo();
+
+	/// <summary>
+	/// @brief Impairs traffic in the configured direction(s), starting from an empty hold queue.
+	/// Call while the I/O thread is stopped; a disabled config removes the conditioner.
+	/// </summary>
+	void setConditioner(const NetConditionerConfig& config);
+	bool hasConditioner() const { return m_outConditioner || m_inConditioner; }
+
+	DatagramIoCounters getCounters() const;
+	void resetCounters();
+
+	// Drop anything still queued (used when the owning controller resets)
+	void clearSendQueue() { m_sendQueue.clear(); }
+
+	// Monotonic process-wide clock that arrival times are stamped on
+	static sf::Time now();
+
+	// CPU time the calling thread has used so far, for measuring where a host's load goes
+	static sf::Time threadCpuTime();
+
+	// CPU time the I/O thread has used since it started, refreshed every pass of its loop
+	sf::Time getIoThreadCpuTime() const { return sf::microseconds(m_ioThreadCpuMicros.load(std::memory_order_relaxed)); }
+
+private:
+	// Direct socket calls, made by whichever thread owns the socket, on the chosen backend
+	size_t readSocket(Datagram* out, size_t maxCount);
+	size_t writeSocket(std::vector<Datagram>& queue);	// sends and clears the queue; returns failures
+
+	// The backends: one UdpSocket call per datagram, and recvmmsg/sendmmsg
+	size_t readEach(Datagram* out, size_t maxCount);
+	size_t writeEach(std::vector<Datagram>& queue);
+#ifdef PONG_USE_MMSG
+	size_t readBatched(Datagram* out, size_t maxCount);
+	size_t writeBatched(std::vector<Datagram>& queue);
+#endif
+
+	// The same, through the conditioners when set: reads go in and only due datagrams come out,
+	//  sends are held and whatever is due (possibly nothing, possibly older ones) goes out
+	size_t receiveConditioned(Datagram* out, size_t maxCount);
+	size_t sendConditioned(std::vector<Datagram>& queue);
+
+	void ioLoop();
+
+	std::vector<Datagram> m_sendQueue;
+	bool m_batchedIo{ hasBatchedIo() };
+
+	// Optional impairment, used only by whichever thread owns the socket
+	std::unique_ptr<NetConditioner> m_outConditioner;
+	std::unique_ptr<NetConditioner> m_inConditioner;
+	std::vector<Datagram> m_conditionBatch;
+	std::vector<Datagram> m_conditionDue;
+
+	// Counted from the I/O thread while it runs, so kept atomic
+	std::atomic<uint64_t> m_packetsReceived{ 0 };
+	std::atomic<uint64_t> m_packetsSent{ 0 };
+	std::atomic<uint64_t> m_receiveCalls{ 0 };
+	std::atomic<uint64_t> m_sendCalls{ 0 };
+	std::atomic<uint64_t> m_queueDrops{ 0 };
+
+	// I/O thread and its queues (recieved: I/O thread -> owner, outgoing: owner -> I/O thread)
+	std::thread m_ioThread;
+	std::atomic<bool> m_ioRunning{ false };
+	std::atomic<int64_t> m_ioThreadCpuMicros{ 0 };
+	SpscQueue<Datagram> m_recieved{ IoQueueSize };
+	SpscQueue<Datagram> m_outgoing{ IoQueueSize };
+	std::atomic<size_t> m_ioSendFailures{ 0 };
+};
@@ -0,0 +1,56 @@
+#include "FixedTimestep.h"
+#include <cmath>
+#include <cstdlib>
+
+FixedTimestep::FixedTimestep(double tickRate)
+	: m_tickRate(0.0), m_dt(0.f), m_stepNs(1)
+{
+	setTickRate(tickRate);
+}
+
+void FixedTimestep::setTickRate(double tickRate)
+{
+	if (tickRate <= 0.0)
+		return;
+	m_tickRate = tickRate;
+	m_dt = static_cast<float>(1.0 / tickRate);
+	m_stepNs = std::llround(1e9 / tickRate);
+	restart();
+}
+
+void FixedTimestep::restart()
+{
+	m_accumulatedNs = 0;
+	m_droppedSteps = 0;
+	m_last = Clock::now();
+}
+
+int FixedTimestep::advance()
+{
+	Clock::time_point now = Clock::now();
+	m_accumulatedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_last).count();
+	m_last = now;
+
+	int64_t steps = m_accumulatedNs / m_stepNs;
+	m_accumulatedNs -= steps * m_stepNs;
+	if (steps > MaxStepsPerAdvance)
+	{
+		m_droppedSteps += static_cast<uint64_t>(steps - MaxStepsPerAdvance);
+		steps = MaxStepsPerAdvance;
+	}
+	return static_cast<int>(steps);
+}
+
+bool FixedTimestep::tickRateFromEnvironment(double& out)
+{
+	const char* spec = std::getenv("PONG_TICK_RATE");
+	if (spec == nullptr || *spec == '\0')
+		return false;
+
+	char* end = nullptr;
+	double rate = std::strtod(spec, &end);
+	if (end == spec || *end != '\0' || rate < 10.0 || rate > 1000.0)
+		return false;
+	out = rate;
+	return true;
+}
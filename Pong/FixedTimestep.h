@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <SFML/System.hpp>
+
+/// <summary>
+/// @brief Fixed-step game loop clock: how many sim steps are due, and how far into the next one we are.
+///
+/// Real time is added up in nanoseconds on std::chrono::steady_clock and paid out one step of
+///  1 / tickRate at a time, so 60 Hz steps every 16.666667 ms and neither runs slow nor drifts.
+///  Each step gets getDt() seconds, the same value every time, so the sim stays deterministic.
+///  What is left over, as a fraction of a step, is getAlpha(); a renderer blends the previous
+///  and current sim state by it to move smoothly at any refresh rate.
+/// After a long stall (a dragged window, a breakpoint) at most MaxStepsPerAdvance steps are run
+///  and the rest of the backlog is dropped, rather than fast-forwarding the match.
+/// Example usage:
+///		FixedTimestep timestep(PongSim::TickRate);
+///		while (running)
+///		{
+///			for (int steps = timestep.advance(); steps > 0; --steps)
+///				PongSim::step(state, inputs, timestep.getDt());
+///			render(timestep.getAlpha());
+///		}
+/// </summary>
+class FixedTimestep
+{
+public:
+	static const int MaxStepsPerAdvance = 15;
+
+	explicit FixedTimestep(double tickRate);
+
+	/// <summary>
+	/// @brief Changes the step rate and starts counting from now. Non-positive rates are ignored.
+	/// </summary>
+	void setTickRate(double tickRate);
+	double getTickRate() const { return m_tickRate; }
+
+	/// <summary>
+	/// @brief Forgets any backlog and starts counting from now.
+	/// </summary>
+	void restart();
+
+	/// <summary>
+	/// @brief Adds the real time since the last call and returns how many steps are now due.
+	/// </summary>
+	int advance();
+
+	// Step length in seconds, as passed to the sim
+	float getDt() const { return m_dt; }
+
+	// Step length for sleeping and budgets (microsecond resolution)
+	sf::Time getStepTime() const { return sf::microseconds((m_stepNs + 500) / 1000); }
+
+	// Fraction of the next step already elapsed, in [0, 1)
+	float getAlpha() const { return static_cast<float>(static_cast<double>(m_accumulatedNs) / m_stepNs); }
+
+	// Real time left until the next step is due
+	sf::Time getTimeToNextStep() const { return sf::microseconds((m_stepNs - m_accumulatedNs) / 1000); }
+
+	// Steps thrown away after stalls since the last restart
+	uint64_t getDroppedSteps() const { return m_droppedSteps; }
+
+	/// <summary>
+	/// @brief Reads the PONG_TICK_RATE environment variable (Hz, 10 to 1000). False if it is unset or invalid.
+	/// </summary>
+	static bool tickRateFromEnvironment(double& out);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	double m_tickRate;
+	float m_dt;
+	int64_t m_stepNs;
+	int64_t m_accumulatedNs{ 0 };
+	uint64_t m_droppedSteps{ 0 };
+	Clock::time_point m_last;
+};
@@ -1,9 +1,7 @@
 #include "Game.h"
-#include <iostream>
+#include "AsyncLogger.h"
 #include <cmath>
-
-// Our target FPS
-static double const FPS{ 60.0f };
+#include <cstdlib>
 
 Game::Game()
     : m_window(sf::VideoMode(sf::Vector2u(ScreenSize::s_width, ScreenSize::s_height), 32), "SFML Playground", sf::Style::Default)
@@ -21,10 +19,15 @@ Game::Game()
 void Game::init()
 {
 	m_window.setVerticalSyncEnabled(true);
+
+	if (FixedTimestep::tickRateFromEnvironment(m_localTickRate))
+		LOG_INFO("Local play runs at %.0f Hz (PONG_TICK_RATE)", m_localTickRate);
+	else if (std::getenv("PONG_TICK_RATE"))
+		LOG_WARN("Ignoring malformed PONG_TICK_RATE (10 to 1000 Hz)");
     
 	if (!m_arialFont.openFromFile("ASSETS/FONTS/ariblk.ttf"))
 	{
-		std::cout << "Error loading font file";
+		LOG_ERROR("Error loading font file");
 	}
 
 	// Initialize paddles
@@ -66,6 +69,15 @@ void Game::init()
 	m_overlayText.setCharacterSize(64);
 	m_overlayText.setFillColor(sf::Color::White);
 
+	// Network statistics overlay
+	m_netStatsBackground.setPosition(sf::Vector2f(10.f, 90.f));
+	m_netStatsBackground.setFillColor(sf::Color(0, 0, 0, 170));
+	m_netStatsText.setFont(m_arialFont);
+	m_netStatsText.setCharacterSize(14);
+	m_netStatsText.setFillColor(sf::Color(120, 255, 120));
+	m_netStatsText.setPosition(sf::Vector2f(18.f, 96.f));
+	m_netStatsText.setString("Waiting for network statistics...");
+
 #ifdef TEST_FPS
 	x_updateFPS.setFont(m_arialFont);
 	x_updateFPS.setPosition(sf::Vector2f(20, 300));
@@ -144,6 +156,9 @@ void Game::init()
 	float modalCenterY = ScreenSize::s_height / 2.f;
 	m_modalHostBtn.setPosition(sf::Vector2f(modalCenterX - 240.f, modalCenterY - 40.f));
 	m_modalJoinBtn.setPosition(sf::Vector2f(modalCenterX + 20.f, modalCenterY - 40.f));
+	m_modalWatchBtn.setSize(sf::Vector2f(220.f, 70.f));
+	m_modalWatchBtn.setFillColor(sf::Color(140, 140, 140));
+	m_modalWatchBtn.setPosition(sf::Vector2f(modalCenterX - 110.f, modalCenterY + 45.f));
 
 	m_modalHostText.setFont(m_arialFont);
 	m_modalJoinText.setFont(m_arialFont);
@@ -155,12 +170,17 @@ void Game::init()
 	m_modalJoinText.setFillColor(sf::Color::White);
 	centerTextInRect(m_modalHostText, m_modalHostBtn);
 	centerTextInRect(m_modalJoinText, m_modalJoinBtn);
+	m_modalWatchText.setFont(m_arialFont);
+	m_modalWatchText.setString("Watch");
+	m_modalWatchText.setCharacterSize(32);
+	m_modalWatchText.setFillColor(sf::Color::White);
+	centerTextInRect(m_modalWatchText, m_modalWatchBtn);
 
 	m_modalStatusText.setFont(m_arialFont);
 	m_modalStatusText.setCharacterSize(24);
 	m_modalStatusText.setFillColor(sf::Color(200, 200, 200));
 	m_modalStatusText.setString("");
-	m_modalStatusText.setPosition(sf::Vector2f(modalCenterX, modalCenterY + 110.f));
+	m_modalStatusText.setPosition(sf::Vector2f(modalCenterX, modalCenterY + 150.f));
 	auto sb = m_modalStatusText.getLocalBounds();
 	sf::Vector2f sbOrigin(sb.position.x + sb.size.x / 2.f, sb.position.y + sb.size.y / 2.f);
 	m_modalStatusText.setOrigin(sbOrigin);
@@ -171,23 +191,32 @@ void Game::init()
 
 void Game::resetGame()
 {
-	m_leftScore = 0;
-	m_rightScore = 0;
-	m_leftScoreText.setString(std::to_string(m_leftScore));
-	m_rightScoreText.setString(std::to_string(m_rightScore));
+	PongSim::reset(m_sim);
+	m_previousSim = m_sim;
+	m_lagCompensator.reset();
 	m_gameOver = false;
-	m_leftPaddle.setPosition(sf::Vector2f(50.f, (float)ScreenSize::s_height / 2.f - m_leftPaddle.getSize().y / 2.f));
-	m_rightPaddle.setPosition(sf::Vector2f((float)ScreenSize::s_width - 50.f - m_rightPaddle.getSize().x, (float)ScreenSize::s_height / 2.f - m_rightPaddle.getSize().y / 2.f));
-	m_ball.setPosition(sf::Vector2f((float)ScreenSize::s_width / 2.f - m_ball.getRadius(), (float)ScreenSize::s_height / 2.f - m_ball.getRadius()));
-	m_ballVelocity = sf::Vector2f(-400.f, -250.f);
+	syncShapesFromSim();
+}
+
+void Game::syncShapesFromSim()
+{
+	m_leftPaddle.setPosition(sf::Vector2f(PongSim::LeftPaddleX, m_sim.leftPaddleY));
+	m_rightPaddle.setPosition(sf::Vector2f(PongSim::RightPaddleX, m_sim.rightPaddleY));
+	m_ball.setPosition(sf::Vector2f(m_sim.ballX, m_sim.ballY));
+
+	// Only rebuild the score strings when a point was scored
+	if (m_leftScore != m_sim.leftScore || m_rightScore != m_sim.rightScore)
+	{
+		m_leftScore = m_sim.leftScore;
+		m_rightScore = m_sim.rightScore;
+		m_leftScoreText.setString(std::to_string(m_leftScore));
+		m_rightScoreText.setString(std::to_string(m_rightScore));
+	}
 }
 
 void Game::run()
 {
-	sf::Clock clock;
-	sf::Time timeSinceLastUpdate = sf::Time::Zero;
-	
-	sf::Time timePerFrame = sf::seconds(1.0f / FPS);
+	m_timestep.restart();
 	while (m_window.isOpen())
 	{
 		processEvents();
@@ -211,35 +240,59 @@ void Game::run()
 		}
 
 		//GUEST GAMEPLAY NETWORKING
+		//(paddle input is sampled and sent once per simulation tick in update())
 		if (m_state == GameState::Playing && m_isNetworkedGame && !m_isHost) 
 		{
-			guestPaddleController();	// sending paddle position to host
-
 			recieveNetworkState();		// receiving game state from host
 		}
 
-		timeSinceLastUpdate += clock.restart();
-		while (timeSinceLastUpdate > timePerFrame)
+		applyTickRate();
+		for (int steps = m_timestep.advance(); steps > 0; --steps)
 		{
-			timeSinceLastUpdate -= timePerFrame;
 			processEvents();
-			update(timePerFrame.asMilliseconds());
+			update(m_timestep.getDt());
+
+			//one state send per simulation tick; the session's snapshot rate decides which ticks go out
+			if (m_state == GameState::Playing && m_isNetworkedGame && m_isHost)
+			{
+				sendHostState();
+			}
 #ifdef TEST_FPS
-			x_secondTime += timePerFrame;
+			x_secondTime += m_timestep.getStepTime();
 			x_updateFrameCount++;
 			if (x_secondTime.asSeconds() > 1)
 			{
 				std::string updatesPS = "UPS " + std::to_string(x_updateFrameCount - 1);
 				x_updateFPS.setString(updatesPS);
 				std::string drawsPS = "DPS " + std::to_string(x_drawFrameCount);
-			 x_drawFPS.setString(drawnPS);
+							x_drawFPS.setString(drawsPS);
 				x_updateFrameCount = 0;
 				x_drawFrameCount = 0;
 				x_secondTime = sf::Time::Zero;
+
+				// Guest playout health once a second
+				if (m_isNetworkedGame && !m_isHost && m_state == GameState::Playing)
+				{
+					const JitterBufferStats& stats = m_snapshotBuffer.getStats();
+					const LinkEstimator& link = m_guestNet.getLink();
+					LOG_DEBUG("Link: rtt %.1f ms, rtt jitter %.1f ms, host clock offset %.1f ms",
+						link.getRttMs(), link.getJitterMs(), link.getOffsetMs());
+
+					LOG_DEBUG("Snapshot buffer: delay %.1f ms, depth %d, jitter %.1f ms, spacing %.2f ticks, underruns %llu, late %llu, duplicates %llu",
+						stats.delayMs, stats.depth, stats.jitterMs, stats.spacingTicks, static_cast<unsigned long long>(stats.underruns),
+						static_cast<unsigned long long>(stats.lateDrops), static_cast<unsigned long long>(stats.duplicates));
+					m_snapshotBuffer.resetStats();
+
+					const PredictionStats& prediction = m_paddlePredictor.getStats();
+					LOG_DEBUG("Paddle prediction: %llu/%llu corrected, last %.2f px, max %.2f px",
+						static_cast<unsigned long long>(prediction.corrections), static_cast<unsigned long long>(prediction.reconciles),
+						prediction.lastCorrection, prediction.maxCorrection);
+					m_paddlePredictor.resetStats();
+				}
 			}
 #endif
 		}
-		render();
+		render(m_timestep.getAlpha());
 #ifdef TEST_FPS
 		x_drawFrameCount++;
 #endif
@@ -276,6 +329,7 @@ void Game::processGameEvents(const sf::Event& event)
                     m_guestNet.reset();
                     m_isNetworkedGame = false;
                     m_isHost = false;
+                    m_isSpectator = false;
                     m_showMultiplayerModal = false;
                     m_modalStatusText.setString("");
                 }
@@ -288,12 +342,20 @@ void Game::processGameEvents(const sf::Event& event)
                 m_guestNet.reset();
                 m_isNetworkedGame = false;
                 m_isHost = false;
+                m_isSpectator = false;
                 m_state = GameState::MainMenu;
                 m_showMultiplayerModal = false;
                 m_modalStatusText.setString("");
                 resetGame();
             }
             break;
+        case sf::Keyboard::Scancode::F3:
+            // Toggle the network statistics overlay
+            m_showNetStats = !m_showNetStats;
+            break;
+        case sf::Keyboard::Scancode::F4:
+            toggleNetStatsCsv();
+            break;
         default:
             break;
         }
@@ -322,6 +384,10 @@ void Game::processGameEvents(const sf::Event& event)
                         auto sb3 = m_modalStatusText.getLocalBounds();
                         m_modalStatusText.setOrigin(sf::Vector2f(sb3.position.x + sb3.size.x / 2.f, sb3.position.y + sb3.size.y / 2.f));
                     }
+                    else if (inRect(m_modalWatchBtn))
+                    {
+                        waitingForHost(true);
+                    }
                 }
                 else
                 {
@@ -350,64 +416,38 @@ void Game::processGameEvents(const sf::Event& event)
     }
 }
 
-void Game::update(double dt)
+void Game::update(float dt)
 {
-	// dt arrives in milliseconds; convert to seconds
-	float floatSeconds = static_cast<float>(dt) / 1000.f;
-
 	if (m_isNetworkedGame && !m_isHost) { // ensures guest doesn't run gameplay update logic
 		// Do not interpolate when not actively playing (e.g., in menu or game over)
 		if (m_state != GameState::Playing) {
 			return;
 		}
 
-		if (m_hasPrev && m_hasCurr) {
-			// Time-based interpolation. Alpha is in [0,1].
-			m_interpAlpha += floatSeconds;
-			if (m_interpAlpha >= 1.0f) {
-				m_interpAlpha = 1.0f;
-				// Snap to current at completion and keep prev in sync to avoid drift
-				m_prevState = m_currState;
-			}
+		// One tick-stamped input per simulation tick, so the host can apply them in order
+		// (spectators have no paddle)
+		if (!m_isSpectator)
+			guestPaddleController(dt);
 
-			auto lerp = [](float a, float b, float alpha) {
-				return a + (b - a) * alpha;
-			};
-
-			float p1Y = lerp(m_prevState.p1Y, m_currState.p1Y, m_interpAlpha);
-			float p2Y = lerp(m_prevState.p2Y, m_currState.p2Y, m_interpAlpha);
-			float ballX = lerp(m_prevState.ballX, m_currState.ballX, m_interpAlpha);
-			float ballY = lerp(m_prevState.ballY, m_currState.ballY, m_interpAlpha);
-
-			m_leftPaddle.setPosition(sf::Vector2f(m_leftPaddle.getPosition().x, p1Y));
-			m_rightPaddle.setPosition(sf::Vector2f(m_rightPaddle.getPosition().x, p2Y));
-			m_ball.setPosition(sf::Vector2f(ballX, ballY));
-
-			m_leftScore = m_currState.p1Score;
-			m_rightScore = m_currState.p2Score;
-			m_leftScoreText.setString(std::to_string(m_leftScore));
-			m_rightScoreText.setString(std::to_string(m_rightScore));
-
-			// Check win conditions on guest side based on received scores
-			if (!m_gameOver) {
-				if (m_leftScore >= m_winScore) {
-					m_gameOver = true;
-					m_overlayText.setString("Player 1\nWins!\nPress Escape to\nReturn to Menu");
-					auto bounds = m_overlayText.getLocalBounds();
-					sf::Vector2f origin(bounds.position.x + bounds.size.x / 2.f, bounds.position.y + bounds.size.y / 2.f);
-					m_overlayText.setOrigin(origin);
-					m_overlayText.setPosition(sf::Vector2f((float)ScreenSize::s_width / 2.f, (float)ScreenSize::s_height / 2.f));
-				}
-				else if (m_rightScore >= m_winScore) {
-					m_gameOver = true;
-					m_overlayText.setString("Player 2\nWins!\nPress Escape to\nReturn to Menu");
-					auto bounds = m_overlayText.getLocalBounds();
-					sf::Vector2f origin(bounds.position.x + bounds.size.x / 2.f, bounds.position.y + bounds.size.y / 2.f);
-					m_overlayText.setOrigin(origin);
-					m_overlayText.setPosition(sf::Vector2f((float)ScreenSize::s_width / 2.f, (float)ScreenSize::s_height / 2.f));
-				}
-			}
+		// Play host snapshots back a fixed delay behind the newest one
+		m_snapshotBuffer.advance(sf::seconds(dt));
+
+		NetLogicStates view;
+		if (m_snapshotBuffer.sample(view)) {
+			m_leftPaddle.setPosition(sf::Vector2f(m_leftPaddle.getPosition().x, view.p1Y));
+			m_ball.setPosition(sf::Vector2f(view.ballX, view.ballY));
+
+			// Our own paddle is predicted, so it shows the present instead of the delayed host view
+			float ownPaddleY = m_gameOver || m_isSpectator ? view.p2Y : m_paddlePredictor.getPredictedY();
+			m_rightPaddle.setPosition(sf::Vector2f(m_rightPaddle.getPosition().x, ownPaddleY));
+
+			if (m_isSpectator)
+				showSnapshotScores(view);
 		}
+
+		// Scores and game over come from reliable SCORE_EVENTs, shown once playback reaches their tick
+		applyDueScoreEvents();
+		refreshNetStats();
 		return;
 	}
 
@@ -417,6 +457,11 @@ void Game::update(double dt)
 		return;
 	}
 
+	if (m_isNetworkedGame)
+	{
+		refreshNetStats();
+	}
+
 	if (m_isHost || !m_isNetworkedGame)
 	{
 
@@ -431,139 +476,36 @@ void Game::update(double dt)
 		}
 
 		// Player input - left paddle: W/S, right paddle: Up/Down
-		if (!m_isNetworkedGame)
+		PongSimInputs inputs = readLocalInputs();
+		m_previousSim = m_sim;
+		if (m_isNetworkedGame)
 		{
-			if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::W))
-			{
-				m_leftPaddle.move(sf::Vector2f(0.f, -m_paddleSpeed * floatSeconds));
-			}
-			if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S))
-			{
-				m_leftPaddle.move(sf::Vector2f(0.f, m_paddleSpeed * floatSeconds));
-			}
-			if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Up))
-			{
-				m_rightPaddle.move(sf::Vector2f(0.f, -m_paddleSpeed * floatSeconds));
-			}
-			if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Down))
-			{
-				m_rightPaddle.move(sf::Vector2f(0.f, m_paddleSpeed * floatSeconds));
-			}
-		}
-		else {
-			if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::W) ||
-				sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Up))
-			{
-				m_leftPaddle.move(sf::Vector2f(0.f, -m_paddleSpeed * floatSeconds));
-			}
-			if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S) ||
-				sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Down))
-			{
-				m_leftPaddle.move(sf::Vector2f(0.f, m_paddleSpeed * floatSeconds));
-			}
-
-			//Moving networked player 2
-			if (m_isNetP2Up) {
-				m_rightPaddle.move(sf::Vector2f(0.f, -m_paddleSpeed * floatSeconds));
-			}
-			if (m_isNetP2Down) {
-				m_rightPaddle.move(sf::Vector2f(0.f, m_paddleSpeed * floatSeconds));
-			}
-		}
-
-		// Keep paddles inside the screen
-		auto clampPaddle = [&](sf::RectangleShape& paddle)
-			{
-				if (paddle.getPosition().y < 0.f)
-					paddle.setPosition(sf::Vector2f(paddle.getPosition().x, 0.f));
-				if (paddle.getPosition().y + paddle.getSize().y > (float)ScreenSize::s_height)
-					paddle.setPosition(sf::Vector2f(paddle.getPosition().x, (float)ScreenSize::s_height - paddle.getSize().y));
-			};
-		clampPaddle(m_leftPaddle);
-		clampPaddle(m_rightPaddle);
-
-		// Move ball
-		m_ball.move(m_ballVelocity * floatSeconds);
-
-		// Ball collision with top/bottom
-		if (m_ball.getPosition().y <= 0.f)
-		{
-			m_ball.setPosition(sf::Vector2f(m_ball.getPosition().x, 0.f));
-			m_ballVelocity.y = -m_ballVelocity.y;
-		}
-		if (m_ball.getPosition().y + m_ball.getRadius() * 2.f >= (float)ScreenSize::s_height)
-		{
-			m_ball.setPosition(sf::Vector2f(m_ball.getPosition().x, (float)ScreenSize::s_height - m_ball.getRadius() * 2.f));
-			m_ballVelocity.y = -m_ballVelocity.y;
+			//Moving networked player 2: next input from the guest's tick buffer
+			//[guest input = -1 -> up , 1 -> down , 0 -> no input]
+			inputs.right = m_hostNet.consumeGuestInput(m_guestSession);
+
+			// Judge the guest's paddle against the ball it was actually looking at
+			uint16_t viewTick = 0;
+			bool hasViewTick = m_hostNet.getGuestViewTick(m_guestSession, viewTick);
+			m_lagCompensator.step(m_sim, inputs.left, inputs.right, dt, viewTick, hasViewTick);
+			m_hostNet.announceScore(m_guestSession, m_sim);
 		}
-
-		// Ball collision with paddles (AABB using positions and sizes)
+		else
 		{
-			auto ballPos = m_ball.getPosition();
-			auto ballSize = sf::Vector2f(m_ball.getRadius() * 2.f, m_ball.getRadius() * 2.f);
-
-			auto lp = m_leftPaddle.getPosition();
-			auto lsize = m_leftPaddle.getSize();
-			bool intersectsLeft = !(ballPos.x + ballSize.x < lp.x || ballPos.x > lp.x + lsize.x ||
-				ballPos.y + ballSize.y < lp.y || ballPos.y > lp.y + lsize.y);
-			if (intersectsLeft)
-			{
-				m_ball.setPosition(sf::Vector2f(lp.x + lsize.x + 0.1f, ballPos.y));
-				m_ballVelocity.x = std::abs(m_ballVelocity.x);
-			}
-
-			auto rp = m_rightPaddle.getPosition();
-			auto rsize = m_rightPaddle.getSize();
-			bool intersectsRight = !(ballPos.x + ballSize.x < rp.x || ballPos.x > rp.x + rsize.x ||
-				ballPos.y + ballSize.y < rp.y || ballPos.y > rp.y + rsize.y);
-			if (intersectsRight)
-			{
-				m_ball.setPosition(sf::Vector2f(rp.x - ballSize.x - 0.1f, ballPos.y));
-				m_ballVelocity.x = -std::abs(m_ballVelocity.x);
-			}
-		}
-
-		// Ball out of bounds - simple reset and score
-		if (m_ball.getPosition().x < -50.f)
-		{
-			// right player scores
-			m_rightScore++;
-			m_rightScoreText.setString(std::to_string(m_rightScore));
-			m_ball.setPosition(sf::Vector2f((float)ScreenSize::s_width / 2.f - m_ball.getRadius(), (float)ScreenSize::s_height / 2.f - m_ball.getRadius()));
-			m_ballVelocity = sf::Vector2f(-400.f, -250.f);
-		}
-		else if (m_ball.getPosition().x > (float)ScreenSize::s_width + 50.f)
-		{
-			// left player scores
-			m_leftScore++;
-			m_leftScoreText.setString(std::to_string(m_leftScore));
-			m_ball.setPosition(sf::Vector2f((float)ScreenSize::s_width / 2.f - m_ball.getRadius(), (float)ScreenSize::s_height / 2.f - m_ball.getRadius()));
-			m_ballVelocity = sf::Vector2f(400.f, 250.f);
+			PongSim::step(m_sim, inputs, dt);
 		}
+		syncShapesFromSim();
 
 		// Check win conditions
-		if (m_leftScore >= m_winScore)
-		{
-			m_gameOver = true;
-			m_overlayText.setString("Player 1\nWins!\nPress Space to\nRestart");
-			auto bounds = m_overlayText.getLocalBounds();
-			sf::Vector2f origin(bounds.position.x + bounds.size.x / 2.f, bounds.position.y + bounds.size.y / 2.f);
-			m_overlayText.setOrigin(origin);
-			m_overlayText.setPosition(sf::Vector2f((float)ScreenSize::s_width / 2.f, (float)ScreenSize::s_height / 2.f));
-		}
-		else if (m_rightScore >= m_winScore)
+		if (m_sim.gameOver)
 		{
 			m_gameOver = true;
-			m_overlayText.setString("Player 2\nWins!\nPress Space to\nRestart");
-			auto bounds = m_overlayText.getLocalBounds();
-			sf::Vector2f origin(bounds.position.x + bounds.size.x / 2.f, bounds.position.y + bounds.size.y / 2.f);
-			m_overlayText.setOrigin(origin);
-			m_overlayText.setPosition(sf::Vector2f((float)ScreenSize::s_width / 2.f, (float)ScreenSize::s_height / 2.f));
+			showWinner(m_sim.leftScore > m_sim.rightScore, "Press Space to\nRestart");
 		}
 	}
 }
 
-void Game::render()
+void Game::render(float alpha)
 {
 	m_window.clear(sf::Color(0, 0, 0, 0));
 #ifdef TEST_FPS
@@ -584,14 +526,19 @@ void Game::render()
 			m_window.draw(m_modalTitle);
 			m_window.draw(m_modalHostBtn);
 			m_window.draw(m_modalJoinBtn);
+			m_window.draw(m_modalWatchBtn);
 			m_window.draw(m_modalHostText);
 			m_window.draw(m_modalJoinText);
+			m_window.draw(m_modalWatchText);
 			m_window.draw(m_modalStatusText);
 		}
 		m_window.display();
 		return;
 	}
 	
+	if (m_isHost || !m_isNetworkedGame)
+		interpolateShapes(alpha);
+
 	m_window.draw(m_centerLine);
 	m_window.draw(m_leftPaddle);
 	m_window.draw(m_rightPaddle);
@@ -603,9 +550,62 @@ void Game::render()
 		m_window.draw(m_overlayRect);
 		m_window.draw(m_overlayText);
 	}
+	if (m_showNetStats && m_isNetworkedGame)
+	{
+		m_window.draw(m_netStatsBackground);
+		m_window.draw(m_netStatsText);
+	}
 	m_window.display();
 }
 
+void Game::refreshNetStats()
+{
+	NetStats stats;
+	if (m_isHost)
+	{
+		if (!m_hostNet.getNetStats(m_guestSession, stats))
+			return;
+	}
+	else
+	{
+		stats = m_guestNet.getStats();
+	}
+
+	// Windows close once a second; nothing new to show until then
+	if (stats.getWindowCount() == m_netStatsWindow)
+		return;
+	m_netStatsWindow = stats.getWindowCount();
+
+	m_netStatsText.setString(std::string(m_isHost ? "Guest connection (F3)\n" : "Host connection (F3)\n") + stats.describe());
+	auto bounds = m_netStatsText.getLocalBounds();
+	m_netStatsBackground.setSize(sf::Vector2f(bounds.position.x + bounds.size.x + 16.f, bounds.position.y + bounds.size.y + 12.f));
+
+	if (m_netStatsCsv.is_open())
+	{
+		stats.writeCsvRow(m_netStatsCsv, m_isHost ? "guest" : "host");
+		m_netStatsCsv.flush();
+	}
+}
+
+void Game::toggleNetStatsCsv()
+{
+	if (m_netStatsCsv.is_open())
+	{
+		m_netStatsCsv.close();
+		LOG_INFO("Stopped writing network statistics to %s", NetStatsCsvPath);
+		return;
+	}
+
+	m_netStatsCsv.open(NetStatsCsvPath, std::ios::out | std::ios::trunc);
+	if (!m_netStatsCsv.is_open())
+	{
+		LOG_ERROR("Could not open %s for network statistics", NetStatsCsvPath);
+		return;
+	}
+	NetStats::writeCsvHeader(m_netStatsCsv);
+	LOG_INFO("Writing network statistics to %s once per second", NetStatsCsvPath);
+}
+
 void Game::multiplayerMode()
 {
 	m_isNetworkedGame = true;
@@ -631,10 +631,12 @@ void Game::waitingForClient()
 	m_modalStatusText.setString("Hosting on port " + std::to_string(hostPort) + "\nWaiting for client...");
 }
 
-void Game::waitingForHost()
+void Game::waitingForHost(bool spectate)
 {
     m_isNetworkedGame = true;
     m_isHost = false;
+    m_isSpectator = spectate;
+    m_guestNet.setSpectator(spectate);
     
     // Bind guest UDP socket on auto-assigned port
     if(!m_guestNet.bind(0))
@@ -646,13 +648,11 @@ void Game::waitingForHost()
         return;
     }
 
-    // First broadcast attempt
+    // Hear host beacons too, and broadcast FIND_HOST at once (then on a backoff from lookingForHost)
     const unsigned short discoveryPort = 54000;
-    m_guestNet.sendFindHost(discoveryPort);
-
-    // reset discovery timer so we can throttle subsequent broadcasts in JoiningLobby
-    m_discoveryClock.restart();
-    m_lastDiscovery = sf::Time::Zero;
+    m_guestNet.listenForBeacons(discoveryPort);
+    m_guestNet.restartDiscovery();
+    m_guestNet.sendFindHostIfDue(discoveryPort);
 
     m_sentHello = false; // reset handshake progress
 
@@ -666,11 +666,10 @@ void Game::waitingForHost()
 
 void Game::lookingForClient()
 {
-	//Listen for discovery broadcasts
-	m_hostNet.pollForDiscoveryRequests();
-
-	//Listen for HELLO handshakes from clients
-	if (m_hostNet.pollForHello()) {
+	//Answer discovery broadcasts and listen for HELLO handshakes from clients
+	m_hostNet.poll();
+	if (m_hostNet.acceptNewSession(m_guestSession)) {
+		m_netStatsWindow = 0;
 		// a client has connected
 		m_modalStatusText.setString("Client connected!");
 		m_state = GameState::Playing;
@@ -684,16 +683,14 @@ void Game::lookingForHost()
 {
     const unsigned short discoveryPort = 54000;
 
-    // Throttle discovery broadcast to once every 5 seconds while in JoiningLobby
+    // Route everything that arrived since last frame (HOST_HERE, HELLO_ACK, early gameplay packets)
+    m_guestNet.poll();
+
+    // Re-broadcast FIND_HOST on an exponential backoff (100 ms doubling to 2 s) while in JoiningLobby
     // Only broadcast while we haven't sent HELLO yet
     if (!m_sentHello)
     {
-        sf::Time now = m_discoveryClock.getElapsedTime();
-        if (now - m_lastDiscovery >= sf::seconds(5))
-        {
-            m_guestNet.sendFindHost(discoveryPort);
-            m_lastDiscovery = now;
-        }
+        m_guestNet.sendFindHostIfDue(discoveryPort);
     }
 
     IpAddress hostAddr{IpAddress::Any};
@@ -710,7 +707,7 @@ void Game::lookingForHost()
             m_modalStatusText.setOrigin(sf::Vector2f(sb.position.x + sb.size.x / 
                 2.f, sb.position.y + sb.size.y / 2.f));
 
-            //Send HELLO to host (only once)
+            //Send HELLO to host (re-sent below until HELLO_ACK arrives)
             if (!m_sentHello) {
                 m_guestNet.sendHello();
                 m_sentHello = true;
@@ -718,12 +715,25 @@ void Game::lookingForHost()
         }
     // Do NOT return here; keep polling for HELLO_ACK even if HOST_HERE wasnt received this frame
         else {
-            cout << "No host found yet.\n";
+            LOG_DEBUG_EVERY(1000, "No host found yet.");
             return; //No host found yet
         }
     }
     // Do NOT return here; keep polling for HELLO_ACK after HELLO was sent
 
+    //HELLO or HELLO_ACK may be lost: re-send HELLO until answered, or go back to discovery
+    if (m_sentHello && !m_guestNet.retryHelloIfDue()) {
+        m_sentHello = false;
+        // try the next host we know of, if any, and broadcast again right away
+        m_guestNet.forgetHost(m_guestNet.getHostAddress(), m_guestNet.getHostPort());
+        m_guestNet.restartDiscovery();
+        m_modalStatusText.setString("Host not responding. Searching...");
+        auto sb3 = m_modalStatusText.getLocalBounds();
+        m_modalStatusText.setOrigin(sf::Vector2f(sb3.position.x + sb3.size.x /
+            2.f, sb3.position.y + sb3.size.y / 2.f));
+        return;
+    }
+
     //Wait for HELLO_ACK from host (poll every frame after HELLO was sent)
     if (m_sentHello && m_guestNet.recieveHelloAck()) {
         // Successfully connected to host
@@ -734,9 +744,14 @@ void Game::lookingForHost()
 
         //Connection complete, start game
         m_state = GameState::Playing;
-        m_hasPrev = false;
-        m_hasCurr = false;
+        m_guestTick = 0;
+        m_snapshotBuffer.reset();
+        m_snapshotBuffer.setTickTime(sf::seconds(1.f / m_guestNet.getHostTickRate())); // HELLO_ACK said how fast the host ticks
+        m_snapshotBuffer.setAdaptive(true); // size the playout delay from this link's jitter
+        m_pendingScoreEvents.clear();
+        m_netStatsWindow = 0;
         resetGame();
+        m_paddlePredictor.reset(m_sim.rightPaddleY);
 
         m_showMultiplayerModal = false;
     }
@@ -744,81 +759,166 @@ void Game::lookingForHost()
 
 void Game::recieveNetworkState()
 {
+	// One drain routes snapshots, PING/PONG and reliable messages
+	m_guestNet.poll();
+
+	// Keep the RTT / jitter estimate fresh
+	m_guestNet.pingHostIfDue();
+
+	// Take every snapshot that arrived since last frame; the buffer orders them by host tick
+	// (read and timestamped by the I/O thread as they landed, not when this frame got to them)
 	NetLogicStates incoming;
-	if(!m_guestNet.recieveStateUpdate(incoming)) {
-		//No state received
-		return;
+	sf::Time arrival;
+	while (m_guestNet.recieveStateUpdate(incoming, arrival)) {
+		m_snapshotBuffer.insert(incoming, arrival);
+
+		// Newest host paddle position, replayed forward with the inputs it hasn't seen yet
+		m_paddlePredictor.reconcile(incoming.inputAckTick, incoming.p2Y);
 	}
 
-	// Only accept newer states
-	if (!m_hasCurr || incoming.seqNum > m_currState.seqNum) {
-		if (!m_hasCurr) {
-			// First packet: snap directly to incoming and initialize interpolation buffers
-			m_currState = incoming;
-			m_prevState = incoming;
-			m_hasCurr = true;
-			m_hasPrev = true;
-			m_interpAlpha = 0.f;
-
-			// Apply state immediately so guest view is consistent
-			m_leftPaddle.setPosition(sf::Vector2f(m_leftPaddle.getPosition().x, m_currState.p1Y));
-			m_rightPaddle.setPosition(sf::Vector2f(m_rightPaddle.getPosition().x, m_currState.p2Y));
-			m_ball.setPosition(sf::Vector2f(m_currState.ballX, m_currState.ballY));
-			m_leftScore = m_currState.p1Score;
-			m_rightScore = m_currState.p2Score;
-			m_leftScoreText.setString(std::to_string(m_leftScore));
-			m_rightScoreText.setString(std::to_string(m_rightScore));
-		} else {
-			// Normal path: advance buffers for interpolation
-			m_prevState = m_currState;
-			m_currState = incoming;
-			m_hasPrev = true;
-			m_hasCurr = true;
-			m_interpAlpha = 0.f; // reset interpolation alpha
-		}
+	// Playout delay follows the measured link jitter
+	m_snapshotBuffer.setLinkJitter(m_guestNet.getLink().getJitterMs());
+	m_guestNet.updateStats();
+
+	// Score changes arrive reliably and in order; hold them until playback catches up
+	ScoreEvent event;
+	while (m_guestNet.recieveScoreEvent(event)) {
+		m_pendingScoreEvents.push_back(event);
 	}
+	m_guestNet.flushReliable();
 }
 
-void Game::RecieveTransferPacket()
+void Game::applyDueScoreEvents()
 {
-	//---- Get guest input ----
-	int8_t guestInput = m_hostNet.recieveGuestInput();
-
-	//apply guest input to right paddle
-	//[guest input = -1 -> up , 1 -> down , 0 -> no input]
-	if (guestInput == 0) {
-		m_isNetP2Up = false;
-		m_isNetP2Down = false;
-	}
-	else if (guestInput == -1)
-	{
-		m_isNetP2Up = true;
-		m_isNetP2Down = false;
-	}
-	else if (guestInput == 1)
+	uint16_t playoutTick = m_snapshotBuffer.getPlayoutTick();
+	while (!m_pendingScoreEvents.empty() && !sequenceGreaterThan(m_pendingScoreEvents.front().tick, playoutTick))
 	{
-		m_isNetP2Down = true;
-		m_isNetP2Up = false;
+		const ScoreEvent& event = m_pendingScoreEvents.front();
+		m_leftScore = event.leftScore;
+		m_rightScore = event.rightScore;
+		m_leftScoreText.setString(std::to_string(m_leftScore));
+		m_rightScoreText.setString(std::to_string(m_rightScore));
+
+		// The host restarted the match
+		if (!event.gameOver)
+			m_gameOver = false;
+
+		// Check win conditions on guest side based on received scores
+		if (!m_gameOver && event.gameOver &&
+			(m_leftScore >= PongSim::WinScore || m_rightScore >= PongSim::WinScore)) {
+			m_gameOver = true;
+			showWinner(m_leftScore >= PongSim::WinScore, "Press Escape to\nReturn to Menu");
+		}
+
+		m_pendingScoreEvents.pop_front();
 	}
+}
 
+void Game::RecieveTransferPacket()
+{
+	//---- Drain guest inputs into the session's tick buffer ----
+	//(update() consumes them one per simulation tick; sendHostState() answers once per tick)
+	m_hostNet.poll();
+}
+
+void Game::sendHostState()
+{
 	//---- Build authoritative state packet ----
 	NetLogicStates state;
 	state.messageType = MessageTypes::STATE_UPDATE;
-	state.seqNum = m_seq++;
-	state.p1Y = m_leftPaddle.getPosition().y;
-	state.p2Y = m_rightPaddle.getPosition().y;
-	state.ballX = m_ball.getPosition().x;
-	state.ballY = m_ball.getPosition().y;
-	state.ballVelX = m_ballVelocity.x;
-	state.ballVelY = m_ballVelocity.y;
-	state.p1Score = m_leftScore;
-	state.p2Score = m_rightScore;
-
-	//---- Send authoritative state to guest ----
-	m_hostNet.sendStateUpdate(state);
+	state.tick = static_cast<uint16_t>(m_sim.tick);
+	state.p1Y = m_sim.leftPaddleY;
+	state.p2Y = m_sim.rightPaddleY;
+	state.ballX = m_sim.ballX;
+	state.ballY = m_sim.ballY;
+	state.ballVelX = m_sim.ballVelX;
+	state.ballVelY = m_sim.ballVelY;
+	state.p1Score = m_sim.leftScore;
+	state.p2Score = m_sim.rightScore;
+
+	//---- Encoded once for all spectators, before the guest's copy stamps its own sequence ----
+	bool sent = m_hostNet.sendSpectatorState(state);
+
+	//---- Send authoritative state to guest, if this tick is due one ----
+	sent = m_hostNet.sendStateUpdate(m_guestSession, state) || sent;
+	if (sent)
+		m_hostNet.flush();
+}
+
+void Game::showSnapshotScores(const NetLogicStates& view)
+{
+	int leftScore = static_cast<int>(view.p1Score);
+	int rightScore = static_cast<int>(view.p2Score);
+	if (leftScore == m_leftScore && rightScore == m_rightScore)
+		return;
+
+	m_leftScore = leftScore;
+	m_rightScore = rightScore;
+	m_leftScoreText.setString(std::to_string(m_leftScore));
+	m_rightScoreText.setString(std::to_string(m_rightScore));
+
+	// A restart sends the scores back to 0 - 0
+	m_gameOver = m_leftScore >= PongSim::WinScore || m_rightScore >= PongSim::WinScore;
+	if (m_gameOver)
+		showWinner(m_leftScore >= PongSim::WinScore, "Press Escape to\nReturn to Menu");
+}
+
+void Game::showWinner(bool leftWon, const char* instructions)
+{
+	m_overlayText.setString(std::string(leftWon ? "Player 1" : "Player 2") + "\nWins!\n" + instructions);
+	auto bounds = m_overlayText.getLocalBounds();
+	m_overlayText.setOrigin(sf::Vector2f(bounds.position.x + bounds.size.x / 2.f, bounds.position.y + bounds.size.y / 2.f));
+	m_overlayText.setPosition(sf::Vector2f((float)ScreenSize::s_width / 2.f, (float)ScreenSize::s_height / 2.f));
 }
 
-void Game::guestPaddleController()
+void Game::interpolateShapes(float alpha)
+{
+	// A point teleports the ball to the centre and a reset teleports everything; don't slide across the screen
+	bool blend = m_previousSim.tick + 1 == m_sim.tick &&
+		m_previousSim.leftScore == m_sim.leftScore && m_previousSim.rightScore == m_sim.rightScore;
+	const PongSimState& from = blend ? m_previousSim : m_sim;
+
+	m_leftPaddle.setPosition(sf::Vector2f(PongSim::LeftPaddleX, from.leftPaddleY + (m_sim.leftPaddleY - from.leftPaddleY) * alpha));
+	m_rightPaddle.setPosition(sf::Vector2f(PongSim::RightPaddleX, from.rightPaddleY + (m_sim.rightPaddleY - from.rightPaddleY) * alpha));
+	m_ball.setPosition(sf::Vector2f(from.ballX + (m_sim.ballX - from.ballX) * alpha, from.ballY + (m_sim.ballY - from.ballY) * alpha));
+}
+
+void Game::applyTickRate()
+{
+	// A guest follows its host's rate; this game hosts at PongSim::TickRate
+	double tickRate = !m_isNetworkedGame ? m_localTickRate
+		: m_isHost ? PongSim::TickRate : m_guestNet.getHostTickRate();
+	if (tickRate != m_timestep.getTickRate())
+		m_timestep.setTickRate(tickRate);
+}
+
+PongSimInputs Game::readLocalInputs() const
+{
+	PongSimInputs inputs;
+	if (!m_isNetworkedGame)
+	{
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::W))
+			inputs.left -= 1;
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S))
+			inputs.left += 1;
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Up))
+			inputs.right -= 1;
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Down))
+			inputs.right += 1;
+	}
+	else
+	{
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::W) ||
+			sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Up))
+			inputs.left -= 1;
+		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S) ||
+			sf::Keyboard::isKeyPressed(sf::Keyboard::Key::Down))
+			inputs.left += 1;
+	}
+	return inputs;
+}
+
+void Game::guestPaddleController(float dt)
 {
 	int8_t inputY = 0;
 
@@ -833,6 +933,10 @@ void Game::guestPaddleController()
 		inputY = 1;
 	}
 
-	m_guestNet.sendInput(inputY);
+	// Move our paddle now rather than a round trip later; the host's state corrects it if needed
+	if (!m_gameOver)
+		m_paddlePredictor.applyInput(m_guestTick, inputY, dt);
+
+	m_guestNet.sendInput(m_guestTick++, inputY, m_snapshotBuffer.getPlayoutTick());
 }
 
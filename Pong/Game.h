@@ -7,11 +7,18 @@
 #endif // _DEBUG
 
 #include <SFML/Graphics.hpp>
+#include <deque>
+#include <fstream>
 #include <string>
 #include <SFML/Network.hpp>
 
 #include "HostNetworkController.h"
 #include "GuestNetworkController.h"
+#include "FixedTimestep.h"
+#include "JitterBuffer.h"
+#include "LagCompensator.h"
+#include "PaddlePredictor.h"
+#include "PongSim.h"
 
 using namespace std;
 using namespace sf;
@@ -32,14 +39,6 @@ using namespace sf;
 ///		game.run();
 /// </summary>
 
-struct ScreenSize
-{
-public:
-	static const int s_width{ 1440 };
-
-	static const int s_height{ 900 };
-};
-
 enum class GameState
 {
 	MainMenu,
@@ -61,16 +60,14 @@ public:
 	/// @brief the main game loop.
 	/// 
 	/// A complete loop involves processing SFML events, updating and drawing all game objects.
-	/// The actual elapsed time for a single game loop is calculated. If this value is 
-	///  greater than the target time for one loop (1 / 60), then (and only then) is an update 
-	///  operation performed.
-	/// The target is at least one update and one render cycle per game loop, but typically 
-	///  more render than update operations will be performed as we expect our game loop to
-	///  complete in less than the target time.
+	/// FixedTimestep adds up the real elapsed time and runs one update per whole sim step
+	///  (1 / 60 s, or PONG_TICK_RATE in local play) that it covers, each with the exact step length.
+	/// Every loop renders once, blending the last two sim states by the part of a step left
+	///  over, so motion stays smooth whatever the display's refresh rate.
 	/// </summary>
 	void run();
 
-	void guestPaddleController();
+	void guestPaddleController(float dt);
 
 protected:
 	/// <summary>
@@ -80,14 +77,15 @@ protected:
 	/// <summary>
 	/// @brief Placeholder to perform updates to all game objects.
 	/// </summary>
-	/// <param name="time">update delta time</param>
-	void update(double dt);
+	/// <param name="dt">sim step length in seconds</param>
+	void update(float dt);
 
 	/// <summary>
 	/// @brief Draws the background and foreground game objects in the SFML window.
 	/// The render window is always cleared to black before anything is drawn.
 	/// </summary>
-	void render();
+	/// <param name="alpha">fraction of the next sim step already elapsed, for interpolation</param>
+	void render(float alpha);
 
 	/// <summary>
 	/// @brief Checks for events.
@@ -108,14 +106,67 @@ protected:
 	void resetGame();
 	void multiplayerMode(); // start multiplayer/network mode stub
 	void waitingForClient(); // after Host selected
-	void waitingForHost();   // after Join selected
+	void waitingForHost(bool spectate = false);   // after Join (or Watch) selected
 	void RecieveTransferPacket();
 
+	/// <summary>
+	/// @brief Sends the guest the state of the tick just stepped, when its snapshot rate has one due (host only).
+	/// </summary>
+	void sendHostState();
+
 	void lookingForClient();
 	void lookingForHost();
 
 	void recieveNetworkState();
 
+	/// <summary>
+	/// @brief Applies the SCORE_EVENTs whose host tick playback has reached (guest only).
+	/// </summary>
+	void applyDueScoreEvents();
+
+	/// <summary>
+	/// @brief Shows the scores carried in a played-back snapshot (spectator only; spectators get no SCORE_EVENTs).
+	/// </summary>
+	void showSnapshotScores(const NetLogicStates& view);
+
+	/// <summary>
+	/// @brief Copies the simulation state into the paddle/ball shapes and score texts.
+	/// </summary>
+	void syncShapesFromSim();
+
+	/// <summary>
+	/// @brief Places the paddles and ball between the previous and current sim state (local play and host).
+	/// Snaps to the current state when there is no previous step to blend from, e.g. after a point or a reset.
+	/// </summary>
+	void interpolateShapes(float alpha);
+
+	/// <summary>
+	/// @brief Local play steps at PONG_TICK_RATE if set. A host steps at PongSim::TickRate, and a guest
+	/// at the rate its host sent in HELLO_ACK, since both count input and snapshot ticks at the host's rate.
+	/// </summary>
+	void applyTickRate();
+
+	/// <summary>
+	/// @brief Keyboard state as this step's paddle inputs: W/S left and Up/Down right in local play,
+	/// either pair for the left paddle when hosting (the guest's input drives the right one).
+	/// </summary>
+	PongSimInputs readLocalInputs() const;
+
+	/// <summary>
+	/// @brief Centres the "Player N Wins!" overlay with the given instructions under it.
+	/// </summary>
+	void showWinner(bool leftWon, const char* instructions);
+
+	/// <summary>
+	/// @brief Picks up the connection's newest one-second NetStats window for the overlay and CSV.
+	/// </summary>
+	void refreshNetStats();
+
+	/// <summary>
+	/// @brief Starts or stops writing one NetStats row per second to NetStatsCsvPath.
+	/// </summary>
+	void toggleNetStatsCsv();
+
 	// Font used for all text
 	sf::Font m_arialFont{ "ASSETS/FONTS/ariblk.ttf" };
 	// main window
@@ -146,16 +197,22 @@ protected:
 	sf::RectangleShape m_modalRect;
 	sf::RectangleShape m_modalHostBtn;
 	sf::RectangleShape m_modalJoinBtn;
+	sf::RectangleShape m_modalWatchBtn;
 	sf::Text m_modalTitle{ m_arialFont };
 	sf::Text m_modalHostText{ m_arialFont };
 	sf::Text m_modalJoinText{ m_arialFont };
+	sf::Text m_modalWatchText{ m_arialFont };
 	sf::Text m_modalStatusText{ m_arialFont };
 
 	GameState m_state{ GameState::MainMenu };
 
-	// velocities
-	sf::Vector2f m_ballVelocity{ -400.f, -250.f };
-	float m_paddleSpeed{ 600.f };
+	// authoritative simulation (local play and host)
+	PongSimState m_sim;
+	PongSimState m_previousSim;	// state before the latest step, blended with m_sim when rendering
+
+	// fixed-step loop clock
+	FixedTimestep m_timestep{ PongSim::TickRate };
+	double m_localTickRate{ PongSim::TickRate };
 
 	// Scores
 	int m_leftScore{ 0 };
@@ -166,7 +223,6 @@ protected:
 
 	// game state
 	bool m_gameOver{ false };
-	int m_winScore{ 5 };
 
 #ifdef TEST_FPS
 	sf::Text x_updateFPS{ m_arialFont };	// text used to display updates per second.
@@ -176,31 +232,32 @@ protected:
 	int x_drawFrameCount{ 0 };							// draws per second counter.
 #endif // TEST_FPS
 
-	bool m_isNetP2Up{ false }; // is networked player 2 moving up
-	bool m_isNetP2Down{ false }; // is networked player 2 moving down
-
 	// network related variables
 	HostNetworkController m_hostNet;
 	bool m_isNetworkedGame{ false };
 	bool m_isHost{ false };
-	int m_seq{ 0 };
+	bool m_isSpectator{ false }; // joined to watch: no paddle, no input, scores read from snapshots
+	SessionId m_guestSession{ 0 };
+	LagCompensator m_lagCompensator; // re-judges guest paddle hits against what the guest saw
 	GuestNetworkController m_guestNet;
+	uint16_t m_guestTick{ 0 }; // guest simulation tick stamped on every GUEST_INPUT
+	PaddlePredictor m_paddlePredictor; // guest's own paddle, moved locally and reconciled with the host
 
 	//Interpolation variables
-	NetLogicStates m_prevState;
-	NetLogicStates m_currState;
-
-	bool m_hasPrev = false;
-	bool m_hasCurr = false;
-
-	float m_interpAlpha = 0.0f; // 0 -> using prev state , 1 -> using curr state
-
-	sf::Clock m_discoveryClock;
-	sf::Time  m_lastDiscovery{ sf::Time::Zero };
+	JitterBuffer m_snapshotBuffer{ sf::seconds(1.f / PongSim::TickRate) }; // host snapshots, played back behind the host
+	std::deque<ScoreEvent> m_pendingScoreEvents; // recieved reliably, waiting for playback to reach their tick
 
 	// discovery throttle
 	sf::Clock m_joiningLobbyClock;
 	sf::Time  m_lastJoinAttempt{ sf::Time::Zero };
 
 	bool m_sentHello{ false }; // set after we send HELLO, so we keep polling for HELLO_ACK
+
+	// network statistics overlay (F3) and per-second CSV dump (F4)
+	bool m_showNetStats{ false };
+	sf::RectangleShape m_netStatsBackground;
+	sf::Text m_netStatsText{ m_arialFont };
+	uint64_t m_netStatsWindow{ 0 }; // last NetStats window shown / written
+	std::ofstream m_netStatsCsv;
+	static constexpr const char* NetStatsCsvPath = "netstats.csv";
 };
@@ -1,245 +1,652 @@
 #include "GuestNetworkController.h"
-
-using namespace std;
+#include "AsyncLogger.h"
+#include <cstdlib>
 
 GuestNetworkController::GuestNetworkController()
-	: m_hostAddress(IpAddress::Any),
+	: m_recvBatch(DatagramSocket::BatchSize),
+	m_hostAddress(IpAddress::Any),
 	m_hostPort(0),
 	m_isConnected(false)
 {
-	m_socket.setBlocking(false);
+	if (!NetConditionerConfig::fromEnvironment(m_conditionerConfig) && std::getenv("PONG_NETEM"))
+		LOG_WARN("GuestNetworkController: Ignoring malformed PONG_NETEM");
+	if (!LobbyConfig::fromEnvironment(m_lobby) && std::getenv("PONG_LOBBY"))
+		LOG_WARN("GuestNetworkController: Ignoring malformed PONG_LOBBY");
 }
 
 bool GuestNetworkController::bind(unsigned short port)
 {
 	if (m_socket.bind(port) != sf::Socket::Status::Done) {
-		cout << "GuestNetworkController: Failed to bind on port " << port << endl;
+		LOG_ERROR("GuestNetworkController: Failed to bind on port %u", port);
 		return false;
 	}
-	cout << "GuestNetworkController: Bound on port " << m_socket.getLocalPort() << endl;
+	LOG_INFO("GuestNetworkController: Bound on port %u", m_socket.getLocalPort());
+
+	m_socket.setConditioner(m_conditionerConfig);
+	if (m_conditionerConfig.isEnabled())
+		LOG_INFO("GuestNetworkController: Conditioner %s", m_conditionerConfig.describe().c_str());
+
+	if (m_useIoThread && !m_socket.startIoThread())
+		LOG_WARN("GuestNetworkController: Could not start the I/O thread, reading from the game loop");
 	return true;
 }
 
 void GuestNetworkController::sendFindHost(unsigned short discoveryPort)
 {
-	// Build FIND_HOST packet (message type 1)
-	uint8_t msg = MessageTypes::FIND_HOST;
-
-	sf::Socket::Status status = m_socket.send(&msg, sizeof(msg), sf::IpAddress::Broadcast, discoveryPort);
+	// The lobby picks a host for us; without one, ask whoever hears the broadcast
+	sf::Socket::Status status = m_lobby.isEnabled()
+		? sendPacket(LobbyFindPacket(), m_lobby.address, m_lobby.port)
+		: sendPacket(FindHostPacket(), sf::IpAddress::Broadcast, discoveryPort);
 
 	if(status!= sf::Socket::Status::Done)
 	{
-		cout << "GuestNetworkController: Failed to send FIND_HOST (status "
-			<< static_cast<int>(status) << ")" << endl;
+		LOG_WARN("GuestNetworkController: Failed to send %s (status %d)", m_lobby.isEnabled() ? "LOBBY_FIND" : "FIND_HOST",
+			static_cast<int>(status));
 		return;
 	}
 }
 
-bool GuestNetworkController::recieveHostHere(sf::IpAddress& outAddress, unsigned short& outPort)
+bool GuestNetworkController::sendFindHostIfDue(unsigned short discoveryPort)
+{
+	uint32_t now = getTimeMs();
+	if (m_findHostDelayMs > 0 && now - m_lastFindHostMs < m_findHostDelayMs)
+		return false;
+
+	// A lost broadcast (or reply) is retried quickly; an empty LAN isn't flooded
+	sendFindHost(discoveryPort);
+	m_lastFindHostMs = now;
+	if (m_findHostDelayMs == 0)
+		m_findHostDelayMs = m_findHostInitialDelayMs;
+	else if (m_findHostDelayMs < m_findHostMaxDelayMs / 2)
+		m_findHostDelayMs *= 2;
+	else
+		m_findHostDelayMs = m_findHostMaxDelayMs;
+	return true;
+}
+
+void GuestNetworkController::restartDiscovery()
+{
+	m_findHostDelayMs = 0;
+}
+
+void GuestNetworkController::setDiscoveryBackoff(uint32_t initialDelayMs, uint32_t maxDelayMs)
+{
+	m_findHostInitialDelayMs = initialDelayMs > 0 ? initialDelayMs : 1;
+	m_findHostMaxDelayMs = maxDelayMs > m_findHostInitialDelayMs ? maxDelayMs : m_findHostInitialDelayMs;
+}
+
+bool GuestNetworkController::listenForBeacons(unsigned short discoveryPort)
 {
-	Buffer buffer;
-	Socket::Status status = m_socket.receive(buffer.data, sizeof(buffer.data), buffer.recieved, buffer.sender, buffer.senderPort);
+	if (m_listeningForBeacons)
+		return true;
 
-	// ---- ERROR CHECKS ----
-	if (status != Socket::Status::Done) {
+	unsigned short port = static_cast<unsigned short>(discoveryPort + BeaconPortOffset);
+	if (m_beaconSocket.bind(port) != sf::Socket::Status::Done)
+	{
+		LOG_INFO("GuestNetworkController: Beacon port %u is taken, finding hosts by FIND_HOST only", port);
 		return false;
 	}
+	m_beaconSocket.setConditioner(m_conditionerConfig);
+	m_listeningForBeacons = true;
+	return true;
+}
 
-	// Ignore packets that are too small to contain a type, or missing sender
-	if (!buffer.sender.has_value() || buffer.recieved < 1) {
-		return false;
+void GuestNetworkController::poll()
+{
+	// Every message the guest handles, routed from one drain
+	static constexpr MessageRoute<GuestNetworkController> Routes[] = {
+		{ MessageTypes::HOST_HERE, &GuestNetworkController::handleHostHere },
+		{ MessageTypes::LOBBY_ASSIGN, &GuestNetworkController::handleLobbyAssign },
+		{ MessageTypes::HELLO_ACK, &GuestNetworkController::handleHelloAck },
+		{ MessageTypes::STATE_UPDATE, &GuestNetworkController::handleState },
+		{ MessageTypes::STATE_DELTA, &GuestNetworkController::handleState },
+		{ MessageTypes::PING, &GuestNetworkController::handlePing },
+		{ MessageTypes::PONG, &GuestNetworkController::handlePong },
+		{ MessageTypes::RELIABLE, &GuestNetworkController::handleReliable }
+	};
+	static constexpr MessageRouter<GuestNetworkController> Router(Routes);
+
+	while (true)
+	{
+		size_t count = m_socket.receiveBatch(m_recvBatch.data(), m_recvBatch.size());
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Datagram& datagram = m_recvBatch[i];
+			if (datagram.size < 1)
+				continue;
+
+			uint8_t msgType = static_cast<uint8_t>(datagram.data[0]);
+
+			// Beacons and lobby replies come from anyone; everything else only from the host we chose,
+			//  so another host, or a stray sender, can't ack our HELLO or feed us snapshots
+			bool fromHost = m_hostPort != 0 && datagram.address == m_hostAddress && datagram.port == m_hostPort;
+			if (!fromHost && msgType != MessageTypes::HOST_HERE && msgType != MessageTypes::LOBBY_ASSIGN)
+			{
+				LOG_DEBUG("GuestNetworkController: Ignoring message type %u from " LOG_IPV4_FMT ":%u, not our host",
+					msgType, LOG_IPV4_ARGS(datagram.address), datagram.port);
+				continue;
+			}
+			m_stats.recordRecieved(msgType, datagram.size);
+
+			// Gameplay traffic from our host before its HELLO_ACK means the ack was lost. Only the ack
+			//  carries the host's tick rate, so ask for it again now rather than on the next retry
+			if (fromHost && !m_helloAcked && getTimeMs() - m_lastHelloMs >= HelloRetryMs &&
+				(msgType == MessageTypes::STATE_UPDATE || msgType == MessageTypes::STATE_DELTA ||
+				msgType == MessageTypes::PING || msgType == MessageTypes::RELIABLE))
+				sendHello();
+
+			// A copy of our own while on the group means the host missed the HELLO saying so; repeat it
+			if (fromHost && m_multicastHeard && msgType == MessageTypes::STATE_UPDATE && getTimeMs() - m_lastHelloMs >= HelloRetryMs)
+				sendHello();
+
+			if (!Router.dispatch(*this, datagram))
+				LOG_DEBUG("GuestNetworkController: Ignoring message type %u", msgType);
+		}
+
+		if (count < m_recvBatch.size())
+			break;
 	}
 
-	uint8_t msgType = buffer.data[0];
-	// Only handle HOST_HERE here; ignore other messages
-	if (msgType != MessageTypes::HOST_HERE) {
-		return false;
+	// Only HOST_HERE is expected on the beacon port
+	while (m_listeningForBeacons)
+	{
+		size_t count = m_beaconSocket.receiveBatch(m_recvBatch.data(), m_recvBatch.size());
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Datagram& datagram = m_recvBatch[i];
+			if (datagram.size >= 1 && static_cast<uint8_t>(datagram.data[0]) == MessageTypes::HOST_HERE)
+				handleHostHere(datagram);
+		}
+		if (count < m_recvBatch.size())
+			break;
 	}
 
-	// For HOST_HERE we require at least 3 bytes
-	if (buffer.recieved < 3) {
-		cout << "GuestNetworkController: Invalid HOST_HERE packet recieved" << endl;
-		return false;
+	// Only our host's snapshots count on the group; other hosts may share it
+	while (m_receivingMulticast)
+	{
+		size_t count = m_multicastSocket.receiveBatch(m_recvBatch.data(), m_recvBatch.size());
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Datagram& datagram = m_recvBatch[i];
+			if (datagram.size < 1 || datagram.address != m_hostAddress || datagram.port != m_hostPort)
+				continue;
+			uint8_t msgType = static_cast<uint8_t>(datagram.data[0]);
+			if (msgType != MessageTypes::STATE_UPDATE)
+				continue;
+			m_stats.recordRecieved(msgType, datagram.size);
+			m_helloAcked = true;
+			handleState(datagram);
+
+			// The group reaches us, so tell the host to stop sending us a copy of our own
+			if (!m_multicastHeard)
+			{
+				m_multicastHeard = true;
+				sendHello();
+			}
+		}
+		if (count < m_recvBatch.size())
+			break;
+	}
+
+	expireDiscoveredHosts();
+}
+
+void GuestNetworkController::handleHostHere(const Datagram& datagram)
+{
+	HostHerePacket hostHere;
+	if (!decodePacket(datagram.data, datagram.size, hostHere)) {
+		LOG_WARN("GuestNetworkController: Invalid HOST_HERE packet recieved");
+		return;
+	}
+	addDiscoveredHost(datagram.address, hostHere.gamePort);
+}
+
+void GuestNetworkController::handleLobbyAssign(const Datagram& datagram)
+{
+	if (!m_lobby.isEnabled() || datagram.address != m_lobby.address || datagram.port != m_lobby.port)
+		return;
+
+	LobbyAssignPacket assign;
+	if (!decodePacket(datagram.data, datagram.size, assign) || assign.gamePort == 0) {
+		LOG_WARN("GuestNetworkController: Invalid LOBBY_ASSIGN packet recieved");
+		return;
+	}
+	addDiscoveredHost(IpAddress(assign.hostAddress), assign.gamePort);
+}
+
+void GuestNetworkController::addDiscoveredHost(const IpAddress& address, unsigned short gamePort)
+{
+	// Remember every host, refreshed each time it answers or beacons
+	uint32_t now = getTimeMs();
+	bool known = false;
+	for (DiscoveredHost& host : m_discoveredHosts)
+	{
+		if (host.address == address && host.port == gamePort)
+		{
+			host.lastSeenMs = now;
+			known = true;
+			break;
+		}
+	}
+	if (!known)
+	{
+		DiscoveredHost host;
+		host.address = address;
+		host.port = gamePort;
+		host.lastSeenMs = now;
+		m_discoveredHosts.push_back(host);
+		LOG_INFO("GuestNetworkController: Discovered host " LOG_IPV4_FMT ":%u (%zu known)",
+			LOG_IPV4_ARGS(address), gamePort, m_discoveredHosts.size());
+	}
+
+	// Keep the newest answer until recieveHostHere() picks it up
+	m_hostHereAddress = address;
+	m_hostHerePort = gamePort;
+	m_hasHostHere = true;
+}
+
+void GuestNetworkController::expireDiscoveredHosts()
+{
+	uint32_t now = getTimeMs();
+	for (size_t i = 0; i < m_discoveredHosts.size();)
+	{
+		if (now - m_discoveredHosts[i].lastSeenMs > HostCacheMs)
+			m_discoveredHosts.erase(m_discoveredHosts.begin() + i);
+		else
+			++i;
+	}
+}
+
+void GuestNetworkController::forgetHost(const sf::IpAddress& address, unsigned short port)
+{
+	for (size_t i = 0; i < m_discoveredHosts.size(); ++i)
+	{
+		if (m_discoveredHosts[i].address == address && m_discoveredHosts[i].port == port)
+		{
+			m_discoveredHosts.erase(m_discoveredHosts.begin() + i);
+			break;
+		}
+	}
+
+	// Offer the most recently heard of the rest straight away
+	m_hasHostHere = false;
+	uint32_t newestMs = 0;
+	for (const DiscoveredHost& host : m_discoveredHosts)
+	{
+		if (m_hasHostHere && host.lastSeenMs < newestMs)
+			continue;
+		m_hostHereAddress = host.address;
+		m_hostHerePort = host.port;
+		m_hasHostHere = true;
+		newestMs = host.lastSeenMs;
 	}
+}
 
-	// ---- Extract host port (from bytes 1 and 2, big-endian) ----
-	uint8_t hi = static_cast<uint8_t>(buffer.data[1]);
-	uint8_t lo = static_cast<uint8_t>(buffer.data[2]);
-	unsigned short hostPort =
-		(static_cast<unsigned short>(hi) << 8) |
-		static_cast<unsigned short>(lo);
+bool GuestNetworkController::recieveHostHere(sf::IpAddress& outAddress, unsigned short& outPort)
+{
+	if (!m_hasHostHere)
+		return false;
+	m_hasHostHere = false;
 
-/*potential point of failure!*/ m_hostAddress = buffer.sender.value();
-	m_hostPort = hostPort;
+/*potential point of failure!*/ m_hostAddress = m_hostHereAddress;
+	m_hostPort = m_hostHerePort;
 
 	outAddress = m_hostAddress;
 	outPort = m_hostPort;
 
-	cout << "GuestNetworkController: Found host at "
-		<< m_hostAddress.toString() << ":" << m_hostPort << endl;
+	LOG_INFO("GuestNetworkController: Found host at " LOG_IPV4_FMT ":%u", LOG_IPV4_ARGS(m_hostAddress), m_hostPort);
 	return true;
 }
 
 void GuestNetworkController::sendHello()
 {
 	if (m_hostAddress == IpAddress::Any || m_hostPort == 0) {
-		cout << "GuestNetworkController: Cannot send HELLO - host address/port not set" << endl;
+		LOG_WARN("GuestNetworkController: Cannot send HELLO - host address/port not set");
 		return;
 	}
 
-	// Build HELLO packet (message type 3)
-	uint8_t buffer[3];
-	buffer[0] = MessageTypes::HELLO;
+	// Include our gameplay recieve port, and our role if we only watch
+	HelloPacket hello;
+	hello.guestPort = m_socket.getLocalPort();
+	hello.role = !m_isSpectator ? ROLE_PLAYER : m_multicastHeard ? ROLE_MULTICAST_SPECTATOR : ROLE_SPECTATOR;
 
-	// Include our gameplay recieve port (bytes 1 and 2, big-endian)
-	unsigned short guestPort = m_socket.getLocalPort();
-	buffer[1] = (guestPort >> 8) & 0xFF;
-	buffer[2] = guestPort & 0xFF;
+	m_lastHelloMs = getTimeMs();
+	m_helloAttempts++;
 
-	auto status = m_socket.send(buffer, sizeof(buffer), m_hostAddress, m_hostPort);
+	auto status = sendPacket(hello, m_hostAddress, m_hostPort, m_isSpectator);
 	if(status != Socket::Status::Done)
 	{
-		cout << "GuestNetworkController: Failed to send HELLO to "
-			<< m_hostAddress.toString() << ":" << m_hostPort << endl;
+		LOG_WARN("GuestNetworkController: Failed to send HELLO to " LOG_IPV4_FMT ":%u", LOG_IPV4_ARGS(m_hostAddress), m_hostPort);
 		return;
 	}
 	else
 	{
-		cout << "GuestNetworkController: Sent HELLO to "
-			<< m_hostAddress.toString() << ":" << m_hostPort << endl;
+		LOG_INFO("GuestNetworkController: Sent HELLO to " LOG_IPV4_FMT ":%u", LOG_IPV4_ARGS(m_hostAddress), m_hostPort);
 	}
 }
 
-bool GuestNetworkController::recieveHelloAck()
+bool GuestNetworkController::retryHelloIfDue()
 {
-	Buffer buffer;
-	Socket::Status status = m_socket.receive(buffer.data, sizeof(buffer.data), buffer.recieved, buffer.sender, buffer.senderPort);
-
-	// ---- ERROR CHECKS ----
-	if (status != Socket::Status::Done)
-		return false;
-	if (!buffer.sender.has_value() || buffer.recieved < 1)
+	if (m_isConnected)
+		return true;
+	if (getTimeMs() - m_lastHelloMs < HelloRetryMs)
+		return true;
+	if (m_helloAttempts >= MaxHelloAttempts)
 	{
-		cout << "GuestNetworkController: Invalid HELLO_ACK packet recieved" << endl;
+		LOG_WARN("GuestNetworkController: No HELLO_ACK after %d HELLOs, giving up", m_helloAttempts);
+		m_helloAttempts = 0;
 		return false;
 	}
 
-	uint8_t msgType = buffer.data[0];
-	if (msgType != MessageTypes::HELLO_ACK)
+	// HELLO or its HELLO_ACK was lost; the host answers every repeat, so just ask again
+	sendHello();
+	return true;
+}
+
+void GuestNetworkController::handleHelloAck(const Datagram& datagram)
+{
+	HelloAckPacket ack;
+	if (!decodePacket(datagram.data, datagram.size, ack))
+		return;
+	m_helloAcked = true;
+
+	// Step, stamp inputs and count snapshot ticks at the host's rate
+	if (ack.tickRate > 0 && static_cast<float>(ack.tickRate) != m_hostTickRate)
+	{
+		m_hostTickRate = static_cast<float>(ack.tickRate);
+		m_snapshotIntervalMs = 1000.f / m_hostTickRate;
+		m_stats.setSendIntervalMs(m_snapshotIntervalMs);
+		LOG_INFO("GuestNetworkController: Host ticks at %u Hz", ack.tickRate);
+	}
+
+	if (m_isSpectator && !m_receivingMulticast && hasOptional<HelloAckPacket>(datagram.size))
+		joinMulticastGroup(ack);
+}
+
+void GuestNetworkController::joinMulticastGroup(const HelloAckPacket& ack)
+{
+	IpAddress group(ack.multicastGroup);
+	if (!m_multicastSocket.bindMulticast(group, ack.multicastPort))
 	{
-		cout << "GuestNetworkController: Expected HELLO_ACK but recieved different message type" << endl;
-		return false;
+		LOG_WARN("GuestNetworkController: Could not join multicast group " LOG_IPV4_FMT ":%u, watching by unicast",
+			LOG_IPV4_ARGS(group), ack.multicastPort);
+		return;
 	}
+	m_multicastSocket.setConditioner(m_conditionerConfig);
+	m_receivingMulticast = true;
+	LOG_INFO("GuestNetworkController: Joined multicast group " LOG_IPV4_FMT ":%u", LOG_IPV4_ARGS(group), ack.multicastPort);
+}
+
+bool GuestNetworkController::recieveHelloAck()
+{
+	if (m_isConnected)
+		return true;
+	if (!m_helloAcked)
+		return false;
 
 	// Handshake complete
 	m_isConnected = true;
-	cout << "GuestNetworkController: Recieved HELLO_ACK from host "
-		<< m_hostAddress.toString() << ":" << m_hostPort
-		<< " -> connected!" << endl;
+	m_helloAttempts = 0;
+
+	// Free the beacon port for anyone else on this machine still looking
+	if (m_listeningForBeacons)
+	{
+		m_beaconSocket.unbind();
+		m_listeningForBeacons = false;
+	}
+	LOG_INFO("GuestNetworkController: Recieved HELLO_ACK from host " LOG_IPV4_FMT ":%u -> connected!", LOG_IPV4_ARGS(m_hostAddress), m_hostPort);
 	return true;
 }
 
-void GuestNetworkController::sendInput(int8_t inputY)
+void GuestNetworkController::sendInput(uint16_t tick, int8_t inputY, uint16_t viewTick)
 {
 	if(!m_isConnected) {
-		cout << "GuestNetworkController: Cannot send input - not connected to host" << endl;
+		LOG_WARN("GuestNetworkController: Cannot send input - not connected to host");
 		return;
 	}
+	if (m_isSpectator)
+		return;	// the host has no paddle for us
+
+	// Build GUEST_INPUT packet: guest simulation tick (the host slots the input by this) and input Y
+	GuestInputPacket packet;
+	packet.tick = tick;
+	packet.input = inputY;
+
+	// Newest snapshot recieved - lets the host delta against it.
+	// Host tick on screen when this input was made - lets the host judge hits as we saw them.
+	// Both left off until we have decoded a snapshot.
+	packet.ackSeq = m_latestSeq;
+	packet.viewTick = viewTick;
+
+	// Ticks are consecutive unless the game restarted; only repeat inputs from this run of ticks
+	if (m_sentInputCount > 0 && tick != static_cast<uint16_t>(m_lastInputTick + 1))
+		m_sentInputCount = 0;
+	int previousCount = m_sentInputCount < m_inputRedundancy ? m_sentInputCount : m_inputRedundancy;
+	packet.previousCount = static_cast<uint8_t>(previousCount);
+	for (int ago = 1; ago <= previousCount; ++ago)
+		packet.setPrevious(ago, m_sentInputs[static_cast<uint16_t>(tick - ago) % GuestInputPacket::MaxPrevious]);
+
+	m_sentInputs[tick % GuestInputPacket::MaxPrevious] = inputY;
+	m_lastInputTick = tick;
+	if (m_sentInputCount < GuestInputPacket::MaxPrevious)
+		m_sentInputCount++;
+
+	auto status = sendPacket(packet, m_hostAddress, m_hostPort, m_hasLatestSeq);
 
-	// Build GUEST_INPUT packet
-	uint8_t buffer[4];
-	buffer[0] = MessageTypes::GUEST_INPUT;
+	if(status != Socket::Status::Done)
+	{
+		LOG_WARN("GuestNetworkController: Failed to send GUEST_INPUT to " LOG_IPV4_FMT ":%u", LOG_IPV4_ARGS(m_hostAddress), m_hostPort);
+		return;
+	}
+}
+
+void GuestNetworkController::setInputRedundancy(int count)
+{
+	if (count < 0)
+		count = 0;
+	if (count > GuestInputPacket::MaxPrevious)
+		count = GuestInputPacket::MaxPrevious;
+	m_inputRedundancy = count;
+}
 
-	// Tick placeholder (0) - host currently doesn't use this
-	buffer[1] = 0;
-	buffer[2] = 0;
+void GuestNetworkController::handleState(const Datagram& datagram)
+{
+	// ---- Extract state (full snapshot, or delta against a snapshot we already decoded) ----
+	NetLogicStates decoded;
+	if (!SnapshotCodec::decode(reinterpret_cast<const uint8_t*>(datagram.data), datagram.size, m_history, m_quantization, decoded))
+	{
+		LOG_WARN("GuestNetworkController: Undecodable state packet recieved");
+		return;
+	}
 
-	// Input Y (byte 3)
-	buffer[3] = static_cast<uint8_t>(inputY);
+	// Consecutive snapshots show how many host ticks the host leaves between them
+	if (m_hasLatestSeq && decoded.seqNum == static_cast<uint16_t>(m_latestSeq + 1))
+	{
+		uint16_t ticks = static_cast<uint16_t>(decoded.tick - m_latestTick);
+		if (ticks > 0 && ticks <= MaxSnapshotSpacingTicks)
+		{
+			float intervalMs = ticks * 1000.f / m_hostTickRate;
+			m_snapshotIntervalMs += (intervalMs - m_snapshotIntervalMs) / 8.f;
+			m_stats.setSendIntervalMs(m_snapshotIntervalMs);
+		}
+	}
 
-	auto status = m_socket.send(buffer, sizeof(buffer), m_hostAddress, m_hostPort);
+	// seqNum counts the snapshots the host sent, so its gaps are losses
+	m_stats.recordSequence(decoded.seqNum, toMs(datagram.arrival));
 
-	if(status != Socket::Status::Done)
+	// Keep it as a future baseline and acknowledge it on the next GUEST_INPUT
+	m_history.store(decoded);
+	if (!m_hasLatestSeq || sequenceGreaterThan(decoded.seqNum, m_latestSeq))
 	{
-		cout << "GuestNetworkController: Failed to send GUEST_INPUT to "
-			<< m_hostAddress.toString() << ":" << m_hostPort << endl;
-		return;
+		m_latestSeq = decoded.seqNum;
+		m_latestTick = decoded.tick;
+		m_hasLatestSeq = true;
 	}
+
+	if (m_pendingStates.size() >= MaxPendingStates)
+		m_pendingStates.pop_front();
+	m_pendingStates.push_back({ decoded, datagram.arrival });
 }
 
-bool GuestNetworkController::recieveStateUpdate(NetLogicStates& state)
+bool GuestNetworkController::recieveStateUpdate(NetLogicStates& state, sf::Time& arrival)
 {
-	char buffer[64];
-	size_t recieved = 0;
-	optional<sf::IpAddress> sender;
-	unsigned short senderPort = 0;
+	if (m_pendingStates.empty())
+		return false;
 
-	Socket::Status status = m_socket.receive(buffer, sizeof(buffer), recieved, sender, senderPort);
+	state = m_pendingStates.front().state;
+	arrival = m_pendingStates.front().arrival;
+	m_pendingStates.pop_front();
+	return true;
+}
 
-	// ---- ERROR CHECKS ----
-	if (status != Socket::Status::Done)
+void GuestNetworkController::handleReliable(const Datagram& datagram)
+{
+	if (!m_reliable.recieve(datagram.data, datagram.size))
+		LOG_WARN("GuestNetworkController: Invalid RELIABLE packet recieved");
+}
+
+bool GuestNetworkController::recieveScoreEvent(ScoreEvent& event)
+{
+	std::vector<uint8_t> payload;
+	while (m_reliable.popDelivered(payload))
 	{
-		cout << "GuestNetworkController: No STATE_UPDATE recieved (status "
-			<< static_cast<int>(status) << ")" << endl;
-		return false;
+		// ---- Host tick, scores and game-over flag ----
+		if (!decodePacket(payload.data(), payload.size(), event))
+		{
+			LOG_WARN("GuestNetworkController: Unknown reliable message recieved");
+			continue;
+		}
+		return true;
 	}
+	return false;
+}
+
+void GuestNetworkController::flushReliable()
+{
+	if (!m_isConnected)
+		return;
+
+	uint32_t retransmitMs = m_link.getRetransmitTimeoutMs(ReliableChannel::DefaultRetransmitMs);
 
-	if (!sender.has_value() || recieved < 31) // 1 + 4 + 24 + 2 = 31 bytes minimum
+	// Built straight into the send queue; taken back if there is nothing to say
+	Datagram& datagram = m_socket.stageSend(m_hostAddress, m_hostPort);
+	datagram.size = m_reliable.buildPacket(getTimeMs(), retransmitMs, reinterpret_cast<uint8_t*>(datagram.data), sizeof(datagram.data));
+	if (datagram.size == 0)
 	{
-		cout << "GuestNetworkController: Invalid STATE_UPDATE packet recieved" << endl;
-		return false;
+		m_socket.cancelStaged();
+		return;
 	}
+	flushCounted(MessageTypes::RELIABLE, datagram.size);
+}
+
+void GuestNetworkController::pingHostIfDue()
+{
+	if (!m_isConnected)
+		return;
+
+	uint32_t now = getTimeMs();
+	if (m_hasPinged && now - m_lastPingMs < PingIntervalMs)
+		return;
+	m_lastPingMs = now;
+	m_hasPinged = true;
+
+	// Build PING packet: our clock
+	PingPacket ping;
+	ping.timeMs = now;
 
-	uint8_t msgType = buffer[0];
-	if (msgType != MessageTypes::STATE_UPDATE)
+	if (sendPacket(ping, m_hostAddress, m_hostPort) != Socket::Status::Done)
 	{
-		cout << "GuestNetworkController: Expected STATE_UPDATE but recieved different message type" << endl;
-		return false;
+		LOG_WARN("GuestNetworkController: Failed to send PING to " LOG_IPV4_FMT ":%u", LOG_IPV4_ARGS(m_hostAddress), m_hostPort);
 	}
+}
 
-	// ---- Extract state ----
-	size_t offset = 1;
+void GuestNetworkController::handlePing(const Datagram& datagram)
+{
+	PingPacket ping;
+	if (!decodePacket(datagram.data, datagram.size, ping))
+		return;
 
-	// Sequence number (4 bytes, big-endian)
-	uint32_t seq = 0;
-	seq |= (static_cast<uint8_t>(buffer[offset]) << 24);
-	seq |= (static_cast<uint8_t>(buffer[offset + 1]) << 16);
-	seq |= (static_cast<uint8_t>(buffer[offset + 2]) << 8);
-	seq |= static_cast<uint8_t>(buffer[offset + 3]);
-	offset += 4; // Advance past the 4-byte seqNum
+	// Echo the host's timestamp with ours
+	PongPacket reply;
+	reply.echoMs = ping.timeMs;
+	reply.timeMs = getTimeMs();
+	sendPacket(reply, m_hostAddress, m_hostPort);
+}
 
-	auto readFloat = [&](float& f) { // lambda to read float from 4 bytes
-		memcpy(&f, buffer + offset, sizeof(float));
-		offset += sizeof(float);
-		};
+void GuestNetworkController::handlePong(const Datagram& datagram)
+{
+	PongPacket pong;
+	if (!decodePacket(datagram.data, datagram.size, pong))
+		return;
 
-	// message size (1 byte) and seqNum (4 bytes)
-	state.messageType = msgType;
-	state.seqNum = static_cast<int>(seq);
+	// Our echoed PING time and the host's clock
+	m_link.addSample(pong.echoMs, pong.timeMs, toMs(datagram.arrival));
+}
 
-	// Floats (4 bytes each)
-	readFloat(state.p1Y);
-	readFloat(state.p2Y);
-	readFloat(state.ballX);
-	readFloat(state.ballY);
-	readFloat(state.ballVelX);
-	readFloat(state.ballVelY);
+void GuestNetworkController::updateStats()
+{
+	if (m_link.hasSample())
+		m_stats.setRtt(m_link.getRttMs());
+	m_stats.update(getTimeMs());
+}
 
-	// Scores (2 bytes)
-	state.p1Score = static_cast<uint8_t>(buffer[offset++]);
-	state.p2Score = static_cast<uint8_t>(buffer[offset++]);
+Socket::Status GuestNetworkController::flushCounted(uint8_t type, size_t size)
+{
+	// The guest sends as it goes; with the I/O thread this only hands the datagram over,
+	//  and a failure surfaces on a later send
+	if (m_socket.flush() > 0)
+		return Socket::Status::Error;
 
-	return true;
+	m_stats.recordSent(type, size);
+	return Socket::Status::Done;
 }
 
 void GuestNetworkController::reset()
 {
-	// Unbind and reset socket
+	// Stop the I/O thread, then unbind and reset socket
+	m_socket.stopIoThread();
 	m_socket.unbind();
 	m_socket.setBlocking(false);
+	m_socket.clearSendQueue();
+	m_beaconSocket.unbind();
+	m_beaconSocket.setBlocking(false);
+	m_listeningForBeacons = false;
+	m_multicastSocket.unbind();
+	m_multicastSocket.setBlocking(false);
+	m_receivingMulticast = false;
+	m_multicastHeard = false;
+
+	// Start discovery over
+	m_discoveredHosts.clear();
+	m_findHostDelayMs = 0;
 
 	// Reset host connection info
 	m_hostAddress = sf::IpAddress::Any;
 	m_hostPort = 0;
 	m_isConnected = false;
+
+	// Drop anything routed but not picked up
+	m_hasHostHere = false;
+	m_helloAcked = false;
+	m_pendingStates.clear();
+
+	// Forget delta baselines
+	m_history.clear();
+	m_latestSeq = 0;
+	m_hasLatestSeq = false;
+	m_latestTick = 0;
+	m_hostTickRate = PongSim::TickRate;
+	m_snapshotIntervalMs = 1000.f / m_hostTickRate;
+
+	// New session, new tick run
+	m_sentInputCount = 0;
+
+	// Forget the old link
+	m_helloAttempts = 0;
+	m_reliable.reset();
+	m_link.reset();
+	m_hasPinged = false;
+	m_stats.reset();
+	m_stats.setSendIntervalMs(m_snapshotIntervalMs);
 }
\ No newline at end of file
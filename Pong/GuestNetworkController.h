@@ -1,23 +1,108 @@
 #pragma once
-#include <iostream>
+#include <deque>
+#include <vector>
 #include <SFML/Network.hpp>
-#include "HostNetworkController.h"
+#include "DatagramSocket.h"
+#include "LinkEstimator.h"
+#include "LobbyConfig.h"
+#include "MessageRouter.h"
+#include "NetConditioner.h"
+#include "NetStats.h"
+#include "NetProtocol.h"
+#include "ReliableChannel.h"
+#include "SnapshotCodec.h"
+
+using namespace sf;
+
+// A host heard from through HOST_HERE, either answering FIND_HOST or as a beacon
+struct DiscoveredHost {
+	IpAddress address = IpAddress::Any;
+	unsigned short port = 0;	// gameplay port it reported
+	uint32_t lastSeenMs = 0;
+};
 
 class GuestNetworkController
 {
 public:
 	GuestNetworkController();
+	// Binds the socket, and hands it to an I/O thread unless setIoThread(false) was called first
 	bool bind(unsigned short port);
 
+	// Read and send on a dedicated I/O thread (default) or directly from poll() and the sends
+	void setIoThread(bool enabled) { m_useIoThread = enabled; }
+
+	// Impair traffic for testing (see NetConditioner.h). Defaults to the PONG_NETEM environment
+	//  variable; takes effect on the next bind()
+	void setNetConditioner(const NetConditionerConfig& config) { m_conditionerConfig = config; }
+
+	// Drain every pending datagram and route it:
+	//  HOST_HERE / LOBBY_ASSIGN -> discovered host, HELLO_ACK -> handshake, STATE_UPDATE/STATE_DELTA -> decoded snapshot queue,
+	//  PING -> PONG reply, PONG -> link estimate, RELIABLE -> reliable channel.
+	//  Only HOST_HERE and LOBBY_ASSIGN are taken from anyone; the rest is dropped unless it comes from the chosen host.
+	// Call once per frame before the recieve* calls below, which only read what it routed.
+	void poll();
+
 	//Discovery + Handshake
+	static const uint32_t FindHostInitialDelayMs = 100;
+	static const uint32_t FindHostMaxDelayMs = 2000;
+	// Broadcasts FIND_HOST to discoveryPort, or asks the lobby service when one is set
 	void sendFindHost(unsigned short discoveryPort);
+	// Broadcasts FIND_HOST on an exponential backoff: at once, then after the initial delay,
+	//  doubling up to the maximum. True if it sent one
+	bool sendFindHostIfDue(unsigned short discoveryPort);
+	// Starts the FIND_HOST schedule again from the first, immediate broadcast
+	void restartDiscovery();
+	// Backoff schedule (defaults FindHostInitialDelayMs / FindHostMaxDelayMs)
+	void setDiscoveryBackoff(uint32_t initialDelayMs, uint32_t maxDelayMs);
+	// Lobby service to ask for a host instead of broadcasting. Defaults to the PONG_LOBBY environment
+	//  variable; its LOBBY_ASSIGN is taken like a HOST_HERE from the host it names
+	void setLobby(const LobbyConfig& config) { m_lobby = config; }
+	const LobbyConfig& getLobby() const { return m_lobby; }
+	// Also hear hosts' HOST_HERE beacons, on discoveryPort + BeaconPortOffset. Only one process per
+	//  machine can hold that port; false if another already does (FIND_HOST still works)
+	bool listenForBeacons(unsigned short discoveryPort);
+	// Newest HOST_HERE since the last call; remembers that host for HELLO
 	bool recieveHostHere(sf::IpAddress& outAddress, unsigned short& outPort);
+	// Every host heard from in the last HostCacheMs, in the order they were first heard
+	const std::vector<DiscoveredHost>& getDiscoveredHosts() const { return m_discoveredHosts; }
+	// Drops a host that didn't answer HELLO; recieveHostHere() then offers the next one cached, if any
+	void forgetHost(const sf::IpAddress& address, unsigned short port);
+	// Join as a spectator: HELLO asks only to watch, and sendInput() sends nothing. If HELLO_ACK
+	//  names a multicast group, snapshots are read from it instead of sent to us one by one
+	void setSpectator(bool spectator) { m_isSpectator = spectator; }
+	bool isSpectator() const { return m_isSpectator; }
+	bool isReceivingMulticast() const { return m_multicastHeard; }
 	void sendHello();
+	static const uint32_t HelloRetryMs = 250;
+	static const int MaxHelloAttempts = 20;
+	// Re-sends HELLO every HelloRetryMs until HELLO_ACK; false once MaxHelloAttempts went unanswered
+	bool retryHelloIfDue();
+	// True once HELLO_ACK has been polled. Gameplay traffic from the host before it means the ack
+	//  was lost, and poll() repeats the HELLO straight away
 	bool recieveHelloAck();
+	// The host's tick rate from HELLO_ACK (PongSim::TickRate until then). A guest steps its sim,
+	//  numbers its inputs and spaces its playout at this rate
+	float getHostTickRate() const { return m_hostTickRate; }
 
 	//Gameplay traffic
-	void sendInput(int8_t inputY);
-	bool recieveStateUpdate(NetLogicStates& state);
+	void sendInput(uint16_t tick, int8_t inputY, uint16_t viewTick);
+	// How many previous inputs each GUEST_INPUT repeats (0 to GuestInputPacket::MaxPrevious, default all)
+	void setInputRedundancy(int count);
+	// Returns the next snapshot poll() decoded, oldest first; call until false to drain them.
+	// arrival is when it was read off the socket, on DatagramSocket::now().
+	bool recieveStateUpdate(NetLogicStates& state, sf::Time& arrival);
+
+	//Reliable control messages (delivered by poll())
+	bool recieveScoreEvent(ScoreEvent& event);
+	void flushReliable();	// send our acks (and anything due) to the host
+
+	//Link measurement
+	void pingHostIfDue();	// PING the host every PingIntervalMs while connected
+	const LinkEstimator& getLink() const { return m_link; }
+
+	//Traffic statistics for the host connection
+	void updateStats();	// closes the one-second window when due; call once per frame
+	const NetStats& getStats() const { return m_stats; }
 
 	//Host connection info
 	bool isConncected() const { return m_isConnected; }
@@ -28,10 +113,109 @@ public:
 	void reset();
 
 private:
-	UdpSocket m_socket;
+	DatagramSocket m_socket;
+	bool m_useIoThread{ true };
+	NetConditionerConfig m_conditionerConfig;
+	std::vector<Datagram> m_recvBatch;
+
+	// HOST_HERE beacons, read directly from poll() (no I/O thread of its own)
+	DatagramSocket m_beaconSocket;
+	bool m_listeningForBeacons{ false };
+
+	// Spectator snapshots from the host's multicast group, also read directly from poll()
+	bool m_isSpectator{ false };
+	DatagramSocket m_multicastSocket;
+	bool m_receivingMulticast{ false };	// joined the group named in HELLO_ACK
+	bool m_multicastHeard{ false };		// a snapshot came in on it; until then the host keeps a unicast copy
+	void joinMulticastGroup(const HelloAckPacket& ack);
 
 	IpAddress m_hostAddress;
 	unsigned short m_hostPort{ 0 };
 	bool m_isConnected{ false };
+
+	// Routed by poll(), waiting for the recieve* calls
+	bool m_hasHostHere{ false };
+	IpAddress m_hostHereAddress{ IpAddress::Any };
+	unsigned short m_hostHerePort{ 0 };
+	bool m_helloAcked{ false };
+
+	// Hosts heard from recently; one that stays quiet for HostCacheMs is dropped
+	static const uint32_t HostCacheMs = 5 * HostBeaconIntervalMs;
+	std::vector<DiscoveredHost> m_discoveredHosts;
+	void expireDiscoveredHosts();
+
+	LobbyConfig m_lobby;
+	void addDiscoveredHost(const IpAddress& address, unsigned short gamePort);
+
+	// FIND_HOST backoff (also paces LOBBY_FIND)
+	uint32_t m_findHostInitialDelayMs{ FindHostInitialDelayMs };
+	uint32_t m_findHostMaxDelayMs{ FindHostMaxDelayMs };
+	uint32_t m_findHostDelayMs{ 0 };	// wait before the next broadcast; 0 = send now
+	uint32_t m_lastFindHostMs{ 0 };
+
+	struct PendingState {
+		NetLogicStates state;
+		sf::Time arrival;
+	};
+	static const size_t MaxPendingStates = 64;	// oldest dropped beyond this if nobody drains them
+	std::deque<PendingState> m_pendingStates;
+
+	// Decoded snapshots, used as STATE_DELTA baselines
+	SnapshotHistory m_history;
+	SnapshotQuantization m_quantization;
+	uint16_t m_latestSeq{ 0 };	// newest snapshot decoded; acknowledged in every GUEST_INPUT
+	bool m_hasLatestSeq{ false };
+	uint16_t m_latestTick{ 0 };	// host tick of that snapshot
+
+	float m_hostTickRate{ PongSim::TickRate };
+
+	// Smoothed time between consecutive snapshots, from their host ticks; the host may send
+	//  fewer than one per tick, and the jitter estimate needs the real spacing
+	float m_snapshotIntervalMs{ 1000.f / PongSim::TickRate };
+	static const uint16_t MaxSnapshotSpacingTicks = 30;	// wider gaps are a stalled host, not its send rate
+
+	void handleHostHere(const Datagram& datagram);
+	void handleLobbyAssign(const Datagram& datagram);
+	void handleHelloAck(const Datagram& datagram);
+	void handleState(const Datagram& datagram);
+	void handlePing(const Datagram& datagram);
+	void handlePong(const Datagram& datagram);
+	void handleReliable(const Datagram& datagram);
+
+	// Encodes a schema packet straight into the send queue and sends it, counted in m_stats
+	template <typename Packet>
+	Socket::Status sendPacket(const Packet& packet, const IpAddress& address, unsigned short port, bool withOptional = true);
+	// Sends the staged datagram and counts it in m_stats
+	Socket::Status flushCounted(uint8_t type, size_t size);
+
+	// Milliseconds on the guest clock, as carried in PING/PONG; the clock datagrams are stamped on
+	static uint32_t getTimeMs() { return toMs(DatagramSocket::now()); }
+	static uint32_t toMs(sf::Time time) { return static_cast<uint32_t>(time.asMilliseconds()); }
+
+	// Inputs already sent, by tick, repeated in the next GUEST_INPUTs
+	int8_t m_sentInputs[GuestInputPacket::MaxPrevious] = {};
+	uint16_t m_lastInputTick{ 0 };
+	int m_sentInputCount{ 0 };	// consecutive ticks held, up to MaxPrevious
+	int m_inputRedundancy{ GuestInputPacket::MaxPrevious };
+
+	uint32_t m_lastHelloMs{ 0 };
+	int m_helloAttempts{ 0 };
+
+	ReliableChannel m_reliable;
+
+	LinkEstimator m_link;
+	uint32_t m_lastPingMs{ 0 };
+	bool m_hasPinged{ false };
+
+	NetStats m_stats;
 };
 
+template <typename Packet>
+Socket::Status GuestNetworkController::sendPacket(const Packet& packet, const IpAddress& address, unsigned short port, bool withOptional)
+{
+	static_assert(PacketLayout<Packet>::MaxSize <= Datagram::MaxSize, "packet larger than a datagram");
+
+	Datagram& datagram = m_socket.stageSend(address, port);
+	datagram.size = encodePacket(packet, datagram.data, sizeof(datagram.data), withOptional);
+	return flushCounted(Packet::Type, datagram.size);
+}
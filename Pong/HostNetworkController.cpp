@@ -1,215 +1,709 @@
 #include "HostNetworkController.h"
-#include <iostream>
+#include "AsyncLogger.h"
+#include <cmath>
+#include <cstdlib>
+#include <optional>
 
-using namespace std;
+bool SpectatorMulticastConfig::parse(const std::string& spec, SpectatorMulticastConfig& out)
+{
+	size_t colon = spec.find(':');
+	if (colon == std::string::npos)
+		return false;
+
+	std::optional<IpAddress> group = IpAddress::resolve(spec.substr(0, colon));
+	int port = std::atoi(spec.c_str() + colon + 1);
+	if (!group || (group->toInteger() >> 28) != 0xE || port <= 0 || port > 65535)
+		return false;
 
-HostNetworkController::HostNetworkController() 
-	: m_guestAddress(IpAddress::Any),
-	m_guestPort(0), 
-	m_hasGuest(false), 
-	m_latestGuestInput(0)
+	out.group = *group;
+	out.port = static_cast<unsigned short>(port);
+	return true;
+}
+
+bool SpectatorMulticastConfig::fromEnvironment(SpectatorMulticastConfig& out)
 {
-	m_socket.setBlocking(false);
+	const char* spec = std::getenv("PONG_SPECTATOR_GROUP");
+	if (spec == nullptr || *spec == '\0')
+		return false;
+	return parse(spec, out);
+}
+
+std::string SpectatorMulticastConfig::describe() const
+{
+	if (!isEnabled())
+		return "unicast";
+	return group.toString() + ":" + std::to_string(port);
+}
+
+HostNetworkController::HostNetworkController()
+	: m_recvBatch(DatagramSocket::BatchSize)
+{
+	if (!NetConditionerConfig::fromEnvironment(m_conditionerConfig) && std::getenv("PONG_NETEM"))
+		LOG_WARN("HostNetworkController: Ignoring malformed PONG_NETEM");
+	if (!SnapshotRateConfig::fromEnvironment(m_snapshotRate) && std::getenv("PONG_SNAPSHOT_RATE"))
+		LOG_WARN("HostNetworkController: Ignoring malformed PONG_SNAPSHOT_RATE");
+	if (!SpectatorMulticastConfig::fromEnvironment(m_multicast) && std::getenv("PONG_SPECTATOR_GROUP"))
+		LOG_WARN("HostNetworkController: Ignoring malformed PONG_SPECTATOR_GROUP");
+	if (!LobbyConfig::fromEnvironment(m_lobby) && std::getenv("PONG_LOBBY"))
+		LOG_WARN("HostNetworkController: Ignoring malformed PONG_LOBBY");
+	m_spectatorSnapshots.configure(m_snapshotRate, m_tickRateHz);
+}
+
+void HostNetworkController::setSnapshotRate(const SnapshotRateConfig& config, float tickRateHz)
+{
+	m_snapshotRate = config;
+	m_tickRateHz = tickRateHz;
+	for (auto& entry : m_sessions)
+		entry.second.snapshots.configure(m_snapshotRate, m_tickRateHz);
+
+	// Spectators send no loss reports, so an adaptive rate stays at its maximum for them
+	m_spectatorSnapshots.configure(m_snapshotRate, m_tickRateHz);
 }
 
 bool HostNetworkController::bind(unsigned short port)
 {
 	if (m_socket.bind(port) != sf::Socket::Status::Done) {
-		cout << "HostNetworkController: Failed to bind on port " << port << endl;
+		LOG_ERROR("HostNetworkController: Failed to bind on port %u", port);
 		return false;
 	}
-	cout << "HostNetworkController: Bound on port " << m_socket.getLocalPort() << endl;
+	LOG_INFO("HostNetworkController: Bound on port %u, snapshots at %s", m_socket.getLocalPort(), m_snapshotRate.describe().c_str());
+
+	m_socket.setConditioner(m_conditionerConfig);
+	if (m_conditionerConfig.isEnabled())
+		LOG_INFO("HostNetworkController: Conditioner %s", m_conditionerConfig.describe().c_str());
+	if (m_multicast.isEnabled())
+		LOG_INFO("HostNetworkController: Spectator snapshots multicast to %s", m_multicast.describe().c_str());
+	if (m_lobby.isEnabled())
+		LOG_INFO("HostNetworkController: Registering with lobby %s", m_lobby.describe().c_str());
+
+	if (m_useIoThread && !m_socket.startIoThread())
+		LOG_WARN("HostNetworkController: Could not start the I/O thread, reading from the game loop");
 	return true;
 }
 
-void HostNetworkController::pollForDiscoveryRequests()
+SessionId HostNetworkController::makeSessionId(const IpAddress& address, unsigned short port)
 {
-	// Discovery replies are handled in pollForHello()'s drain loop to avoid consuming HELLO packets here.
-	return;
+	return (static_cast<SessionId>(address.toInteger()) << 16) | port;
 }
 
-bool HostNetworkController::pollForHello()
+void HostNetworkController::poll()
 {
-	// only proceed if we haven't accepted a guest yet
-	if (m_hasGuest)
-		return false;
-
-	// Drain all pending packets to catch HELLO even amid other traffic
+	// Every message the host handles, routed from one drain
+	static constexpr MessageRoute<HostNetworkController> Routes[] = {
+		{ MessageTypes::FIND_HOST, &HostNetworkController::handleFindHost },
+		{ MessageTypes::HELLO, &HostNetworkController::handleHello },
+		{ MessageTypes::GUEST_INPUT, &HostNetworkController::handleGuestInput },
+		{ MessageTypes::PING, &HostNetworkController::handlePing },
+		{ MessageTypes::PONG, &HostNetworkController::handlePong },
+		{ MessageTypes::RELIABLE, &HostNetworkController::handleReliable }
+	};
+	static constexpr MessageRouter<HostNetworkController> Router(Routes);
+
+	// Drain all pending packets so no guest's traffic waits behind another's
 	while (true)
 	{
-		char data[32];
-		size_t recieved = 0;
-		std::optional<sf::IpAddress> sender;
-		unsigned short senderPort = 0;
+		size_t count = m_socket.receiveBatch(m_recvBatch.data(), m_recvBatch.size());
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Datagram& datagram = m_recvBatch[i];
+			if (datagram.size < 1)
+			{
+				// malformed packet, continue draining
+				continue;
+			}
 
-		auto status = m_socket.receive(data, sizeof(data), recieved, sender, senderPort);
+			SessionId id = makeSessionId(datagram.address, datagram.port);
+			auto session = m_sessions.find(id);
+			if (session != m_sessions.end())
+			{
+				// Any packet from the guest (inputs, PONGs, reliable acks) keeps its session open
+				session->second.lastHeardMs = toMs(datagram.arrival);
+				session->second.stats.recordRecieved(static_cast<uint8_t>(datagram.data[0]), datagram.size);
+			}
+			else if (!m_spectators.empty())
+			{
+				// Any packet from a spectator (its PINGs, normally) keeps it on the list
+				auto spectator = m_spectators.find(id);
+				if (spectator != m_spectators.end())
+					spectator->second.lastHeardMs = toMs(datagram.arrival);
+			}
 
-		if (status != Socket::Status::Done)
+			// Types without a route are not for the host; ignore and continue draining
+			Router.dispatch(*this, datagram);
+		}
+
+		if (count < m_recvBatch.size())
 		{
 			// No more packets to read this frame
-			return false;
+			break;
 		}
-		if (!sender.has_value() || recieved < 1)
+	}
+
+	sendPings();
+	sendBeaconIfDue();
+	sendLobbyRegisterIfDue();
+	expireSessions();
+	expireSpectators();
+	updateStats();
+
+	// Discovery, handshake and ping replies go out straight away
+	flush();
+}
+
+void HostNetworkController::handlePing(const Datagram& datagram)
+{
+	PingPacket ping;
+	if (!decodePacket(datagram.data, datagram.size, ping))
+		return;
+
+	// ---- Echo the guest's timestamp with ours ----
+	PongPacket reply;
+	reply.echoMs = ping.timeMs;
+	reply.timeMs = getTimeMs();
+
+	auto it = m_sessions.find(makeSessionId(datagram.address, datagram.port));
+	if (it != m_sessions.end())
+		queuePacket(it->second, reply);
+	else
+		queuePacket(datagram.address, datagram.port, reply);
+}
+
+void HostNetworkController::handlePong(const Datagram& datagram)
+{
+	PongPacket pong;
+	if (!decodePacket(datagram.data, datagram.size, pong))
+		return;
+
+	auto it = m_sessions.find(makeSessionId(datagram.address, datagram.port));
+	if (it == m_sessions.end())
+		return;
+
+	// ---- Our echoed PING time and the guest's clock ----
+	it->second.link.addSample(pong.echoMs, pong.timeMs, toMs(datagram.arrival));
+}
+
+void HostNetworkController::handleReliable(const Datagram& datagram)
+{
+	auto it = m_sessions.find(makeSessionId(datagram.address, datagram.port));
+	if (it == m_sessions.end())
+		return;
+
+	ReliableChannel& channel = it->second.reliable;
+	if (!channel.recieve(datagram.data, datagram.size))
+	{
+		LOG_WARN("HostNetworkController: Invalid RELIABLE packet recieved");
+		return;
+	}
+
+	// Guests don't send reliable messages yet; this only carries their acks
+	std::vector<uint8_t> payload;
+	while (channel.popDelivered(payload)) {}
+}
+
+void HostNetworkController::announceScore(SessionId id, const PongSimState& sim)
+{
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+		return;
+	GuestSession& session = it->second;
+
+	ScoreEvent event;
+	event.tick = static_cast<uint16_t>(sim.tick);
+	event.leftScore = static_cast<uint8_t>(sim.leftScore);
+	event.rightScore = static_cast<uint8_t>(sim.rightScore);
+	event.gameOver = sim.gameOver;
+
+	if (session.hasSentScore && event.leftScore == session.lastScore.leftScore &&
+		event.rightScore == session.lastScore.rightScore && event.gameOver == session.lastScore.gameOver)
+		return;
+
+	// Build SCORE_EVENT payload
+	uint8_t payload[PacketLayout<ScoreEvent>::MaxSize];
+	size_t size = encodePacket(event, payload, sizeof(payload));
+
+	if (!session.reliable.send(payload, size))
+	{
+		LOG_WARN("HostNetworkController: Reliable window full, SCORE_EVENT not queued");
+		return;
+	}
+	session.lastScore = event;
+	session.hasSentScore = true;
+}
+
+void HostNetworkController::serviceReliableChannels()
+{
+	uint32_t now = getTimeMs();
+
+	for (auto& entry : m_sessions)
+	{
+		GuestSession& session = entry.second;
+		uint32_t retransmitMs = session.link.getRetransmitTimeoutMs(ReliableChannel::DefaultRetransmitMs);
+
+		// Built straight into the send queue; taken back if there is nothing to say
+		Datagram& datagram = m_socket.stageSend(session.address, session.port);
+		datagram.size = session.reliable.buildPacket(now, retransmitMs, reinterpret_cast<uint8_t*>(datagram.data), sizeof(datagram.data));
+		if (datagram.size == 0)
 		{
-			// malformed packet, continue draining
+			m_socket.cancelStaged();
 			continue;
 		}
+		session.stats.recordSent(MessageTypes::RELIABLE, datagram.size);
+	}
+}
 
-		uint8_t msgType = data[0];
+void HostNetworkController::sendPings()
+{
+	uint32_t now = getTimeMs();
+	for (auto& entry : m_sessions)
+	{
+		GuestSession& session = entry.second;
+		if (now - session.lastPingMs < PingIntervalMs)
+			continue;
+		session.lastPingMs = now;
 
-		// Handle discovery requests inline to avoid a separate consumer that could eat HELLO
-		if (msgType == MessageTypes::FIND_HOST)
-		{
-			uint8_t reply[3];
-			reply[0] = MessageTypes::HOST_HERE; // HOST_HERE
-			reply[1] = (m_socket.getLocalPort() >> 8) & 0xFF;
-			reply[2] = m_socket.getLocalPort() & 0xFF;
+		PingPacket ping;
+		ping.timeMs = now;
+		queuePacket(session, ping);
+	}
+}
 
-			auto sendStatus = m_socket.send(reply, sizeof(reply), sender.value(), senderPort);
-			if(sendStatus != Socket::Status::Done)
-			{
-				cout << "HostNetworkController: Failed to send HOST_HERE reply to "
-					<< sender->toString() << ":" << senderPort << endl;
-			}
-			else
-			{
-				cout << "HostNetworkController: Recieved FIND_HOST from "
-					<< sender->toString() << ":" << senderPort
-					<< " -> sent HOST_HERE" << endl;
-			}
-			continue; // continue draining for HELLO
+void HostNetworkController::sendBeaconIfDue()
+{
+	if (m_beaconIntervalMs == 0 || m_sessions.size() >= m_maxSessions)
+		return;
+	uint32_t now = getTimeMs();
+	if (m_hasBeaconed && now - m_lastBeaconMs < m_beaconIntervalMs)
+		return;
+	m_lastBeaconMs = now;
+	m_hasBeaconed = true;
+
+	// The same reply FIND_HOST gets, unasked, to every guest listening on the beacon port
+	unsigned short port = m_socket.getLocalPort();
+	HostHerePacket beacon;
+	beacon.gamePort = port;
+	queuePacket(IpAddress::Broadcast, static_cast<unsigned short>(port + BeaconPortOffset), beacon);
+}
+
+void HostNetworkController::sendLobbyRegisterIfDue()
+{
+	if (!m_lobby.isEnabled())
+		return;
+
+	// A changed load goes out at once, so the lobby stops sending guests to a host that just filled up
+	uint32_t now = getTimeMs();
+	if (m_hasReportedToLobby && m_sessions.size() == m_lastReportedLoad && now - m_lastLobbyReportMs < LobbyHeartbeatMs)
+		return;
+	m_lastLobbyReportMs = now;
+	m_lastReportedLoad = m_sessions.size();
+	m_hasReportedToLobby = true;
+
+	sendLobbyRegister(static_cast<uint16_t>(m_maxSessions < 0xFFFF ? m_maxSessions : 0xFFFF));
+}
+
+void HostNetworkController::sendLobbyRegister(uint16_t capacity)
+{
+	LobbyRegisterPacket report;
+	report.gamePort = m_socket.getLocalPort();
+	report.capacity = capacity;
+	report.load = static_cast<uint16_t>(m_sessions.size() < 0xFFFF ? m_sessions.size() : 0xFFFF);
+	queuePacket(m_lobby.address, m_lobby.port, report);
+}
+
+void HostNetworkController::updateStats()
+{
+	uint32_t now = getTimeMs();
+	for (auto& entry : m_sessions)
+	{
+		GuestSession& session = entry.second;
+		if (session.link.hasSample())
+			session.stats.setRtt(session.link.getRttMs());
+		if (session.stats.update(now))
+			session.snapshots.onWindow(session.stats.getLastWindow());
+	}
+}
+
+bool HostNetworkController::getLinkEstimate(SessionId id, LinkEstimator& out) const
+{
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+		return false;
+	out = it->second.link;
+	return true;
+}
+
+bool HostNetworkController::getNetStats(SessionId id, NetStats& out) const
+{
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+		return false;
+	out = it->second.stats;
+	return true;
+}
+
+bool HostNetworkController::getInputStats(SessionId id, InputBufferStats& out) const
+{
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+		return false;
+	out = it->second.inputs.getStats();
+	return true;
+}
+
+float HostNetworkController::getSnapshotRateHz(SessionId id) const
+{
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+		return 0.f;
+	return it->second.snapshots.getRateHz();
+}
+
+void HostNetworkController::handleFindHost(const Datagram& datagram)
+{
+	HostHerePacket reply;
+	reply.gamePort = m_socket.getLocalPort();
+	queuePacket(datagram.address, datagram.port, reply);
+	LOG_INFO("HostNetworkController: Recieved FIND_HOST from " LOG_IPV4_FMT ":%u -> sent HOST_HERE",
+		LOG_IPV4_ARGS(datagram.address), datagram.port);
+}
+
+void HostNetworkController::handleHello(const Datagram& datagram)
+{
+	// The HELLO packet should contain the gameplay recieve port for the guest
+	HelloPacket hello;
+	if (!decodePacket(datagram.data, datagram.size, hello))
+	{
+		LOG_WARN("HostNetworkController: Invalid HELLO packet recieved");
+		return;
+	}
+	if (hello.role != ROLE_PLAYER)
+	{
+		addSpectator(datagram.address, hello);
+		return;
+	}
+	unsigned short guestPort = hello.guestPort;
+
+	SessionId id = makeSessionId(datagram.address, guestPort);
+	bool isNewSession = m_sessions.count(id) == 0;
+
+	// A repeated HELLO from a known guest only gets its HELLO_ACK re-sent
+	if (isNewSession && m_sessions.size() >= m_maxSessions)
+	{
+		LOG_WARN("HostNetworkController: Session table full, ignoring HELLO from " LOG_IPV4_FMT ":%u",
+			LOG_IPV4_ARGS(datagram.address), guestPort);
+		return;
+	}
+
+	if (isNewSession)
+	{
+		GuestSession session;
+		session.address = datagram.address;
+		session.port = guestPort;
+		session.snapshots.configure(m_snapshotRate, m_tickRateHz);
+		session.lastHeardMs = getTimeMs();
+		m_sessions.emplace(id, session);
+		m_newSessions.push_back(id);
+	}
+
+	// ---- Send HELLO_ACK with our tick rate (players get no multicast group) ----
+	HelloAckPacket ack;
+	ack.tickRate = static_cast<uint16_t>(std::lround(m_tickRateHz));
+	queuePacket(m_sessions[id], ack, false);
+
+	if (!isNewSession)
+		return;
+
+	LOG_INFO("HostNetworkController: Guest connected from " LOG_IPV4_FMT ":%u -> HELLO_ACK sent (%zu sessions)",
+		LOG_IPV4_ARGS(datagram.address), guestPort, m_sessions.size());
+}
+
+void HostNetworkController::addSpectator(const IpAddress& address, const HelloPacket& hello)
+{
+	SessionId id = makeSessionId(address, hello.guestPort);
+	auto it = m_spectators.find(id);
+
+	// A repeated HELLO only updates how the spectator listens, and gets its HELLO_ACK re-sent
+	if (it == m_spectators.end())
+	{
+		if (m_spectators.size() >= m_maxSpectators)
+		{
+			LOG_WARN("HostNetworkController: Spectator list full, ignoring HELLO from " LOG_IPV4_FMT ":%u",
+				LOG_IPV4_ARGS(address), hello.guestPort);
+			return;
 		}
 
-		if (msgType != MessageTypes::HELLO)
+		SpectatorSession spectator;
+		spectator.address = address;
+		spectator.port = hello.guestPort;
+		it = m_spectators.emplace(id, spectator).first;
+		LOG_INFO("HostNetworkController: Spectator joined from " LOG_IPV4_FMT ":%u (%zu watching)",
+			LOG_IPV4_ARGS(address), hello.guestPort, m_spectators.size());
+	}
+	it->second.multicast = hello.role == ROLE_MULTICAST_SPECTATOR && m_multicast.isEnabled();
+	it->second.lastHeardMs = getTimeMs();
+
+	// ---- Send HELLO_ACK, naming the group if there is one ----
+	HelloAckPacket ack;
+	ack.tickRate = static_cast<uint16_t>(std::lround(m_tickRateHz));
+	ack.multicastGroup = m_multicast.group.toInteger();
+	ack.multicastPort = m_multicast.port;
+	queuePacket(address, hello.guestPort, ack, m_multicast.isEnabled());
+}
+
+void HostNetworkController::expireSpectators()
+{
+	uint32_t now = getTimeMs();
+	for (auto it = m_spectators.begin(); it != m_spectators.end();)
+	{
+		if (now - it->second.lastHeardMs <= SpectatorTimeoutMs)
 		{
-			// Not a HELLO; ignore and continue draining
+			++it;
 			continue;
 		}
+		LOG_INFO("HostNetworkController: Spectator " LOG_IPV4_FMT ":%u timed out (%zu watching)",
+			LOG_IPV4_ARGS(it->second.address), it->second.port, m_spectators.size() - 1);
+		it = m_spectators.erase(it);
+	}
+}
 
-		// The HELLO packet should contain the gameplay recieve port for the guest
-		if (recieved < 3)
+void HostNetworkController::expireSessions()
+{
+	uint32_t now = getTimeMs();
+	for (auto it = m_sessions.begin(); it != m_sessions.end();)
+	{
+		if (now - it->second.lastHeardMs <= SessionTimeoutMs)
 		{
-			cout << "HostNetworkController: Invalid HELLO packet recieved" << endl;
-			// keep draining to find a valid one
+			++it;
 			continue;
 		}
+		LOG_INFO("HostNetworkController: Guest " LOG_IPV4_FMT ":%u timed out (%zu sessions)",
+			LOG_IPV4_ARGS(it->second.address), it->second.port, m_sessions.size() - 1);
+		m_expiredSessions.push_back(it->first);
+		it = m_sessions.erase(it);
+	}
+}
 
-		// ---- Extract guest port (from bytes 1 and 2, big-endian) ----
-		unsigned short guestPort =
-			(static_cast<uint8_t>(data[1]) << 8) |
-			static_cast<uint8_t>(data[2]);
+size_t HostNetworkController::getMulticastSpectatorCount() const
+{
+	size_t count = 0;
+	for (const auto& entry : m_spectators)
+		count += entry.second.multicast ? 1 : 0;
+	return count;
+}
 
-		m_guestAddress = sender.value();
-		m_guestPort = guestPort;
-		m_hasGuest = true;
+bool HostNetworkController::sendSpectatorState(const NetLogicStates& state)
+{
+	if (m_spectators.empty() || !m_spectatorSnapshots.onTick())
+		return false;
 
-		// ---- Send HELLO_ACK ----
-		uint8_t reply[1];
-		reply[0] = MessageTypes::HELLO_ACK;
+	// ---- Encode once: a full snapshot, the same bytes for everyone ----
+	NetLogicStates snapshot = state;
+	snapshot.seqNum = m_spectatorSeq++;
+	snapshot.inputAckTick = 0;	// spectators have no inputs
+	SnapshotCodec::quantize(snapshot, m_quantization);
 
-		auto sendStatus = m_socket.send(reply, sizeof(reply), m_guestAddress, m_guestPort);
-		if (sendStatus != Socket::Status::Done)
-		{
-			cout << "HostNetworkController: Failed to send HELLO_ACK to "
-				<< m_guestAddress.toString() << ":" << m_guestPort << endl;
-			m_hasGuest = false; // reset guest info
-			return false;
-		}
-		cout << "HostNetworkController: Guest connected from "
-			<< m_guestAddress.toString() << ":" << m_guestPort <<
-			" -> HELLO_ACK sent" << endl;
+	Datagram& encoded = m_spectatorSnapshot;
+	encoded.size = SnapshotCodec::encode(snapshot, nullptr, m_quantization, reinterpret_cast<uint8_t*>(encoded.data), sizeof(encoded.data));
+	if (encoded.size == 0)
+	{
+		LOG_ERROR("HostNetworkController: Spectator STATE_UPDATE did not fit in the send buffer");
+		return false;
+	}
+	m_spectatorFanout.snapshots++;
 
-		return true;
+	// ---- Fan the bytes out: a copy per unicast spectator, one for the whole group ----
+	// The group always gets one while there is a group, so spectators that just joined it can
+	//  hear it and say so before their own copies stop
+	size_t copies = 0;
+	for (const auto& entry : m_spectators)
+	{
+		const SpectatorSession& spectator = entry.second;
+		if (spectator.multicast)
+			continue;
+		m_socket.queueSend(encoded.data, encoded.size, spectator.address, spectator.port);
+		copies++;
+	}
+	if (m_multicast.isEnabled())
+	{
+		m_socket.queueSend(encoded.data, encoded.size, m_multicast.group, m_multicast.port);
+		copies++;
 	}
+
+	m_spectatorFanout.datagrams += copies;
+	m_spectatorFanout.bytesSent += copies * encoded.size;
+	return true;
 }
 
-int8_t HostNetworkController::recieveGuestInput()
+void HostNetworkController::handleGuestInput(const Datagram& datagram)
 {
-	Buffer buffer;
+	GuestInputPacket packet;
+	if (!decodePacket(datagram.data, datagram.size, packet))
+		return;
 
-	// Non-blocking recieve
-	auto status = m_socket.receive(buffer.data, sizeof(buffer.data), buffer.recieved, buffer.sender, buffer.senderPort);
+	auto it = m_sessions.find(makeSessionId(datagram.address, datagram.port));
+	if (it == m_sessions.end())
+		return; // input from a guest without a session
 
-	// ---- ERROR CHECKS ----
-	if (status != Socket::Status::Done)
-		return m_latestGuestInput; // no data recieved
+	// ---- Acknowledged snapshot and the host tick the guest was looking at; absent until the guest has a snapshot ----
+	bool hasAck = hasOptional<GuestInputPacket>(datagram.size);
 
-	if (!buffer.sender.has_value() || buffer.recieved < 1)
-		return m_latestGuestInput; // invalid packet
-	
-	uint8_t msgType = buffer.data[0];
+	it->second.inputs.insert(packet.tick, packet.input, packet.viewTick, hasAck);
 
-	if (msgType != MessageTypes::GUEST_INPUT)
-		return m_latestGuestInput; // not a GUEST_INPUT packet
+	// ---- Repeats of the guest's previous inputs: fill any tick whose own packet was lost ----
+	int previousCount = packet.previousCount < GuestInputPacket::MaxPrevious ? packet.previousCount : GuestInputPacket::MaxPrevious;
+	for (int ago = 1; ago <= previousCount; ++ago)
+		it->second.inputs.fill(static_cast<uint16_t>(packet.tick - ago), packet.getPrevious(ago));
 
-	// ---- Extract input ----
-	if (buffer.recieved < 4)
-		return m_latestGuestInput;
-	int8_t guestInput = static_cast<int8_t>(buffer.data[3]);
-	
-	m_latestGuestInput = guestInput;
+	// One input per guest tick, so the tick doubles as a sequence number for loss and jitter
+	it->second.stats.recordSequence(packet.tick, toMs(datagram.arrival));
 
-	return m_latestGuestInput;
+	if (hasAck)
+	{
+		GuestSession& session = it->second;
+		uint16_t ackSeq = packet.ackSeq;
+
+		// Acks only move forward, and never past what was actually sent
+		bool isNewer = !session.hasAck || sequenceGreaterThan(ackSeq, session.ackedSeq);
+		if (isNewer && sequenceGreaterThan(session.seq, ackSeq))
+		{
+			session.ackedSeq = ackSeq;
+			session.hasAck = true;
+		}
+	}
 }
 
-void HostNetworkController::sendStateUpdate(const NetLogicStates& state)
+bool HostNetworkController::acceptNewSession(SessionId& outId)
 {
-	// Build binary packet
-	uint8_t buffer[64]; // more than enough space for packet 
-						//[Size = 1 (msg) + 4 (seq) + 4*6 (floats) + 2 (scores) = 1 + 4 + 24 + 2 = 31 bytes]
-	size_t offset = 0;
+	// Skip sessions that were closed before anyone picked them up
+	while (!m_newSessions.empty())
+	{
+		SessionId id = m_newSessions.front();
+		m_newSessions.pop_front();
+		if (m_sessions.count(id) != 0)
+		{
+			outId = id;
+			return true;
+		}
+	}
+	return false;
+}
 
-	// messageType (1 byte)
-	buffer[offset++] = static_cast<uint8_t>(state.messageType);
+bool HostNetworkController::acceptExpiredSession(SessionId& outId)
+{
+	// A guest that reconnected since has a new session under the same id; it didn't expire
+	while (!m_expiredSessions.empty())
+	{
+		SessionId id = m_expiredSessions.front();
+		m_expiredSessions.pop_front();
+		if (m_sessions.count(id) == 0)
+		{
+			outId = id;
+			return true;
+		}
+	}
+	return false;
+}
 
-	// seqNum (int, 4 bytes, big-endian)
-	buffer[offset++] = (state.seqNum >> 24) & 0xFF;
-	buffer[offset++] = (state.seqNum >> 16) & 0xFF;
-	buffer[offset++] = (state.seqNum >> 8) & 0xFF;
-	buffer[offset++] = state.seqNum & 0xFF;
+void HostNetworkController::closeSession(SessionId id)
+{
+	m_sessions.erase(id);
+}
 
-	auto writeFloat = [&](float f) // lambda to write float as 4 bytes
-		{
-			uint8_t* bytes = reinterpret_cast<uint8_t*>(&f);
-			// SFML can send native float directly so we don't need to worry about endianness here
-			for (int i = 0; i < 4; ++i)
-				buffer[offset++] = bytes[i];
-		};
+int8_t HostNetworkController::consumeGuestInput(SessionId id)
+{
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+		return 0;
+	return it->second.inputs.consume();
+}
 
-	// Game state floats (4 bytes each)
-	writeFloat(state.p1Y);
-	writeFloat(state.p2Y);
-	writeFloat(state.ballX);
-	writeFloat(state.ballY);
-	writeFloat(state.ballVelX);
-	writeFloat(state.ballVelY);
+bool HostNetworkController::getGuestViewTick(SessionId id, uint16_t& viewTick) const
+{
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+		return false;
+	return it->second.inputs.getLastViewTick(viewTick);
+}
+
+bool HostNetworkController::sendStateUpdate(SessionId id, NetLogicStates& state)
+{
+	auto it = m_sessions.find(id);
+	if (it == m_sessions.end())
+		return false;
+	GuestSession& session = it->second;
+
+	// Ticks between snapshots are skipped; seqNum only counts the ones sent, so gaps still mean loss
+	if (!session.snapshots.onTick())
+		return false;
+	state.seqNum = session.seq++;
+
+	// Tells the guest which of its inputs this state already includes, so it can replay the rest
+	state.inputAckTick = static_cast<uint16_t>(session.inputs.getNextTick() - 1);
+
+	// Keep exactly what the guest will decode, so baselines match bit-for-bit on both ends
+	SnapshotCodec::quantize(state, m_quantization);
+
+	// Usable baseline: acknowledged, and still in the history window
+	const NetLogicStates* baseline = nullptr;
+	if (session.hasAck && static_cast<uint16_t>(state.seqNum - session.ackedSeq) < SnapshotHistorySize)
+		baseline = session.history.find(session.ackedSeq);
 
-	// Scores (2 bytes)
-	buffer[offset++] = static_cast<uint8_t>(state.p1Score);
-	buffer[offset++] = static_cast<uint8_t>(state.p2Score);
+	// Bit-pack straight into the send queue [full snapshot = 19 bytes with default quantization]
+	Datagram& datagram = m_socket.stageSend(session.address, session.port);
+	datagram.size = SnapshotCodec::encode(state, baseline, m_quantization, reinterpret_cast<uint8_t*>(datagram.data), sizeof(datagram.data));
 
-	auto status = m_socket.send(buffer, offset, m_guestAddress, m_guestPort);
+	// Keep it as a future baseline
+	session.history.store(state);
 
-	if (status != Socket::Status::Done)
+	if (datagram.size == 0)
 	{
-		cout << "HostNetworkController: Failed to send STATE_UPDATE to "
-			<< m_guestAddress.toString() << ":" << m_guestPort << endl;
-		return;
+		m_socket.cancelStaged();
+		LOG_ERROR("HostNetworkController: STATE_UPDATE did not fit in the send buffer");
+		return false;
+	}
+
+	m_stateBandwidth.snapshots++;
+	m_stateBandwidth.bytesSent += datagram.size;
+	m_stateBandwidth.bytesIfFull += StateBandwidthCounters::UnpackedSnapshotSize;
+
+	session.stats.recordSent(static_cast<uint8_t>(datagram.data[0]), datagram.size);
+	return true;
+}
+
+void HostNetworkController::flush()
+{
+	serviceReliableChannels();
+
+	size_t failed = m_socket.flush();
+	if (failed > 0)
+	{
+		LOG_WARN("HostNetworkController: Failed to send %zu datagram(s)", failed);
 	}
 }
 
 void HostNetworkController::reset()
 {
-	// Unbind and reset socket
-	m_socket.unbind();
-	m_socket.setBlocking(false);
+	// Stop the I/O thread, then unbind and reset socket
+	m_socket.stopIoThread();
 
-	// Reset guest connection info
-	m_guestAddress = IpAddress::Any;
-	m_guestPort = 0;
-	m_hasGuest = false;
+	// Tell the lobby we're gone rather than have it send guests here until we time out
+	if (m_lobby.isEnabled() && m_hasReportedToLobby)
+	{
+		sendLobbyRegister(0);
+		m_socket.flush();
+	}
+	m_hasReportedToLobby = false;
 
-	// Reset latest input
-	m_latestGuestInput = 0;
+	m_socket.unbind();
+	m_socket.setBlocking(false);
+	m_socket.clearSendQueue();
+
+	// Drop every guest session and spectator
+	m_sessions.clear();
+	m_newSessions.clear();
+	m_expiredSessions.clear();
+	m_spectators.clear();
+	m_spectatorSeq = 0;
+	m_hasBeaconed = false;
 }
 
@@ -1,65 +1,286 @@
 #pragma once
 #include <SFML/Network.hpp>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DatagramSocket.h"
+#include "InputRingBuffer.h"
+#include "LinkEstimator.h"
+#include "LobbyConfig.h"
+#include "MessageRouter.h"
+#include "NetConditioner.h"
+#include "NetStats.h"
+#include "NetProtocol.h"
+#include "PongSim.h"
+#include "ReliableChannel.h"
+#include "SnapshotCodec.h"
+#include "SnapshotScheduler.h"
 
 using namespace sf;
 
-struct NetLogicStates {
-	uint8_t messageType;
-	int seqNum;
-	float p1Y = 0.f;
-	float p2Y = 0.f;
-	float ballX = 0.f;
-	float ballY = 0.f;
-	float ballVelX = 0.f;
-	float ballVelY = 0.f;
-	unsigned int p1Score = 0;
-	unsigned int p2Score = 0;
+// Identifies a guest session by its endpoint: IPv4 address in the high bits, gameplay port in the low 16
+using SessionId = uint64_t;
+
+struct GuestSession {
+	IpAddress address = IpAddress::Any;
+	unsigned short port = 0;
+	InputRingBuffer inputs;		// directions recieved from this guest (-1, 0 or 1), slotted by guest tick
+	uint16_t seq = 0;			// next STATE_UPDATE sequence number for this guest (wraps)
+
+	// Which ticks get a snapshot, at this guest's send rate
+	SnapshotScheduler snapshots;
+
+	// Delta baselines: snapshots sent, as the guest will decode them
+	SnapshotHistory history;
+	uint16_t ackedSeq = 0;		// newest snapshot the guest acknowledged
+	bool hasAck = false;
+
+	// Round trip / clock offset to this guest, from our PINGs
+	LinkEstimator link;
+	uint32_t lastPingMs = 0;
+
+	// Control messages that must arrive (score / game over)
+	ReliableChannel reliable;
+	ScoreEvent lastScore;		// last SCORE_EVENT queued
+	bool hasSentScore = false;
+
+	// Traffic to / from this guest, by message type, closed into one-second windows
+	NetStats stats;
+
+	// Any packet from the guest keeps the session open; see SessionTimeoutMs
+	uint32_t lastHeardMs = 0;
+};
+
+// A viewer that joined with a spectator HELLO. It gets the snapshots given to sendSpectatorState()
+//  and sends nothing but PINGs, which keep it alive
+struct SpectatorSession {
+	IpAddress address = IpAddress::Any;
+	unsigned short port = 0;
+	bool multicast = false;		// listening on the multicast group, so it gets no copy of its own
+	uint32_t lastHeardMs = 0;
+};
+
+// Multicast group spectator snapshots go to, e.g. "239.255.42.99:54100".
+// Datagrams are sent with the default TTL of 1, so they stay on the local network.
+struct SpectatorMulticastConfig {
+	IpAddress group = IpAddress::Any;
+	unsigned short port = 0;
+
+	bool isEnabled() const { return port != 0; }
+
+	// Parses "ADDRESS:PORT"; false unless ADDRESS is an IPv4 multicast address (224.0.0.0/4)
+	static bool parse(const std::string& spec, SpectatorMulticastConfig& out);
+	// Reads the PONG_SPECTATOR_GROUP environment variable; false if it is unset or invalid
+	static bool fromEnvironment(SpectatorMulticastConfig& out);
+	std::string describe() const;
 };
 
-struct Buffer {
-	char data[16];
-	size_t recieved = 0;
-	std::optional<sf::IpAddress> sender;
-	unsigned short senderPort = 0;
+// Spectator fan-out: each snapshot is encoded once, then copied to every recipient
+struct SpectatorFanoutCounters {
+	uint64_t snapshots = 0;		// snapshots encoded
+	uint64_t datagrams = 0;		// copies queued (one per unicast spectator, one for the group)
+	uint64_t bytesSent = 0;
 };
 
-enum MessageTypes : uint8_t {
-	FIND_HOST = 1,
-	HOST_HERE = 2,
-	HELLO = 3,
-	HELLO_ACK = 4,
-	GUEST_INPUT = 5,
-	STATE_UPDATE = 6
+// Snapshot bandwidth, to compare the encoded size against the original 31-byte full snapshot
+struct StateBandwidthCounters {
+	static const size_t UnpackedSnapshotSize = 31;
+
+	uint64_t snapshots = 0;
+	uint64_t bytesSent = 0;
+	uint64_t bytesIfFull = 0;
 };
 
 class HostNetworkController
 {
 public:
 	HostNetworkController();
+	// Binds the socket, and hands it to an I/O thread unless setIoThread(false) was called first
 	bool bind(unsigned short port);
+	unsigned short getLocalPort() const { return m_socket.getLocalPort(); }
+
+	// Read and send on a dedicated I/O thread (default) or directly from poll()/flush()
+	void setIoThread(bool enabled) { m_useIoThread = enabled; }
+
+	// recvmmsg/sendmmsg (default, where the build has them) or one socket call per datagram; call before bind()
+	void setBatchedIo(bool enabled) { m_socket.setBatchedIo(enabled); }
+	bool isBatchedIo() const { return m_socket.isBatchedIo(); }
+
+	// Impair traffic for testing (see NetConditioner.h). Defaults to the PONG_NETEM environment
+	//  variable; takes effect on the next bind()
+	void setNetConditioner(const NetConditionerConfig& config) { m_conditionerConfig = config; }
+
+	// Snapshot send rate for every session, fixed or adaptive (see SnapshotScheduler.h), against a sim
+	//  stepping tickRateHz times a second. Defaults to the PONG_SNAPSHOT_RATE environment variable,
+	//  or a snapshot every tick. tickRateHz, rounded to whole Hz, also goes to guests in HELLO_ACK
+	void setSnapshotRate(const SnapshotRateConfig& config, float tickRateHz = PongSim::TickRate);
+	const SnapshotRateConfig& getSnapshotRate() const { return m_snapshotRate; }
+
+	// Drain every pending datagram and route it:
+	//  FIND_HOST -> HOST_HERE reply, HELLO -> open session (or add spectator) + HELLO_ACK, GUEST_INPUT -> sending session,
+	//  PING -> PONG reply, PONG -> session link estimate, RELIABLE -> session channel.
+	//  Also PINGs every session that is due one, broadcasts a HOST_HERE beacon when due, reports to the lobby
+	//  when due and closes sessions and drops spectators that have gone silent.
+	void poll();
 
 	//Discovery + Handshake
-	void pollForDiscoveryRequests();		//for FIND_HOST messages
-	bool pollForHello();					//returns true if guest is connected
+	bool acceptNewSession(SessionId& outId);	//pops a session opened by poll(), false if none are waiting
+	bool acceptExpiredSession(SessionId& outId);	//pops a session poll() closed after SessionTimeoutMs of silence
+	void closeSession(SessionId id);
 
 	//Gameplay traffic
-	int8_t recieveGuestInput();				//returns -1, 0 or 1
-	void sendStateUpdate(const NetLogicStates& state);
+	int8_t consumeGuestInput(SessionId id);	//input for the session's next tick in order: -1, 0 or 1
+	//host tick the guest was displaying when it issued the input consumeGuestInput() last returned;
+	//false until the guest sends one (used for lag compensation)
+	bool getGuestViewTick(SessionId id, uint16_t& viewTick) const;
+	//call once per sim tick: if the session's snapshot rate has one due on this tick, stamps state.seqNum and
+	//state.inputAckTick from the session and sends a STATE_DELTA against the newest acknowledged snapshot,
+	//or a full STATE_UPDATE when none is usable; queued until flush(). False if nothing was sent
+	bool sendStateUpdate(SessionId id, NetLogicStates& state);
+	//queues a reliable SCORE_EVENT if the score or game-over flag differs from the last one sent
+	//(also after a lag-compensation rewind takes a point back); call after every step
+	void announceScore(SessionId id, const PongSimState& sim);
+
+	// Send every queued STATE_UPDATE, plus any reliable messages and acks that are due,
+	//  in as few syscalls as the socket backend allows
+	void flush();
+
+	//Spectators
+	//call once per sim tick with the state to show: when the spectator snapshot rate has one due, encodes it once
+	//as a full STATE_UPDATE (spectators never ack, so there is no delta baseline) and queues the same bytes to
+	//every unicast spectator, plus one copy to the multicast group if there is one. False if nothing was sent
+	bool sendSpectatorState(const NetLogicStates& state);
+	// Most spectators at once (default DefaultMaxSpectators); further spectator HELLOs are ignored
+	static const size_t DefaultMaxSpectators = 64;
+	void setMaxSpectators(size_t maxSpectators) { m_maxSpectators = maxSpectators; }
+	// Multicast group offered to spectators in HELLO_ACK. Defaults to the PONG_SPECTATOR_GROUP environment
+	//  variable; a disabled config sends every spectator its own copy
+	void setSpectatorMulticast(const SpectatorMulticastConfig& config) { m_multicast = config; }
+	const SpectatorMulticastConfig& getSpectatorMulticast() const { return m_multicast; }
+	size_t getSpectatorCount() const { return m_spectators.size(); }
+	size_t getMulticastSpectatorCount() const;
+	const SpectatorFanoutCounters& getSpectatorFanout() const { return m_spectatorFanout; }
+
+	//check if a guest is still connected
+	bool isGuestConnected(SessionId id) const { return m_sessions.count(id) != 0; }
+	size_t getSessionCount() const { return m_sessions.size(); }
 
-	//check if guest is still connected
-	bool isGuestConnected() const { return m_hasGuest; }
+	// Maximum number of concurrent sessions; further HELLOs are ignored
+	void setMaxSessions(size_t maxSessions) { m_maxSessions = maxSessions; }
+
+	// HOST_HERE beacon period while a session is free (default HostBeaconIntervalMs); 0 turns beacons off
+	void setBeaconInterval(uint32_t intervalMs) { m_beaconIntervalMs = intervalMs; }
+
+	// Lobby service to register with. Defaults to the PONG_LOBBY environment variable; while set,
+	//  poll() sends LOBBY_REGISTER every LobbyHeartbeatMs and as soon as the session count changes
+	void setLobby(const LobbyConfig& config) { m_lobby = config; }
+	const LobbyConfig& getLobby() const { return m_lobby; }
 
 	// Reset all internal state and socket to defaults
 	void reset();
 
+	static SessionId makeSessionId(const IpAddress& address, unsigned short port);
+
+	DatagramIoCounters getIoCounters() const { return m_socket.getCounters(); }
+	sf::Time getIoThreadCpuTime() const { return m_socket.getIoThreadCpuTime(); }
+	void resetIoCounters() { m_socket.resetCounters(); m_stateBandwidth = StateBandwidthCounters(); m_spectatorFanout = SpectatorFanoutCounters(); }
+	const StateBandwidthCounters& getStateBandwidth() const { return m_stateBandwidth; }
+
+	// RTT / jitter / clock offset to a guest; false if the session doesn't exist
+	bool getLinkEstimate(SessionId id, LinkEstimator& out) const;
+
+	// Per-second traffic, loss and jitter of a guest connection; false if the session doesn't exist
+	bool getNetStats(SessionId id, NetStats& out) const;
+
+	// How a guest's inputs covered the ticks stepped so far (own packet, repeat, or none); false if the session doesn't exist
+	bool getInputStats(SessionId id, InputBufferStats& out) const;
+
+	// Snapshots per second currently sent to a guest; 0 if the session doesn't exist
+	float getSnapshotRateHz(SessionId id) const;
+
 private:
-	UdpSocket m_socket;
+	void handleFindHost(const Datagram& datagram);
+	void handleHello(const Datagram& datagram);
+	void handleGuestInput(const Datagram& datagram);
+	void handlePing(const Datagram& datagram);
+	void handlePong(const Datagram& datagram);
+	void handleReliable(const Datagram& datagram);
+	void addSpectator(const IpAddress& address, const HelloPacket& hello);
+	void expireSessions();
+	void expireSpectators();
+	void serviceReliableChannels();
+	void sendPings();
+	void sendBeaconIfDue();
+	void sendLobbyRegisterIfDue();
+	void sendLobbyRegister(uint16_t capacity);
+	void updateStats();
+
+	// Encodes a schema packet straight into the send queue, counted in the session's stats.
+	//  withOptional = false leaves off its optional tail
+	template <typename Packet>
+	void queuePacket(GuestSession& session, const Packet& packet, bool withOptional = true);
+
+	// The same for an endpoint without a session (discovery, early pings, spectators); returns the size queued
+	template <typename Packet>
+	size_t queuePacket(const IpAddress& address, unsigned short port, const Packet& packet, bool withOptional = true);
+
+	// Milliseconds on the host clock, as carried in PING/PONG; the clock datagrams are stamped on
+	static uint32_t getTimeMs() { return toMs(DatagramSocket::now()); }
+	static uint32_t toMs(sf::Time time) { return static_cast<uint32_t>(time.asMilliseconds()); }
 
-	//Guest info
-	IpAddress m_guestAddress;
-	unsigned short m_guestPort;
-	bool m_hasGuest;
+	DatagramSocket m_socket;
+	bool m_useIoThread{ true };
+	NetConditionerConfig m_conditionerConfig;
+	std::vector<Datagram> m_recvBatch;
 
-	int8_t m_latestGuestInput;
+	SnapshotRateConfig m_snapshotRate;
+	float m_tickRateHz{ PongSim::TickRate };
+
+	//Guest sessions, keyed by endpoint; closed after SessionTimeoutMs without a packet
+	static const uint32_t SessionTimeoutMs = 5000;
+	std::unordered_map<SessionId, GuestSession> m_sessions;
+	std::deque<SessionId> m_newSessions;	// accepted by poll(), not yet handed out
+	std::deque<SessionId> m_expiredSessions;	// closed by poll(), not yet handed out
+	size_t m_maxSessions{ 1 };
+
+	//Spectators, keyed by endpoint like the sessions; dropped after SpectatorTimeoutMs without a packet
+	static const uint32_t SpectatorTimeoutMs = 5000;
+	std::unordered_map<SessionId, SpectatorSession> m_spectators;
+	size_t m_maxSpectators{ DefaultMaxSpectators };
+	SpectatorMulticastConfig m_multicast;
+	SnapshotScheduler m_spectatorSnapshots;
+	uint16_t m_spectatorSeq{ 0 };	// one sequence for every spectator, since they all get the same bytes
+	Datagram m_spectatorSnapshot;	// this tick's encoded snapshot, copied to each recipient
+	SpectatorFanoutCounters m_spectatorFanout;
+
+	uint32_t m_beaconIntervalMs{ HostBeaconIntervalMs };
+	uint32_t m_lastBeaconMs{ 0 };
+	bool m_hasBeaconed{ false };
+
+	LobbyConfig m_lobby;
+	uint32_t m_lastLobbyReportMs{ 0 };
+	size_t m_lastReportedLoad{ 0 };
+	bool m_hasReportedToLobby{ false };
+
+	SnapshotQuantization m_quantization;
+
+	StateBandwidthCounters m_stateBandwidth;
 };
 
+template <typename Packet>
+void HostNetworkController::queuePacket(GuestSession& session, const Packet& packet, bool withOptional)
+{
+	size_t size = queuePacket(session.address, session.port, packet, withOptional);
+	session.stats.recordSent(Packet::Type, size);
+}
+
+template <typename Packet>
+size_t HostNetworkController::queuePacket(const IpAddress& address, unsigned short port, const Packet& packet, bool withOptional)
+{
+	static_assert(PacketLayout<Packet>::MaxSize <= Datagram::MaxSize, "packet larger than a datagram");
+
+	Datagram& datagram = m_socket.stageSend(address, port);
+	datagram.size = encodePacket(packet, datagram.data, sizeof(datagram.data), withOptional);
+	return datagram.size;
+}
@@ -0,0 +1,149 @@
+#include "InputRingBuffer.h"
+#include "NetProtocol.h"
+
+InputRingBuffer::InputRingBuffer()
+{
+	reset();
+}
+
+bool InputRingBuffer::insert(uint16_t tick, int8_t input, uint16_t viewTick, bool hasViewTick)
+{
+	if (!m_started)
+	{
+		// First input lines the cursor up with the guest's clock
+		m_started = true;
+		m_nextTick = tick;
+		m_newestTick = tick;
+	}
+
+	int16_t ahead = sequenceDelta(m_nextTick, tick);
+	if (ahead < 0)
+	{
+		// Its step already ran. Several in a row mean the guest fell behind the cursor (it stalled,
+		//  or its clock drifted) and every later input would be late too; start again from this tick
+		if (++m_lateInserts < MaxLateInserts)
+			return false;
+		restartAt(tick);
+	}
+	else if (ahead >= Capacity)
+	{
+		// The guest jumped far ahead (e.g. the host stalled); start again from this tick
+		restartAt(tick);
+	}
+	m_lateInserts = 0;
+
+	Slot& slot = m_slots[tick % Capacity];
+	slot.tick = tick;
+	slot.input = input;
+	slot.viewTick = viewTick;
+	slot.hasViewTick = hasViewTick;
+	slot.recovered = false;
+	slot.valid = true;
+
+	if (sequenceDelta(m_newestTick, tick) > 0)
+		m_newestTick = tick;
+	return true;
+}
+
+bool InputRingBuffer::fill(uint16_t tick, int8_t input)
+{
+	// Repeats are always older than the packet's own tick, which insert() has just placed
+	if (!m_started)
+		return false;
+	int16_t ahead = sequenceDelta(m_nextTick, tick);
+	if (ahead < 0 || ahead >= Capacity)
+		return false;
+
+	Slot& slot = m_slots[tick % Capacity];
+	if (slot.valid && slot.tick == tick)
+		return false;
+
+	slot.tick = tick;
+	slot.input = input;
+	slot.viewTick = 0;
+	slot.hasViewTick = false;	// lag compensation keeps using the last real view tick
+	slot.recovered = true;
+	slot.valid = true;
+	return true;
+}
+
+int8_t InputRingBuffer::consume()
+{
+	if (!m_started)
+		return m_lastInput;
+
+	// Skip stale inputs rather than let a backlog delay every future input
+	while (sequenceDelta(m_nextTick, m_newestTick) > MaxLead)
+	{
+		Slot& skipped = m_slots[m_nextTick % Capacity];
+		if (skipped.valid && skipped.tick == m_nextTick)
+		{
+			applySlot(skipped);
+		}
+		m_nextTick++;
+	}
+
+	Slot& slot = m_slots[m_nextTick % Capacity];
+	m_stats.consumed++;
+	if (slot.valid && slot.tick == m_nextTick)
+	{
+		if (slot.recovered)
+			m_stats.recovered++;
+		applySlot(slot);
+	}
+	else
+	{
+		// input for this tick hasn't arrived, keep applying the previous one
+		m_stats.missed++;
+	}
+
+	m_nextTick++;
+	return m_lastInput;
+}
+
+void InputRingBuffer::reset()
+{
+	for (Slot& slot : m_slots)
+		slot = Slot();
+	m_nextTick = 0;
+	m_newestTick = 0;
+	m_started = false;
+	m_lastInput = 0;
+	m_lastViewTick = 0;
+	m_hasLastViewTick = false;
+	m_lateInserts = 0;
+	m_stats = InputBufferStats();
+}
+
+void InputRingBuffer::restartAt(uint16_t tick)
+{
+	for (Slot& slot : m_slots)
+		slot.valid = false;
+	m_nextTick = tick;
+	m_newestTick = tick;
+}
+
+void InputRingBuffer::applySlot(Slot& slot)
+{
+	m_lastInput = slot.input;
+	if (slot.hasViewTick)
+	{
+		m_lastViewTick = slot.viewTick;
+		m_hasLastViewTick = true;
+	}
+	slot.valid = false;
+}
+
+bool InputRingBuffer::getLastViewTick(uint16_t& viewTick) const
+{
+	viewTick = m_lastViewTick;
+	return m_hasLastViewTick;
+}
+
+uint16_t InputRingBuffer::getDepth() const
+{
+	if (!m_started)
+		return 0;
+	int16_t depth = sequenceDelta(m_nextTick, m_newestTick) + 1;
+	return depth > 0 ? static_cast<uint16_t>(depth) : 0;
+}
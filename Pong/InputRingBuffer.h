@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+
+// How the consumed ticks were covered, for judging input redundancy under loss
+struct InputBufferStats {
+	uint64_t consumed = 0;		// ticks the simulation stepped
+	uint64_t recovered = 0;		// ticks whose own packet was lost, filled from a later packet's copy
+	uint64_t missed = 0;		// ticks with no input at all; the previous input was repeated
+};
+
+/// <summary>
+/// @brief Per-tick buffer of one guest's paddle inputs on the host.
+///
+/// Every GUEST_INPUT carries the guest's simulation tick. The host drains all of them as
+///  they arrive and slots each into the ring by tick; the simulation then consumes exactly
+///  one input per step, in tick order. A missing tick repeats the previous input, a tick that
+///  arrives after its step was consumed is dropped, and if the guest runs too far ahead the
+///  cursor skips forward so queued inputs never turn into hidden latency. If MaxLateInserts
+///  inputs in a row are late, the guest has fallen behind the cursor, which moves back to it.
+/// Every GUEST_INPUT also repeats the guest's previous few inputs; fill() slots those into any
+///  tick that is still empty, so a lost packet is covered by whichever later one arrives first.
+/// </summary>
+class InputRingBuffer
+{
+public:
+	static const uint16_t Capacity = 64;
+	static const uint16_t MaxLead = 3;	// most ticks allowed to wait ahead of the consume cursor
+	static const int MaxLateInserts = 3;	// late inputs in a row before the cursor moves back to the guest
+
+	InputRingBuffer();
+
+	/// <summary>
+	/// @brief Stores the input issued by the guest on the given tick, and the host tick
+	///  the guest was displaying when it issued it (if the guest sent one).
+	/// Returns false if the tick was already consumed (the packet arrived too late), unless it is
+	///  the MaxLateInserts-th late one in a row; then the cursor restarts at this tick.
+	/// </summary>
+	bool insert(uint16_t tick, int8_t input, uint16_t viewTick = 0, bool hasViewTick = false);
+
+	/// <summary>
+	/// @brief Stores a repeated input for an earlier tick, only if that tick is still empty and not yet consumed.
+	/// Returns true if it filled a gap.
+	/// </summary>
+	bool fill(uint16_t tick, int8_t input);
+
+	/// <summary>
+	/// @brief Returns the input for the next tick and advances the cursor.
+	/// </summary>
+	int8_t consume();
+
+	void reset();
+
+	// Number of ticks buffered ahead of the consume cursor
+	uint16_t getDepth() const;
+	uint16_t getNextTick() const { return m_nextTick; }
+
+	// View tick of the input the last consume() applied; false if the guest never sent one
+	bool getLastViewTick(uint16_t& viewTick) const;
+
+	const InputBufferStats& getStats() const { return m_stats; }
+
+private:
+	struct Slot {
+		uint16_t tick = 0;
+		int8_t input = 0;
+		uint16_t viewTick = 0;
+		bool hasViewTick = false;
+		bool recovered = false;	// filled from a repeat, not the tick's own packet
+		bool valid = false;
+	};
+
+	// Takes a slot's input (and view tick) as the current one and frees the slot
+	void applySlot(Slot& slot);
+	// Empties the ring and puts the cursor on tick
+	void restartAt(uint16_t tick);
+
+	Slot m_slots[Capacity];
+	uint16_t m_nextTick{ 0 };		// tick the next consume() will apply
+	uint16_t m_newestTick{ 0 };		// newest tick inserted so far
+	bool m_started{ false };
+	int8_t m_lastInput{ 0 };
+	uint16_t m_lastViewTick{ 0 };
+	bool m_hasLastViewTick{ false };
+	int m_lateInserts{ 0 };		// late inserts since the last one that landed
+
+	InputBufferStats m_stats;
+};
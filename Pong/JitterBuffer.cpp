@@ -0,0 +1,267 @@
+#include "JitterBuffer.h"
+#include <cmath>
+
+namespace
+{
+	// Fraction of the delay error removed per advance(), and the most the playout clock
+	//  may be sped up or slowed down per tick to do it (0.1 = 10%)
+	const double CatchUpRate = 0.02;
+	const double MaxCatchUp = 0.1;
+
+	// Underrun penalty drained per second without underruns, in ticks
+	const float PenaltyDecayPerSecond = 0.5f;
+
+	// Widest snapshot spacing the delay allows for; the ring has to hold a couple of snapshots beyond it
+	const float MaxSpacingTicks = JitterBuffer::Capacity / 4;
+
+	int slotFor(int64_t tick)
+	{
+		int index = static_cast<int>(tick % JitterBuffer::Capacity);
+		return index < 0 ? index + JitterBuffer::Capacity : index;
+	}
+
+	float lerp(float a, float b, float alpha)
+	{
+		return a + (b - a) * alpha;
+	}
+}
+
+JitterBuffer::JitterBuffer(sf::Time tickTime)
+	: m_tickTime(tickTime)
+{
+	setPlayoutDelay(sf::milliseconds(DefaultPlayoutDelayMs));
+}
+
+void JitterBuffer::setTickTime(sf::Time tickTime)
+{
+	sf::Time delay = getPlayoutDelay();
+	m_tickTime = tickTime;
+	setPlayoutDelay(delay);
+}
+
+void JitterBuffer::setPlayoutDelay(sf::Time delay)
+{
+	m_delayTicks = delay.asSeconds() / m_tickTime.asSeconds();
+
+	// Playback has to stay inside the ring
+	if (m_delayTicks > Capacity / 2)
+		m_delayTicks = Capacity / 2;
+	if (m_delayTicks < 0.0)
+		m_delayTicks = 0.0;
+	m_stats.delayMs = static_cast<float>(m_delayTicks * m_tickTime.asSeconds() * 1000.0);
+}
+
+int64_t JitterBuffer::unwrap(uint16_t tick) const
+{
+	uint16_t newest = static_cast<uint16_t>(m_newestTick);
+	return m_newestTick + static_cast<int16_t>(static_cast<uint16_t>(tick - newest));
+}
+
+bool JitterBuffer::insert(const NetLogicStates& state, sf::Time receivedAt)
+{
+	if (!m_started)
+	{
+		m_newestTick = state.tick;
+		m_playoutTick = m_newestTick - m_delayTicks;
+		m_started = true;
+	}
+
+	int64_t tick = unwrap(state.tick);
+
+	// Host jumped a long way ahead (pause, reconnect): start playback again from here
+	if (tick - m_newestTick >= Capacity)
+	{
+		reset();
+		return insert(state, receivedAt);
+	}
+
+	// Playback is already past it, or it has fallen out of the ring
+	if (tick < m_playoutTick || tick <= m_newestTick - Capacity)
+	{
+		m_stats.lateDrops++;
+		return false;
+	}
+
+	Entry& entry = m_entries[slotFor(tick)];
+	if (entry.valid && entry.tick == tick)
+	{
+		m_stats.duplicates++;
+		return false;
+	}
+
+	entry.state = state;
+	entry.tick = tick;
+	entry.valid = true;
+	m_stats.received++;
+
+	if (tick > m_newestTick)
+		m_newestTick = tick;
+
+	// RFC 3550 style jitter: how much the arrival spacing differs from the host tick spacing
+	if (!m_hasArrival || tick > m_lastArrivalTick)
+	{
+		if (m_hasArrival)
+		{
+			sf::Time expected = m_tickTime * static_cast<float>(tick - m_lastArrivalTick);
+			float deviationMs = std::fabs((receivedAt - m_lastArrivalTime - expected).asSeconds() * 1000.f);
+			m_stats.jitterMs += (deviationMs - m_stats.jitterMs) / 16.f;
+
+			// How far apart the host sends them; a lost snapshot widens one gap, a lower send rate all of them
+			float spacing = static_cast<float>(tick - m_lastArrivalTick);
+			if (spacing > MaxSpacingTicks)
+				spacing = MaxSpacingTicks;
+			m_stats.spacingTicks += (spacing - m_stats.spacingTicks) / 16.f;
+		}
+		m_lastArrivalTick = tick;
+		m_lastArrivalTime = receivedAt;
+		m_hasArrival = true;
+	}
+	return true;
+}
+
+void JitterBuffer::advance(sf::Time dt)
+{
+	if (!m_started)
+		return;
+
+	if (m_adaptive)
+		adaptDelay(dt);
+
+	m_playoutTick += dt.asSeconds() / m_tickTime.asSeconds();
+
+	double target = m_newestTick - m_delayTicks;
+	double error = target - m_playoutTick;
+
+	if (error > Capacity / 2)
+	{
+		// Too far behind to catch up smoothly (e.g. after a hitch); skip ahead
+		m_playoutTick = target;
+	}
+	else
+	{
+		double correction = error * CatchUpRate;
+		if (correction > MaxCatchUp)
+			correction = MaxCatchUp;
+		if (correction < -MaxCatchUp)
+			correction = -MaxCatchUp;
+		m_playoutTick += correction;
+	}
+
+	// Never run ahead of what we have; sample() holds the newest snapshot until more arrive
+	if (m_playoutTick > m_newestTick)
+		m_playoutTick = static_cast<double>(m_newestTick);
+}
+
+bool JitterBuffer::sample(NetLogicStates& out)
+{
+	if (!m_started)
+		return false;
+
+	const Entry* before = nullptr;	// newest snapshot at or behind the playout point
+	const Entry* after = nullptr;	// oldest snapshot ahead of it
+	int depth = 0;
+
+	for (const Entry& entry : m_entries)
+	{
+		if (!entry.valid)
+			continue;
+
+		if (entry.tick <= m_playoutTick)
+		{
+			if (!before || entry.tick > before->tick)
+				before = &entry;
+		}
+		else
+		{
+			depth++;
+			if (!after || entry.tick < after->tick)
+				after = &entry;
+		}
+	}
+	m_stats.depth = depth;
+
+	if (!after)
+	{
+		if (!before)
+			return false;
+
+		// Starved: hold the newest snapshot and count it once per dry spell
+		if (!m_starved)
+		{
+			m_starved = true;
+			m_stats.underruns++;
+			m_underrunPenaltyTicks += 1.f;
+			if (m_underrunPenaltyTicks > MaxUnderrunPenaltyTicks)
+				m_underrunPenaltyTicks = MaxUnderrunPenaltyTicks;
+		}
+		out = before->state;
+		return true;
+	}
+	m_starved = false;
+
+	if (!before)
+	{
+		// Only snapshots ahead of playback so far (first frames after connecting)
+		out = after->state;
+		return true;
+	}
+
+	float alpha = static_cast<float>((m_playoutTick - before->tick) / (after->tick - before->tick));
+
+	// Discrete fields (scores, sequence) come from the snapshot already reached
+	out = before->state;
+	out.p1Y = lerp(before->state.p1Y, after->state.p1Y, alpha);
+	out.p2Y = lerp(before->state.p2Y, after->state.p2Y, alpha);
+	out.ballX = lerp(before->state.ballX, after->state.ballX, alpha);
+	out.ballY = lerp(before->state.ballY, after->state.ballY, alpha);
+	out.ballVelX = lerp(before->state.ballVelX, after->state.ballVelX, alpha);
+	out.ballVelY = lerp(before->state.ballVelY, after->state.ballVelY, alpha);
+	return true;
+}
+
+void JitterBuffer::reset()
+{
+	for (Entry& entry : m_entries)
+		entry.valid = false;
+
+	m_playoutTick = 0.0;
+	m_newestTick = 0;
+	m_started = false;
+	m_starved = false;
+	m_hasArrival = false;
+	m_underrunPenaltyTicks = 0.f;
+	m_stats.depth = 0;
+	m_stats.jitterMs = 0.f;
+}
+
+void JitterBuffer::adaptDelay(sf::Time dt)
+{
+	m_underrunPenaltyTicks -= PenaltyDecayPerSecond * dt.asSeconds();
+	if (m_underrunPenaltyTicks < 0.f)
+		m_underrunPenaltyTicks = 0.f;
+
+	// One-way variation is roughly half the round-trip variation
+	float jitterMs = m_stats.jitterMs;
+	if (m_linkJitterMs / 2.f > jitterMs)
+		jitterMs = m_linkJitterMs / 2.f;
+
+	// One snapshot spacing so there is always a snapshot ahead, plus cover for the jitter
+	float tickMs = m_tickTime.asSeconds() * 1000.f;
+	float delayTicks = m_stats.spacingTicks + JitterMultiplier * jitterMs / tickMs + m_underrunPenaltyTicks;
+
+	// The playout clock only drifts towards the new target, so changing it here doesn't jump the picture
+	setPlayoutDelay(m_tickTime * delayTicks);
+}
+
+void JitterBuffer::resetStats()
+{
+	int depth = m_stats.depth;
+	float jitterMs = m_stats.jitterMs;
+	float delayMs = m_stats.delayMs;
+	float spacingTicks = m_stats.spacingTicks;
+	m_stats = JitterBufferStats();
+	m_stats.depth = depth;
+	m_stats.jitterMs = jitterMs;
+	m_stats.delayMs = delayMs;
+	m_stats.spacingTicks = spacingTicks;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <SFML/System.hpp>
+#include "NetProtocol.h"
+
+// Playout health, read by the guest for debugging and tuning the delay
+struct JitterBufferStats {
+	uint64_t received = 0;		// snapshots accepted into the buffer
+	uint64_t duplicates = 0;	// same host tick seen twice
+	uint64_t lateDrops = 0;		// arrived after playback had already passed their tick
+	uint64_t underruns = 0;		// times playback caught up with the newest snapshot
+	int depth = 0;				// snapshots waiting ahead of the playout point
+	float jitterMs = 0.f;		// smoothed arrival jitter against the host tick clock
+	float delayMs = 0.f;		// playout delay currently targeted
+	float spacingTicks = 1.f;	// smoothed host ticks between arriving snapshots (above 1 when the host sends less often)
+};
+
+/// <summary>
+/// @brief Guest-side buffer of host snapshots, played back a fixed delay behind the host.
+///
+/// Every snapshot is slotted by the host tick it was taken on, so several arriving in one frame
+///  (or out of order) all land in the right place. Playback runs on a local copy of the host
+///  tick clock held playoutDelay behind the newest snapshot; sample() interpolates between the
+///  two snapshots either side of that point. The clock drifts slightly faster or slower to
+///  hold the delay, and jumps when it falls hopelessly behind.
+/// In adaptive mode the delay follows the link instead: one snapshot spacing (a tick when the host
+///  sends every tick, three at 20 Hz on a 60 Hz host), plus JitterMultiplier times the
+///  worse of the measured arrival jitter and the PING jitter, plus a penalty that grows on every
+///  underrun and slowly drains away. That keeps it as low as the link allows without starving.
+/// Example usage:
+///		buffer.insert(state, clock.getElapsedTime());	// for every snapshot recieved
+///		buffer.advance(dt);								// once per update
+///		if (buffer.sample(view)) { ... draw view ... }
+/// </summary>
+class JitterBuffer
+{
+public:
+	static const int Capacity = 32;
+	static const int DefaultPlayoutDelayMs = 100;
+	static constexpr float JitterMultiplier = 3.f;
+	static constexpr float MaxUnderrunPenaltyTicks = 8.f;
+
+	explicit JitterBuffer(sf::Time tickTime);
+
+	/// <summary>
+	/// @brief Length of one host tick, once the host has said how fast it ticks. Keeps the playout delay's length in time.
+	/// </summary>
+	void setTickTime(sf::Time tickTime);
+
+	/// <summary>
+	/// @brief How far behind the newest snapshot playback runs. Larger hides more jitter but adds latency.
+	/// </summary>
+	void setPlayoutDelay(sf::Time delay);
+	sf::Time getPlayoutDelay() const { return m_tickTime * static_cast<float>(m_delayTicks); }
+
+	/// <summary>
+	/// @brief Size the delay from measured jitter and underruns instead of setPlayoutDelay().
+	/// </summary>
+	void setAdaptive(bool adaptive) { m_adaptive = adaptive; }
+
+	/// <summary>
+	/// @brief Round-trip jitter from PING/PONG, used alongside the arrival jitter in adaptive mode.
+	/// </summary>
+	void setLinkJitter(float jitterMs) { m_linkJitterMs = jitterMs; }
+
+	/// <summary>
+	/// @brief Stores a snapshot by its host tick. Returns false if it was a duplicate or arrived too late.
+	/// </summary>
+	bool insert(const NetLogicStates& state, sf::Time receivedAt);
+
+	/// <summary>
+	/// @brief Moves the playout point forward by dt.
+	/// </summary>
+	void advance(sf::Time dt);
+
+	/// <summary>
+	/// @brief Interpolated state at the playout point. Returns false until the first snapshot arrives.
+	/// While starved it holds the newest snapshot rather than guessing ahead.
+	/// </summary>
+	bool sample(NetLogicStates& out);
+
+	// Host tick nearest the playout point, i.e. the one currently on screen
+	uint16_t getPlayoutTick() const { return static_cast<uint16_t>(std::llround(m_playoutTick)); }
+
+	void reset();
+
+	const JitterBufferStats& getStats() const { return m_stats; }
+	// Clears the counters; depth, jitter, delay and spacing are live values and are kept
+	void resetStats();
+
+private:
+	struct Entry {
+		NetLogicStates state;
+		int64_t tick = 0;
+		bool valid = false;
+	};
+
+	// Host ticks wrap at 16 bits; buffer arithmetic uses them unwrapped around the newest one
+	int64_t unwrap(uint16_t tick) const;
+
+	// Adaptive mode: recompute m_delayTicks from jitter and the underrun penalty
+	void adaptDelay(sf::Time dt);
+
+	Entry m_entries[Capacity];
+	sf::Time m_tickTime;
+	double m_delayTicks{ 0.0 };
+	double m_playoutTick{ 0.0 };	// host tick currently being shown (fractional)
+	int64_t m_newestTick{ 0 };
+	bool m_started{ false };
+	bool m_starved{ false };
+
+	bool m_adaptive{ false };
+	float m_linkJitterMs{ 0.f };
+	float m_underrunPenaltyTicks{ 0.f };
+
+	// previous in-order arrival, for the jitter and spacing estimates
+	int64_t m_lastArrivalTick{ 0 };
+	sf::Time m_lastArrivalTime{ sf::Time::Zero };
+	bool m_hasArrival{ false };
+
+	JitterBufferStats m_stats;
+};
@@ -0,0 +1,115 @@
+#include "LagCompensator.h"
+#include <cmath>
+
+LagCompensator::LagCompensator()
+{
+	reset();
+}
+
+void LagCompensator::setMaxRewind(int ticks)
+{
+	// The rewind has to stay inside the recorded ticks
+	if (ticks < 0)
+		ticks = 0;
+	if (ticks > Capacity - 1)
+		ticks = Capacity - 1;
+	m_maxRewindTicks = ticks;
+}
+
+void LagCompensator::setMaxRewindTime(float maxRewindMs, float tickRateHz)
+{
+	setMaxRewind(static_cast<int>(std::lround(maxRewindMs * tickRateHz / 1000.f)));
+}
+
+void LagCompensator::reset()
+{
+	for (Entry& entry : m_entries)
+		entry.valid = false;
+}
+
+LagCompensator::Entry* LagCompensator::find(uint32_t tick)
+{
+	Entry& entry = m_entries[tick % Capacity];
+	if (!entry.valid || entry.state.tick != tick)
+		return nullptr;
+	return &entry;
+}
+
+void LagCompensator::step(PongSimState& state, int8_t leftInput, int8_t rightInput, float dt,
+	uint16_t viewTick, bool hasViewTick)
+{
+	// A match-winning point is final; there are no more steps to replay into
+	if (state.gameOver)
+		return;
+
+	PongSim::step(state, leftInput, rightInput, dt);
+
+	Entry& entry = m_entries[state.tick % Capacity];
+	entry.state = state;
+	entry.leftInput = leftInput;
+	entry.rightInput = rightInput;
+	entry.dt = dt;
+	entry.valid = true;
+
+	if (!hasViewTick)
+		return;
+
+	// The view tick went over the wire as 16 bits; widen it back next to the current tick
+	int16_t behind = static_cast<int16_t>(static_cast<uint16_t>(state.tick - viewTick));
+	if (behind <= 0 || behind > m_maxRewindTicks)
+		return;
+	uint32_t view = state.tick - behind;
+
+	if (guestSawHit(view, state.tick, state.rightPaddleY))
+	{
+		rewindAndReplay(state, view, state.tick);
+		m_stats.rewinds++;
+		if (behind > m_stats.maxRewindTicks)
+			m_stats.maxRewindTicks = behind;
+	}
+}
+
+bool LagCompensator::guestSawHit(uint32_t viewTick, uint32_t currentTick, float paddleY)
+{
+	const Entry* viewed = find(viewTick);
+	if (!viewed)
+		return false;
+
+	// Only a ball heading for the guest, touching the paddle where the guest had it
+	const PongSimState& seen = viewed->state;
+	if (seen.ballVelX <= 0.f || !PongSim::ballIntersectsPaddle(seen, PongSim::RightPaddleX, paddleY))
+		return false;
+
+	// The host's own history must show a miss
+	for (uint32_t tick = viewTick + 1; tick <= currentTick; ++tick)
+	{
+		const Entry* later = find(tick);
+		if (!later)
+			return false;
+
+		// The guest conceded the point; rewinding takes it back
+		if (later->state.leftScore != seen.leftScore)
+			return true;
+		// The ball already came back off the paddle
+		if (later->state.ballVelX <= 0.f)
+			return false;
+	}
+	return true;
+}
+
+void LagCompensator::rewindAndReplay(PongSimState& state, uint32_t viewTick, uint32_t currentTick)
+{
+	PongSimState replay = find(viewTick)->state;
+	PongSim::bounceOffPaddle(replay, true);
+	m_entries[viewTick % Capacity].state = replay;
+
+	// Re-run every recorded step since, overwriting history with the corrected states
+	for (uint32_t tick = viewTick + 1; tick <= currentTick; ++tick)
+	{
+		Entry& entry = m_entries[tick % Capacity];
+		PongSim::step(replay, entry.leftInput, entry.rightInput, entry.dt);
+		entry.state = replay;
+	}
+
+	state = replay;
+}
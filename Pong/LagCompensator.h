@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include "PongSim.h"
+
+// How often the host has re-judged a guest miss as a hit
+struct LagCompensationStats {
+	uint64_t rewinds = 0;		// guest hits restored by rewinding
+	int maxRewindTicks = 0;		// deepest rewind so far
+};
+
+/// <summary>
+/// @brief Host-side lag compensation for the guest (right) paddle.
+///
+/// The guest sees the ball one playout delay plus a trip in the past, but its own paddle in the
+///  present (it is predicted). Every GUEST_INPUT says which host tick the guest was looking at.
+///  This keeps the last Capacity stepped states with the inputs that produced them; when the
+///  ball the guest saw on that tick touches the guest's paddle as it is now, and the host's own
+///  history has no bounce there, the host rewinds to that tick, bounces the ball and replays
+///  the recorded steps up to the present.
+/// Rewinds are bounded by setMaxRewind() so a laggy guest can't rewrite too much of the past
+///  for the other player.
+/// Example usage (host, once per tick):
+///		compensator.step(sim, leftInput, rightInput, dt, guestViewTick, hasViewTick);
+/// </summary>
+class LagCompensator
+{
+public:
+	static const int Capacity = 32;
+	static const int DefaultMaxRewindTicks = 12;	// 200 ms at 60 ticks a second
+	static const int DefaultMaxRewindMs = 200;
+
+	LagCompensator();
+
+	void setMaxRewind(int ticks);
+	// The same bound in time, for a host ticking tickRateHz times a second (still at most Capacity - 1 ticks)
+	void setMaxRewindTime(float maxRewindMs, float tickRateHz);
+	int getMaxRewind() const { return m_maxRewindTicks; }
+
+	/// <summary>
+	/// @brief PongSim::step, recorded so it can be replayed, followed by the guest hit check.
+	/// viewTick is the (16-bit) host tick the guest was displaying when it issued rightInput.
+	/// </summary>
+	void step(PongSimState& state, int8_t leftInput, int8_t rightInput, float dt,
+		uint16_t viewTick, bool hasViewTick);
+
+	// Forget all recorded ticks (new match)
+	void reset();
+
+	const LagCompensationStats& getStats() const { return m_stats; }
+
+private:
+	struct Entry {
+		PongSimState state;		// state after this tick's step
+		int8_t leftInput = 0;
+		int8_t rightInput = 0;
+		float dt = 0.f;
+		bool valid = false;
+	};
+
+	Entry* find(uint32_t tick);
+
+	/// <summary>
+	/// @brief True if the ball the guest saw on viewTick should have hit the paddle at paddleY.
+	/// </summary>
+	bool guestSawHit(uint32_t viewTick, uint32_t currentTick, float paddleY);
+
+	void rewindAndReplay(PongSimState& state, uint32_t viewTick, uint32_t currentTick);
+
+	Entry m_entries[Capacity];
+	int m_maxRewindTicks{ DefaultMaxRewindTicks };
+	LagCompensationStats m_stats;
+};
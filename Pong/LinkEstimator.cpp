@@ -0,0 +1,51 @@
+#include "LinkEstimator.h"
+#include <cmath>
+
+void LinkEstimator::addSample(uint32_t sentMs, uint32_t remoteMs, uint32_t nowMs)
+{
+	// Millisecond clocks wrap after ~49 days; the signed difference survives that
+	int32_t rtt = static_cast<int32_t>(nowMs - sentMs);
+	if (rtt < 0)
+		return;
+
+	float sample = static_cast<float>(rtt);
+	float offset = static_cast<float>(static_cast<int32_t>(remoteMs - sentMs)) - sample / 2.f;
+
+	if (m_samples == 0)
+	{
+		m_rttMs = sample;
+		m_jitterMs = sample / 2.f;
+		m_offsetMs = offset;
+	}
+	else
+	{
+		m_jitterMs += (std::fabs(m_rttMs - sample) - m_jitterMs) / 4.f;
+		m_rttMs += (sample - m_rttMs) / 8.f;
+
+		float weight = sample <= m_rttMs + m_jitterMs ? 1.f / 8.f : 1.f / 16.f;
+		m_offsetMs += (offset - m_offsetMs) * weight;
+	}
+	m_samples++;
+}
+
+void LinkEstimator::reset()
+{
+	m_rttMs = 0.f;
+	m_jitterMs = 0.f;
+	m_offsetMs = 0.f;
+	m_samples = 0;
+}
+
+uint32_t LinkEstimator::getRetransmitTimeoutMs(uint32_t fallbackMs, uint32_t minMs) const
+{
+	if (m_samples == 0)
+		return fallbackMs;
+
+	uint32_t rto = static_cast<uint32_t>(m_rttMs + 4.f * m_jitterMs);
+	return rto < minMs ? minMs : rto;
+}
+
+uint32_t LinkEstimator::toRemoteTime(uint32_t localMs) const
+{
+	return localMs + static_cast<uint32_t>(static_cast<int32_t>(std::lround(m_offsetMs)));
+}
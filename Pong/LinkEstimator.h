@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// @brief Smoothed round-trip time, jitter and clock offset of one link, fed by PING/PONG.
+///
+/// Timestamps are milliseconds on each end's own clock. For a PING sent at sentMs and a PONG
+///  recieved at nowMs carrying the remote clock remoteMs:
+///		rtt    = nowMs - sentMs
+///		offset = remoteMs - (sentMs + rtt / 2)	(remote clock minus ours)
+/// RTT and jitter follow the TCP estimator (RFC 6298): srtt moves 1/8 and rttvar 1/4 of the
+///  way towards each sample. Offset samples taken on a slower than usual trip are skewed by
+///  the asymmetry, so they only move the estimate half as fast.
+/// </summary>
+class LinkEstimator
+{
+public:
+	/// <summary>
+	/// @brief Adds one PING/PONG exchange. Ignores samples with a negative round trip.
+	/// </summary>
+	void addSample(uint32_t sentMs, uint32_t remoteMs, uint32_t nowMs);
+
+	void reset();
+
+	bool hasSample() const { return m_samples > 0; }
+	uint64_t getSampleCount() const { return m_samples; }
+
+	float getRttMs() const { return m_rttMs; }
+	float getJitterMs() const { return m_jitterMs; }	// mean deviation of the RTT
+	float getOffsetMs() const { return m_offsetMs; }
+
+	// RFC 6298 retransmission timeout (rtt + 4 x jitter, at least minMs), or fallbackMs before the first sample
+	uint32_t getRetransmitTimeoutMs(uint32_t fallbackMs, uint32_t minMs = 50) const;
+
+	// Remote clock reading equivalent to localMs
+	uint32_t toRemoteTime(uint32_t localMs) const;
+
+private:
+	float m_rttMs{ 0.f };
+	float m_jitterMs{ 0.f };
+	float m_offsetMs{ 0.f };
+	uint64_t m_samples{ 0 };
+};
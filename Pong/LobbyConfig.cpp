@@ -0,0 +1,34 @@
+#include "LobbyConfig.h"
+#include <cstdlib>
+#include <optional>
+
+bool LobbyConfig::parse(const std::string& spec, LobbyConfig& out)
+{
+	size_t colon = spec.find(':');
+	int port = DefaultLobbyPort;
+	if (colon != std::string::npos)
+		port = std::atoi(spec.c_str() + colon + 1);
+
+	std::optional<sf::IpAddress> address = sf::IpAddress::resolve(spec.substr(0, colon));
+	if (!address || port <= 0 || port > 65535)
+		return false;
+
+	out.address = *address;
+	out.port = static_cast<unsigned short>(port);
+	return true;
+}
+
+bool LobbyConfig::fromEnvironment(LobbyConfig& out)
+{
+	const char* spec = std::getenv("PONG_LOBBY");
+	if (spec == nullptr || *spec == '\0')
+		return false;
+	return parse(spec, out);
+}
+
+std::string LobbyConfig::describe() const
+{
+	if (!isEnabled())
+		return "none";
+	return address.toString() + ":" + std::to_string(port);
+}
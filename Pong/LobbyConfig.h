@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <SFML/Network.hpp>
+#include "NetProtocol.h"
+
+/// <summary>
+/// @brief Where the lobby service listens, parsed from "ADDRESS[:PORT]" (port defaults to DefaultLobbyPort).
+///
+/// Hosts register with it and guests ask it for a host instead of broadcasting FIND_HOST.
+/// A disabled config (the default) keeps broadcast discovery.
+/// Example usage:
+///		LobbyConfig lobby;
+///		if (LobbyConfig::parse("127.0.0.1:54100", lobby))
+///			hostNet.setLobby(lobby);
+/// </summary>
+struct LobbyConfig {
+	sf::IpAddress address = sf::IpAddress::Any;
+	unsigned short port = 0;
+
+	bool isEnabled() const { return port != 0; }
+
+	/// <summary>
+	/// @brief Parses "ADDRESS[:PORT]". Returns false if the address doesn't resolve or the port is invalid.
+	/// </summary>
+	static bool parse(const std::string& spec, LobbyConfig& out);
+
+	/// <summary>
+	/// @brief Reads the PONG_LOBBY environment variable. False if it is unset or invalid.
+	/// </summary>
+	static bool fromEnvironment(LobbyConfig& out);
+
+	std::string describe() const;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "DatagramSocket.h"
+
+template <typename Owner>
+using MessageHandler = void (Owner::*)(const Datagram& datagram);
+
+// One table entry: datagrams whose first byte is type go to handler
+template <typename Owner>
+struct MessageRoute {
+	uint8_t type;
+	MessageHandler<Owner> handler;
+};
+
+/// <summary>
+/// @brief Message type -> handler table, filled at compile time from a list of routes.
+///
+/// A controller drains its socket once and hands every datagram to dispatch(), so each
+///  message reaches its handler whatever the caller happens to be waiting for.
+/// Example usage (inside an Owner member, so private handlers are reachable):
+///		static constexpr MessageRoute<Owner> Routes[] = { { MessageTypes::PING, &Owner::handlePing } };
+///		static constexpr MessageRouter<Owner> Router(Routes);
+///		Router.dispatch(*this, datagram);
+/// </summary>
+template <typename Owner>
+class MessageRouter
+{
+public:
+	static const size_t TableSize = 256;	// every possible type byte, so lookup needs no range check
+
+	template <size_t Count>
+	constexpr explicit MessageRouter(const MessageRoute<Owner> (&routes)[Count])
+		: m_handlers{}
+	{
+		for (size_t i = 0; i < Count; ++i)
+			m_handlers[routes[i].type] = routes[i].handler;
+	}
+
+	/// <summary>
+	/// @brief Calls the handler for the datagram's type. False if the datagram is empty or the type has none.
+	/// </summary>
+	bool dispatch(Owner& owner, const Datagram& datagram) const
+	{
+		if (datagram.size < 1)
+			return false;
+		MessageHandler<Owner> handler = m_handlers[static_cast<uint8_t>(datagram.data[0])];
+		if (handler == nullptr)
+			return false;
+		(owner.*handler)(datagram);
+		return true;
+	}
+
+private:
+	MessageHandler<Owner> m_handlers[TableSize];
+};
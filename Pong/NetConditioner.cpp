@@ -0,0 +1,216 @@
+#include "NetConditioner.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+	bool parseFloat(const std::string& text, float& out)
+	{
+		char* end = nullptr;
+		out = std::strtof(text.c_str(), &end);
+		return end != text.c_str() && *end == '\0' && out >= 0.f;
+	}
+}
+
+bool NetConditionerConfig::isEnabled() const
+{
+	return delayMs > 0.f || jitterMs > 0.f || lossPercent > 0.f || burstEnterPercent > 0.f ||
+		duplicatePercent > 0.f || reorderPercent > 0.f;
+}
+
+bool NetConditionerConfig::parse(const std::string& spec, NetConditionerConfig& out)
+{
+	NetConditionerConfig config;
+	std::istringstream fields(spec);
+	std::string field;
+
+	while (std::getline(fields, field, ','))
+	{
+		if (field.empty())
+			continue;
+		size_t equals = field.find('=');
+		if (equals == std::string::npos)
+			return false;
+		std::string key = field.substr(0, equals);
+		std::string value = field.substr(equals + 1);
+
+		if (key == "dir")
+		{
+			if (value == "out") config.direction = ConditionerDirection::Outgoing;
+			else if (value == "in") config.direction = ConditionerDirection::Incoming;
+			else if (value == "both") config.direction = ConditionerDirection::Both;
+			else return false;
+			continue;
+		}
+		if (key == "seed")
+		{
+			char* end = nullptr;
+			config.seed = static_cast<uint32_t>(std::strtoul(value.c_str(), &end, 10));
+			if (end == value.c_str() || *end != '\0')
+				return false;
+			continue;
+		}
+
+		float number = 0.f;
+		if (!parseFloat(value, number))
+			return false;
+		if (key == "delay") config.delayMs = number;
+		else if (key == "jitter") config.jitterMs = number;
+		else if (key == "loss") config.lossPercent = number;
+		else if (key == "burst-enter") config.burstEnterPercent = number;
+		else if (key == "burst-exit") config.burstExitPercent = number;
+		else if (key == "burst-loss") config.burstLossPercent = number;
+		else if (key == "dup") config.duplicatePercent = number;
+		else if (key == "reorder") config.reorderPercent = number;
+		else if (key == "reorder-gap") config.reorderGapMs = number;
+		else return false;
+	}
+
+	out = config;
+	return true;
+}
+
+bool NetConditionerConfig::fromEnvironment(NetConditionerConfig& out)
+{
+	const char* spec = std::getenv("PONG_NETEM");
+	if (spec == nullptr || *spec == '\0')
+		return false;
+	return parse(spec, out);
+}
+
+std::string NetConditionerConfig::describe() const
+{
+	std::ostringstream text;
+	text << "delay " << delayMs << " ms, jitter " << jitterMs << " ms, loss " << lossPercent << "%";
+	if (burstEnterPercent > 0.f)
+	{
+		text << ", burst enter " << burstEnterPercent << "% exit " << burstExitPercent
+			<< "% loss " << burstLossPercent << "%";
+	}
+	text << ", dup " << duplicatePercent << "%, reorder " << reorderPercent << "% (+" << reorderGapMs << " ms)"
+		<< ", seed " << seed
+		<< (direction == ConditionerDirection::Outgoing ? ", outgoing" :
+			direction == ConditionerDirection::Incoming ? ", incoming" : ", both ways");
+	return text.str();
+}
+
+NetConditioner::NetConditioner(const NetConditionerConfig& config)
+	: m_config(config),
+	m_rng(config.seed)
+{
+	m_held.reserve(Capacity);
+}
+
+float NetConditioner::uniform()
+{
+	// Built from raw mt19937 output so every standard library gives the same sequence
+	return static_cast<float>(m_rng() >> 8) * (1.f / 16777216.f);
+}
+
+float NetConditioner::normal()
+{
+	// Box-Muller
+	float u1 = uniform();
+	float u2 = uniform();
+	if (u1 < 1e-7f)
+		u1 = 1e-7f;
+	return std::sqrt(-2.f * std::log(u1)) * std::cos(6.2831853f * u2);
+}
+
+bool NetConditioner::chance(float percent)
+{
+	return percent > 0.f && uniform() * 100.f < percent;
+}
+
+sf::Time NetConditioner::pickDelay()
+{
+	float delayMs = m_config.delayMs;
+	if (m_config.jitterMs > 0.f)
+		delayMs += normal() * m_config.jitterMs;
+	if (delayMs < 0.f)
+		delayMs = 0.f;
+	return sf::microseconds(static_cast<int64_t>(delayMs * 1000.f));
+}
+
+void NetConditioner::submit(const Datagram& datagram, sf::Time now)
+{
+	m_stats.submitted++;
+
+	// Gilbert-Elliott: move between the good and lossy states, then lose by the state's rate
+	if (m_config.burstEnterPercent > 0.f)
+	{
+		if (m_burstState ? chance(m_config.burstExitPercent) : chance(m_config.burstEnterPercent))
+			m_burstState = !m_burstState;
+		if (m_burstState && chance(m_config.burstLossPercent))
+		{
+			m_stats.dropped++;
+			m_stats.burstDropped++;
+			return;
+		}
+	}
+	if (chance(m_config.lossPercent))
+	{
+		m_stats.dropped++;
+		return;
+	}
+
+	sf::Time releaseAt = now + pickDelay();
+	if (chance(m_config.reorderPercent))
+	{
+		releaseAt += sf::microseconds(static_cast<int64_t>(m_config.reorderGapMs * 1000.f));
+		m_stats.reordered++;
+	}
+	hold(datagram, releaseAt);
+
+	// The copy takes its own trip
+	if (chance(m_config.duplicatePercent))
+	{
+		hold(datagram, now + pickDelay());
+		m_stats.duplicated++;
+	}
+}
+
+void NetConditioner::hold(const Datagram& datagram, sf::Time releaseAt)
+{
+	if (m_held.size() >= Capacity)
+	{
+		m_stats.overflowed++;
+		return;
+	}
+
+	Held held;
+	held.datagram = datagram;
+	held.releaseAt = releaseAt;
+	held.order = m_order++;
+	m_held.push_back(held);
+	std::push_heap(m_held.begin(), m_held.end(), LaterRelease());
+}
+
+bool NetConditioner::popDue(sf::Time now, Datagram& out)
+{
+	if (m_held.empty() || m_held.front().releaseAt > now)
+		return false;
+
+	std::pop_heap(m_held.begin(), m_held.end(), LaterRelease());
+	out = m_held.back().datagram;
+	out.arrival = m_held.back().releaseAt;
+	m_held.pop_back();
+	return true;
+}
+
+size_t NetConditioner::release(sf::Time now, Datagram* out, size_t maxCount)
+{
+	size_t count = 0;
+	while (count < maxCount && popDue(now, out[count]))
+		count++;
+	return count;
+}
+
+void NetConditioner::release(sf::Time now, std::vector<Datagram>& out)
+{
+	Datagram datagram;
+	while (popDue(now, datagram))
+		out.push_back(datagram);
+}
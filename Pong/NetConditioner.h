@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "DatagramSocket.h"
+
+// Which way a conditioner impairs traffic
+enum class ConditionerDirection : uint8_t {
+	Outgoing = 1,
+	Incoming = 2,
+	Both = 3
+};
+
+/// <summary>
+/// @brief Impairment settings, parsed from a spec such as "delay=40,jitter=10,loss=2,seed=7".
+///
+///		delay=MS		mean one-way delay added to every datagram
+///		jitter=MS		standard deviation of the delay (normal distribution, never below zero)
+///		loss=PCT		independent random loss
+///		burst-enter=PCT	Gilbert-Elliott: chance per datagram of entering the lossy state
+///		burst-exit=PCT	chance per datagram of leaving it again
+///		burst-loss=PCT	loss while in the lossy state (default 100)
+///		dup=PCT			chance a datagram is delivered twice
+///		reorder=PCT		chance a datagram is held back reorder-gap ms so later ones overtake it
+///		reorder-gap=MS	(default 20)
+///		seed=N			RNG seed, so a run can be repeated exactly (default 1)
+///		dir=out|in|both	(default out: each end impairs what it sends)
+/// </summary>
+struct NetConditionerConfig {
+	float delayMs = 0.f;
+	float jitterMs = 0.f;
+	float lossPercent = 0.f;
+	float burstEnterPercent = 0.f;
+	float burstExitPercent = 0.f;
+	float burstLossPercent = 100.f;
+	float duplicatePercent = 0.f;
+	float reorderPercent = 0.f;
+	float reorderGapMs = 20.f;
+	uint32_t seed = 1;
+	ConditionerDirection direction = ConditionerDirection::Outgoing;
+
+	bool isEnabled() const;
+
+	/// <summary>
+	/// @brief Parses a comma-separated key=value spec. Returns false on an unknown key or bad value.
+	/// </summary>
+	static bool parse(const std::string& spec, NetConditionerConfig& out);
+
+	/// <summary>
+	/// @brief Reads the PONG_NETEM environment variable. False if it is unset or invalid.
+	/// </summary>
+	static bool fromEnvironment(NetConditionerConfig& out);
+
+	std::string describe() const;
+};
+
+struct NetConditionerStats {
+	uint64_t submitted = 0;
+	uint64_t dropped = 0;		// random + burst loss
+	uint64_t burstDropped = 0;	// of which in the Gilbert-Elliott lossy state
+	uint64_t duplicated = 0;
+	uint64_t reordered = 0;
+	uint64_t overflowed = 0;	// lost because the hold queue was full
+};
+
+/// <summary>
+/// @brief Holds datagrams back and loses, duplicates or reorders them, like tc/netem but in process.
+///
+/// DatagramSocket passes every outgoing (and/or incoming) datagram through submit(), then
+///  takes the ones whose time has come with release(). With the socket's I/O thread running
+///  release() is called about once a millisecond; without it, on every flush / receive.
+/// All randomness comes from one seeded mt19937, so the same seed and traffic give the
+///  same impairments.
+/// </summary>
+class NetConditioner
+{
+public:
+	static const size_t Capacity = 4096;	// datagrams held at once
+
+	explicit NetConditioner(const NetConditionerConfig& config);
+
+	/// <summary>
+	/// @brief Decides the datagram's fate and, unless lost, holds it until its release time.
+	/// </summary>
+	void submit(const Datagram& datagram, sf::Time now);
+
+	/// <summary>
+	/// @brief Moves datagrams due by now into out (appended, oldest release first), at most maxCount.
+	/// Their arrival is set to the release time.
+	/// </summary>
+	size_t release(sf::Time now, Datagram* out, size_t maxCount);
+	void release(sf::Time now, std::vector<Datagram>& out);
+
+	bool isHolding() const { return !m_held.empty(); }
+	const NetConditionerStats& getStats() const { return m_stats; }
+	const NetConditionerConfig& getConfig() const { return m_config; }
+
+private:
+	struct Held {
+		Datagram datagram;
+		sf::Time releaseAt;
+		uint64_t order = 0;	// submission order, so equal release times keep it
+	};
+	struct LaterRelease {
+		bool operator()(const Held& a, const Held& b) const
+		{
+			return a.releaseAt != b.releaseAt ? a.releaseAt > b.releaseAt : a.order > b.order;
+		}
+	};
+
+	bool chance(float percent);
+	float uniform();		// [0, 1)
+	float normal();			// mean 0, deviation 1
+	sf::Time pickDelay();
+	void hold(const Datagram& datagram, sf::Time releaseAt);
+	bool popDue(sf::Time now, Datagram& out);
+
+	NetConditionerConfig m_config;
+	std::mt19937 m_rng;
+	bool m_burstState{ false };		// Gilbert-Elliott: in the lossy state
+	std::vector<Held> m_held;		// min-heap on release time
+	uint64_t m_order{ 0 };
+	NetConditionerStats m_stats;
+};
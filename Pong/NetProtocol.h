@@ -0,0 +1,246 @@
+#pragma once
+#include <cstdint>
+#include <SFML/Network.hpp>
+#include "PacketSchema.h"
+
+// Wire-level types shared by HostNetworkController and GuestNetworkController
+
+struct NetLogicStates {
+	uint8_t messageType = 0;
+	uint16_t seqNum = 0;	// wraps; compare with sequenceGreaterThan()
+	uint16_t tick = 0;		// host simulation tick the snapshot was taken on (wraps)
+	uint16_t inputAckTick = 0;	// newest guest input tick the host had applied (wraps)
+	float p1Y = 0.f;
+	float p2Y = 0.f;
+	float ballX = 0.f;
+	float ballY = 0.f;
+	float ballVelX = 0.f;
+	float ballVelY = 0.f;
+	unsigned int p1Score = 0;
+	unsigned int p2Score = 0;
+};
+
+// Snapshots kept on both ends so a STATE_DELTA can name any recent baseline
+const int SnapshotHistorySize = 32;
+
+// Changed-field bits of a STATE_DELTA, in the order the fields follow the mask
+enum StateFieldBits : uint8_t {
+	FIELD_P1_Y = 1 << 0,
+	FIELD_P2_Y = 1 << 1,
+	FIELD_BALL_X = 1 << 2,
+	FIELD_BALL_Y = 1 << 3,
+	FIELD_BALL_VEL_X = 1 << 4,
+	FIELD_BALL_VEL_Y = 1 << 5,
+	FIELD_P1_SCORE = 1 << 6,
+	FIELD_P2_SCORE = 1 << 7
+};
+
+enum MessageTypes : uint8_t {
+	FIND_HOST = 1,
+	HOST_HERE = 2,
+	HELLO = 3,
+	HELLO_ACK = 4,
+	GUEST_INPUT = 5,
+	STATE_UPDATE = 6,
+	STATE_DELTA = 7,
+	PING = 8,	// type | sender time ms (uint32)
+	PONG = 9,	// type | echoed PING time ms (uint32) | responder time ms (uint32)
+	RELIABLE = 10,	// ReliableChannel datagram: acks + reliable messages
+	LOBBY_REGISTER = 11,	// host -> lobby: game port | capacity | load (uint16 each)
+	LOBBY_FIND = 12,		// guest -> lobby: asks for a host
+	LOBBY_ASSIGN = 13		// lobby -> guest: host address (uint32) | game port (uint16)
+};
+
+// What a HELLO asks for: a player gets a session and sends input, a spectator only watches
+enum HelloRoles : uint8_t {
+	ROLE_PLAYER = 0,
+	ROLE_SPECTATOR = 1,			// snapshots sent to its own port
+	ROLE_MULTICAST_SPECTATOR = 2	// joined the group named in HELLO_ACK; no copy of its own
+};
+
+// Messages carried inside RELIABLE datagrams (first payload byte)
+enum ReliableMessageTypes : uint8_t {
+	SCORE_EVENT = 1	// kind | host tick (uint16) | left score | right score | game over
+};
+
+// ---- Fixed-layout messages (see PacketSchema.h); STATE_UPDATE / STATE_DELTA are bit-packed by SnapshotCodec ----
+
+// Broadcast by a guest looking for a host
+struct FindHostPacket {
+	static constexpr uint8_t Type = MessageTypes::FIND_HOST;
+	static constexpr auto fields() { return PacketFields<>{}; }
+};
+
+// Host's reply to FIND_HOST: the port it plays on
+struct HostHerePacket {
+	static constexpr uint8_t Type = MessageTypes::HOST_HERE;
+	uint16_t gamePort = 0;
+	static constexpr auto fields() { return PacketFields<&HostHerePacket::gamePort>{}; }
+};
+
+// Guest asking to join: the port it recieves gameplay on. Spectators add their role;
+//  a HELLO without one is from a player.
+struct HelloPacket {
+	static constexpr uint8_t Type = MessageTypes::HELLO;
+	static constexpr size_t RequiredFields = 1;
+	uint16_t guestPort = 0;
+	uint8_t role = ROLE_PLAYER;
+	static constexpr auto fields() { return PacketFields<&HelloPacket::guestPort, &HelloPacket::role>{}; }
+};
+
+// Host accepting a HELLO, with the rate it ticks at (whole Hz); guests step, stamp their inputs
+//  and count snapshot ticks at that rate. A spectator is also told the multicast group (IPv4
+//  address and port) the host sends spectator snapshots to, when it has one.
+struct HelloAckPacket {
+	static constexpr uint8_t Type = MessageTypes::HELLO_ACK;
+	static constexpr size_t RequiredFields = 1;
+	uint16_t tickRate = 0;
+	uint32_t multicastGroup = 0;
+	uint16_t multicastPort = 0;
+	static constexpr auto fields()
+	{
+		return PacketFields<&HelloAckPacket::tickRate, &HelloAckPacket::multicastGroup, &HelloAckPacket::multicastPort>{};
+	}
+};
+
+// One guest input. The host slots it by tick; ackSeq (newest snapshot decoded, for deltas)
+//  and viewTick (host tick on screen, for lag compensation) follow once the guest has a snapshot.
+// It also repeats the inputs of the previousCount ticks before it, two bits each in previous
+//  (tick - 1 in the lowest bits), so the host can fill a lost packet's tick from any later one.
+struct GuestInputPacket {
+	static constexpr uint8_t Type = MessageTypes::GUEST_INPUT;
+	static constexpr size_t RequiredFields = 4;
+	static constexpr int MaxPrevious = 16;
+	uint16_t tick = 0;
+	int8_t input = 0;
+	uint8_t previousCount = 0;
+	uint32_t previous = 0;
+	uint16_t ackSeq = 0;
+	uint16_t viewTick = 0;
+	static constexpr auto fields()
+	{
+		return PacketFields<&GuestInputPacket::tick, &GuestInputPacket::input,
+			&GuestInputPacket::previousCount, &GuestInputPacket::previous,
+			&GuestInputPacket::ackSeq, &GuestInputPacket::viewTick>{};
+	}
+
+	// Input of tick - ago, for ago in 1..previousCount
+	int8_t getPrevious(int ago) const
+	{
+		uint32_t bits = (previous >> (2 * (ago - 1))) & 0x3;
+		return bits == 0x3 ? -1 : static_cast<int8_t>(bits);
+	}
+	void setPrevious(int ago, int8_t value)
+	{
+		int shift = 2 * (ago - 1);
+		previous = (previous & ~(0x3u << shift)) | ((static_cast<uint32_t>(value) & 0x3u) << shift);
+	}
+};
+
+struct PingPacket {
+	static constexpr uint8_t Type = MessageTypes::PING;
+	uint32_t timeMs = 0;	// sender's clock
+	static constexpr auto fields() { return PacketFields<&PingPacket::timeMs>{}; }
+};
+
+struct PongPacket {
+	static constexpr uint8_t Type = MessageTypes::PONG;
+	uint32_t echoMs = 0;	// the PING's time, returned unchanged
+	uint32_t timeMs = 0;	// responder's clock
+	static constexpr auto fields() { return PacketFields<&PongPacket::echoMs, &PongPacket::timeMs>{}; }
+};
+
+// Host telling the lobby service it is up and how full it is. Sent every LobbyHeartbeatMs
+//  and whenever load changes; capacity 0 means the host is leaving.
+struct LobbyRegisterPacket {
+	static constexpr uint8_t Type = MessageTypes::LOBBY_REGISTER;
+	uint16_t gamePort = 0;
+	uint16_t capacity = 0;	// most sessions it takes
+	uint16_t load = 0;		// sessions open now
+	static constexpr auto fields()
+	{
+		return PacketFields<&LobbyRegisterPacket::gamePort, &LobbyRegisterPacket::capacity, &LobbyRegisterPacket::load>{};
+	}
+};
+
+// Guest asking the lobby service for a host, in place of a broadcast FIND_HOST
+struct LobbyFindPacket {
+	static constexpr uint8_t Type = MessageTypes::LOBBY_FIND;
+	static constexpr auto fields() { return PacketFields<>{}; }
+};
+
+// The lobby's answer: the least-loaded host with a free session. Handled like a HOST_HERE
+//  from that host; no answer while every host is full.
+struct LobbyAssignPacket {
+	static constexpr uint8_t Type = MessageTypes::LOBBY_ASSIGN;
+	uint32_t hostAddress = 0;
+	uint16_t gamePort = 0;
+	static constexpr auto fields() { return PacketFields<&LobbyAssignPacket::hostAddress, &LobbyAssignPacket::gamePort>{}; }
+};
+
+// Score change announced by the host, applied by the guest when playback reaches its tick.
+// Travels as a RELIABLE message payload.
+struct ScoreEvent {
+	static constexpr uint8_t Type = ReliableMessageTypes::SCORE_EVENT;
+	uint16_t tick = 0;
+	uint8_t leftScore = 0;
+	uint8_t rightScore = 0;
+	bool gameOver = false;
+	static constexpr auto fields()
+	{
+		return PacketFields<&ScoreEvent::tick, &ScoreEvent::leftScore, &ScoreEvent::rightScore, &ScoreEvent::gameOver>{};
+	}
+};
+
+static_assert(PacketLayout<HostHerePacket>::MaxSize == 3, "HOST_HERE is 3 bytes");
+static_assert(PacketLayout<HelloPacket>::MinSize == 3 && PacketLayout<HelloPacket>::MaxSize == 4, "HELLO is 3 bytes, 4 from a spectator");
+static_assert(PacketLayout<HelloAckPacket>::MinSize == 3 && PacketLayout<HelloAckPacket>::MaxSize == 9, "HELLO_ACK is 3 bytes, 9 with a multicast group");
+static_assert(PacketLayout<GuestInputPacket>::MinSize == 9 && PacketLayout<GuestInputPacket>::MaxSize == 13, "GUEST_INPUT is 9 or 13 bytes");
+static_assert(PacketLayout<GuestInputPacket>::Fields::offsetOf(4) == 9, "ackSeq starts at byte 9");
+static_assert(GuestInputPacket::MaxPrevious * 2 == 32, "previous inputs fill the 32-bit field");
+static_assert(PacketLayout<PingPacket>::MaxSize == 5 && PacketLayout<PongPacket>::MaxSize == 9, "PING/PONG are 5/9 bytes");
+static_assert(PacketLayout<ScoreEvent>::MaxSize == 6, "SCORE_EVENT is 6 bytes");
+static_assert(PacketLayout<LobbyRegisterPacket>::MaxSize == 7 && PacketLayout<LobbyAssignPacket>::MaxSize == 7, "LOBBY_REGISTER/LOBBY_ASSIGN are 7 bytes");
+
+// How often each side measures the round trip
+const uint32_t PingIntervalMs = 250;
+
+// A host with a free session broadcasts HOST_HERE this often, to its port + BeaconPortOffset,
+//  where listening guests pick it up without asking
+const uint32_t HostBeaconIntervalMs = 1000;
+const unsigned short BeaconPortOffset = 1;
+
+// A host registered with a lobby service reports its load this often; the lobby drops one
+//  it hasn't heard from in LobbyHostTimeoutMs
+const uint32_t LobbyHeartbeatMs = 1000;
+const uint32_t LobbyHostTimeoutMs = 3 * LobbyHeartbeatMs;
+const unsigned short DefaultLobbyPort = 54100;
+
+// Big-endian 32-bit fields (PING/PONG timestamps)
+inline void writeUint32(uint8_t* out, uint32_t value)
+{
+	out[0] = (value >> 24) & 0xFF;
+	out[1] = (value >> 16) & 0xFF;
+	out[2] = (value >> 8) & 0xFF;
+	out[3] = value & 0xFF;
+}
+
+inline uint32_t readUint32(const char* in)
+{
+	return (static_cast<uint32_t>(static_cast<uint8_t>(in[0])) << 24) |
+		(static_cast<uint32_t>(static_cast<uint8_t>(in[1])) << 16) |
+		(static_cast<uint32_t>(static_cast<uint8_t>(in[2])) << 8) |
+		static_cast<uint32_t>(static_cast<uint8_t>(in[3]));
+}
+
+// Signed distance from a to b on the wrapping 16-bit sequence line (ticks wrap the same way)
+inline int16_t sequenceDelta(uint16_t a, uint16_t b)
+{
+	return static_cast<int16_t>(static_cast<uint16_t>(b - a));
+}
+
+// True if sequence number a is newer than b on the wrapping 16-bit sequence line
+inline bool sequenceGreaterThan(uint16_t a, uint16_t b)
+{
+	return sequenceDelta(b, a) > 0;
+}
@@ -0,0 +1,188 @@
+#include "NetStats.h"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	// Names of MessageTypes in id order, for the overlay and CSV columns
+	const char* const TypeNames[] = {
+		"UNKNOWN", "FIND_HOST", "HOST_HERE", "HELLO", "HELLO_ACK", "GUEST_INPUT",
+		"STATE_UPDATE", "STATE_DELTA", "PING", "PONG", "RELIABLE"
+	};
+	const int NamedTypeCount = sizeof(TypeNames) / sizeof(TypeNames[0]);
+
+	// Sequence jumps bigger than this are a restart, not loss
+	const int MaxSequenceGap = 1000;
+}
+
+int NetStats::slotFor(uint8_t messageType)
+{
+	return messageType < NetStatsWindow::TypeCount ? messageType : 0;
+}
+
+const char* NetStats::getTypeName(int messageType)
+{
+	if (messageType < 0 || messageType >= NamedTypeCount)
+		return TypeNames[0];
+	return TypeNames[messageType];
+}
+
+void NetStats::recordSent(uint8_t messageType, size_t bytes)
+{
+	MessageTypeCounters& type = m_current.types[slotFor(messageType)];
+	type.packetsSent++;
+	type.bytesSent += static_cast<uint32_t>(bytes);
+	m_current.total.packetsSent++;
+	m_current.total.bytesSent += static_cast<uint32_t>(bytes);
+}
+
+void NetStats::recordRecieved(uint8_t messageType, size_t bytes)
+{
+	MessageTypeCounters& type = m_current.types[slotFor(messageType)];
+	type.packetsReceived++;
+	type.bytesReceived += static_cast<uint32_t>(bytes);
+	m_current.total.packetsReceived++;
+	m_current.total.bytesReceived += static_cast<uint32_t>(bytes);
+}
+
+void NetStats::recordSequence(uint16_t sequence, uint32_t nowMs)
+{
+	if (!m_hasSeq)
+	{
+		m_highestSeq = sequence;
+		m_highestArrivalMs = nowMs;
+		m_hasSeq = true;
+		m_current.expected++;
+		return;
+	}
+
+	int gap = static_cast<int16_t>(static_cast<uint16_t>(sequence - m_highestSeq));
+	if (gap <= 0)
+	{
+		// Behind the newest: either a reordered packet we already counted as lost, or a duplicate
+		m_current.outOfOrder++;
+		if (gap < 0 && m_current.lost > 0)
+			m_current.lost--;
+		return;
+	}
+
+	if (gap > MaxSequenceGap)
+	{
+		// Peer restarted its sequence (new match); start counting again from here
+		m_highestSeq = sequence;
+		m_highestArrivalMs = nowMs;
+		m_current.expected++;
+		return;
+	}
+
+	m_current.expected += gap;
+	m_current.lost += gap - 1;
+
+	// RFC 3550: difference between the arrival spacing and the spacing the peer sent them at
+	float transitMs = static_cast<float>(static_cast<int32_t>(nowMs - m_highestArrivalMs)) - gap * m_sendIntervalMs;
+	m_jitterMs += (std::fabs(transitMs) - m_jitterMs) / 16.f;
+
+	m_highestSeq = sequence;
+	m_highestArrivalMs = nowMs;
+}
+
+bool NetStats::update(uint32_t nowMs)
+{
+	if (!m_started)
+	{
+		m_windowStartMs = nowMs;
+		m_started = true;
+		return false;
+	}
+	if (nowMs - m_windowStartMs < WindowMs)
+		return false;
+
+	m_current.jitterMs = m_jitterMs;
+	m_current.rttMs = m_rttMs;
+	m_current.hasRtt = m_hasRtt;
+
+	m_last = m_current;
+	m_current = NetStatsWindow();
+	m_windowCount++;
+
+	// Keep whole-second steps unless we fell far behind (e.g. a long hitch)
+	m_windowStartMs += WindowMs;
+	if (nowMs - m_windowStartMs >= WindowMs)
+		m_windowStartMs = nowMs;
+	return true;
+}
+
+void NetStats::reset()
+{
+	float sendIntervalMs = m_sendIntervalMs;
+	*this = NetStats();
+	m_sendIntervalMs = sendIntervalMs;
+}
+
+std::string NetStats::describe() const
+{
+	const NetStatsWindow& w = m_last;
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(1);
+
+	text << "rtt ";
+	if (w.hasRtt)
+		text << w.rttMs << " ms";
+	else
+		text << "--";
+	text << "   jitter " << w.jitterMs << " ms\n";
+
+	text << "loss " << w.getLossPercent() << "% (" << w.lost << "/" << w.expected << ")"
+		<< "   out of order " << w.outOfOrder << "\n";
+
+	text << "out " << w.total.packetsSent << " pkt/s " << w.total.bytesSent << " B/s"
+		<< "   in " << w.total.packetsReceived << " pkt/s " << w.total.bytesReceived << " B/s\n";
+
+	for (int i = 0; i < NetStatsWindow::TypeCount; ++i)
+	{
+		const MessageTypeCounters& type = w.types[i];
+		if (type.packetsSent == 0 && type.packetsReceived == 0)
+			continue;
+
+		text << "  " << getTypeName(i) << ":";
+		if (type.packetsSent > 0)
+			text << " out " << type.packetsSent << "/s " << type.bytesSent << " B/s";
+		if (type.packetsReceived > 0)
+			text << " in " << type.packetsReceived << "/s " << type.bytesReceived << " B/s";
+		text << "\n";
+	}
+	return text.str();
+}
+
+void NetStats::writeCsvHeader(std::ostream& out)
+{
+	out << "second,connection,packets_out,bytes_out,packets_in,bytes_in,expected,lost,loss_percent,out_of_order,jitter_ms,rtt_ms";
+	for (int i = 1; i < NamedTypeCount; ++i)
+	{
+		const char* name = getTypeName(i);
+		out << "," << name << "_packets_out," << name << "_bytes_out,"
+			<< name << "_packets_in," << name << "_bytes_in";
+	}
+	out << "\n";
+}
+
+void NetStats::writeCsvRow(std::ostream& out, const std::string& connection) const
+{
+	const NetStatsWindow& w = m_last;
+	out << m_windowCount << "," << connection << ","
+		<< w.total.packetsSent << "," << w.total.bytesSent << ","
+		<< w.total.packetsReceived << "," << w.total.bytesReceived << ","
+		<< w.expected << "," << w.lost << "," << w.getLossPercent() << ","
+		<< w.outOfOrder << "," << w.jitterMs << ",";
+	if (w.hasRtt)
+		out << w.rttMs;
+
+	for (int i = 1; i < NamedTypeCount; ++i)
+	{
+		const MessageTypeCounters& type = w.types[i];
+		out << "," << type.packetsSent << "," << type.bytesSent
+			<< "," << type.packetsReceived << "," << type.bytesReceived;
+	}
+	out << "\n";
+}
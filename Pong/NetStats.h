@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Traffic of one message type over one second
+struct MessageTypeCounters {
+	uint32_t packetsSent = 0;
+	uint32_t bytesSent = 0;
+	uint32_t packetsReceived = 0;
+	uint32_t bytesReceived = 0;
+};
+
+// One completed one-second window of a connection
+struct NetStatsWindow {
+	static const int TypeCount = 16;	// indexed by MessageTypes; slot 0 collects unknown types
+	MessageTypeCounters types[TypeCount];
+	MessageTypeCounters total;
+
+	uint32_t expected = 0;		// sequenced packets the peer sent, judging by the sequence gaps
+	uint32_t lost = 0;			// gaps not filled by a late arrival
+	uint32_t outOfOrder = 0;	// arrived behind a newer sequence number
+	float jitterMs = 0.f;		// RFC 3550 inter-arrival jitter against the send interval
+	float rttMs = 0.f;
+	bool hasRtt = false;
+
+	float getLossPercent() const { return expected > 0 ? 100.f * lost / expected : 0.f; }
+};
+
+/// <summary>
+/// @brief Per-connection traffic statistics, kept by the network controllers for one peer.
+///
+/// Every datagram sent to or recieved from the peer is counted by message type. The peer's
+///  sequenced stream (snapshot seqNum on the guest, input tick on the host) is used to infer
+///  loss from gaps, count reordering and measure inter-arrival jitter. Counters accumulate
+///  into the current window; update() closes it once a second so the overlay and CSV always
+///  show whole seconds.
+/// Example usage:
+///		stats.recordSent(buffer[0], size);
+///		stats.recordRecieved(data[0], size);
+///		stats.recordSequence(state.seqNum, nowMs);
+///		stats.update(nowMs);							// once per frame / tick
+///		if (stats.getWindowCount() != seen) { ... stats.getLastWindow() ... }
+/// </summary>
+class NetStats
+{
+public:
+	static const uint32_t WindowMs = 1000;
+
+	void recordSent(uint8_t messageType, size_t bytes);
+	void recordRecieved(uint8_t messageType, size_t bytes);
+
+	/// <summary>
+	/// @brief Feeds the sequence number of a recieved packet from a stream sent once per send interval.
+	/// </summary>
+	void recordSequence(uint16_t sequence, uint32_t nowMs);
+
+	// How often the peer sends its sequenced stream, for the jitter estimate (default: one tick at 60Hz)
+	void setSendIntervalMs(float intervalMs) { m_sendIntervalMs = intervalMs; }
+
+	// Latest smoothed RTT, reported with the window it closes in
+	void setRtt(float rttMs) { m_rttMs = rttMs; m_hasRtt = true; }
+
+	/// <summary>
+	/// @brief Closes the current window once WindowMs has passed. Returns true when it did.
+	/// </summary>
+	bool update(uint32_t nowMs);
+
+	// Last completed window, and how many have completed (changes once per second)
+	const NetStatsWindow& getLastWindow() const { return m_last; }
+	uint64_t getWindowCount() const { return m_windowCount; }
+
+	void reset();
+
+	/// <summary>
+	/// @brief Multi-line summary of the last window for the on-screen overlay.
+	/// </summary>
+	std::string describe() const;
+
+	/// <summary>
+	/// @brief CSV header and one row per completed window. connection names the peer.
+	/// </summary>
+	static void writeCsvHeader(std::ostream& out);
+	void writeCsvRow(std::ostream& out, const std::string& connection) const;
+
+	static const char* getTypeName(int messageType);
+
+private:
+	static int slotFor(uint8_t messageType);
+
+	NetStatsWindow m_current;
+	NetStatsWindow m_last;
+	uint64_t m_windowCount{ 0 };
+	uint32_t m_windowStartMs{ 0 };
+	bool m_started{ false };
+
+	// Sequence tracking for loss / reordering / jitter
+	uint16_t m_highestSeq{ 0 };
+	uint32_t m_highestArrivalMs{ 0 };
+	bool m_hasSeq{ false };
+	float m_jitterMs{ 0.f };
+	float m_sendIntervalMs{ 1000.f / 60.f };
+
+	float m_rttMs{ 0.f };
+	bool m_hasRtt{ false };
+};
@@ -0,0 +1,197 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// How one field type goes on the wire: fixed width, big-endian
+template <typename T>
+struct WireField;
+
+template <>
+struct WireField<uint8_t> {
+	static constexpr size_t Size = 1;
+	static void write(uint8_t* out, uint8_t value) { out[0] = value; }
+	static uint8_t read(const uint8_t* in) { return in[0]; }
+};
+
+template <>
+struct WireField<int8_t> {
+	static constexpr size_t Size = 1;
+	static void write(uint8_t* out, int8_t value) { out[0] = static_cast<uint8_t>(value); }
+	static int8_t read(const uint8_t* in) { return static_cast<int8_t>(in[0]); }
+};
+
+template <>
+struct WireField<bool> {
+	static constexpr size_t Size = 1;
+	static void write(uint8_t* out, bool value) { out[0] = value ? 1 : 0; }
+	static bool read(const uint8_t* in) { return in[0] != 0; }
+};
+
+template <>
+struct WireField<uint16_t> {
+	static constexpr size_t Size = 2;
+	static void write(uint8_t* out, uint16_t value)
+	{
+		out[0] = (value >> 8) & 0xFF;
+		out[1] = value & 0xFF;
+	}
+	static uint16_t read(const uint8_t* in) { return static_cast<uint16_t>((in[0] << 8) | in[1]); }
+};
+
+template <>
+struct WireField<uint32_t> {
+	static constexpr size_t Size = 4;
+	static void write(uint8_t* out, uint32_t value)
+	{
+		out[0] = (value >> 24) & 0xFF;
+		out[1] = (value >> 16) & 0xFF;
+		out[2] = (value >> 8) & 0xFF;
+		out[3] = value & 0xFF;
+	}
+	static uint32_t read(const uint8_t* in)
+	{
+		return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+			(static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+	}
+};
+
+namespace PacketSchemaDetail
+{
+	template <typename Class, typename T>
+	T memberType(T Class::*);
+
+	template <auto Member>
+	using Field = WireField<decltype(memberType(Member))>;
+
+	// Packets may declare RequiredFields; the fields after it are an optional tail
+	template <typename Packet, typename = void>
+	struct RequiredCount { static constexpr size_t Value = decltype(Packet::fields())::Count; };
+	template <typename Packet>
+	struct RequiredCount<Packet, std::void_t<decltype(Packet::RequiredFields)>> { static constexpr size_t Value = Packet::RequiredFields; };
+}
+
+/// <summary>
+/// @brief Ordered list of a packet's fields, as pointers to its members.
+/// Sizes and offsets are constants; write/read are unrolled per field at compile time.
+/// </summary>
+template <auto... Members>
+struct PacketFields
+{
+	static constexpr size_t Count = sizeof...(Members);
+
+	// Bytes taken by the first count fields (all of them by default)
+	static constexpr size_t sizeOf(size_t count = Count)
+	{
+		constexpr size_t sizes[] = { PacketSchemaDetail::Field<Members>::Size..., 0 };
+		size_t total = 0;
+		for (size_t i = 0; i < count && i < Count; ++i)
+			total += sizes[i];
+		return total;
+	}
+
+	// Offset of field index from the start of the packet, after the type byte
+	static constexpr size_t offsetOf(size_t index) { return 1 + sizeOf(index); }
+
+	// Writes the first count fields from out; returns bytes written
+	template <typename Packet>
+	static size_t write(const Packet& packet, uint8_t* out, size_t count)
+	{
+		uint8_t* cursor = out;
+		size_t index = 0;
+		(writeField<Members>(packet, cursor, index++ < count), ...);
+		return static_cast<size_t>(cursor - out);
+	}
+
+	template <typename Packet>
+	static void read(const uint8_t* in, Packet& packet, size_t count)
+	{
+		size_t index = 0;
+		(readField<Members>(in, packet, index++ < count), ...);
+	}
+
+private:
+	template <auto Member, typename Packet>
+	static void writeField(const Packet& packet, uint8_t*& cursor, bool include)
+	{
+		using Field = PacketSchemaDetail::Field<Member>;
+		if (!include)
+			return;
+		Field::write(cursor, packet.*Member);
+		cursor += Field::Size;
+	}
+
+	template <auto Member, typename Packet>
+	static void readField(const uint8_t*& cursor, Packet& packet, bool include)
+	{
+		using Field = PacketSchemaDetail::Field<Member>;
+		if (!include)
+			return;
+		packet.*Member = Field::read(cursor);
+		cursor += Field::Size;
+	}
+};
+
+/// <summary>
+/// @brief Compile-time facts about a packet declared with the schema.
+///
+/// A packet is a plain struct with its type byte and its fields, listed once:
+///		struct PingPacket {
+///			static constexpr uint8_t Type = MessageTypes::PING;
+///			uint32_t timeMs = 0;
+///			static constexpr auto fields() { return PacketFields<&PingPacket::timeMs>{}; }
+///		};
+/// (fields() is a function so the member pointers are formed once the struct is complete.)
+/// Optionally, RequiredFields = N makes the fields after the first N an all-or-nothing tail.
+/// </summary>
+template <typename Packet>
+struct PacketLayout
+{
+	using Fields = decltype(Packet::fields());
+	static constexpr size_t RequiredFields = PacketSchemaDetail::RequiredCount<Packet>::Value;
+	static constexpr size_t MinSize = 1 + Fields::sizeOf(RequiredFields);
+	static constexpr size_t MaxSize = 1 + Fields::sizeOf();
+
+	static_assert(RequiredFields <= Fields::Count, "RequiredFields is larger than the field list");
+};
+
+/// <summary>
+/// @brief Writes the type byte and fields straight into out (e.g. a staged Datagram).
+/// withOptional = false leaves off the optional tail. Returns the size, 0 if it didn't fit.
+/// </summary>
+template <typename Packet>
+size_t encodePacket(const Packet& packet, void* out, size_t capacity, bool withOptional = true)
+{
+	using Layout = PacketLayout<Packet>;
+	size_t count = withOptional ? Layout::Fields::Count : Layout::RequiredFields;
+	if (capacity < 1 + Layout::Fields::sizeOf(count))
+		return 0;
+
+	uint8_t* bytes = static_cast<uint8_t*>(out);
+	bytes[0] = Packet::Type;
+	return 1 + Layout::Fields::write(packet, bytes + 1, count);
+}
+
+/// <summary>
+/// @brief Reads a packet in place from a recieved buffer.
+/// Returns false on the wrong type byte or a size below MinSize. The optional tail is read
+///  when the whole of it is present; hasOptional() tells the caller whether it was.
+/// </summary>
+template <typename Packet>
+bool decodePacket(const void* data, size_t size, Packet& out)
+{
+	using Layout = PacketLayout<Packet>;
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	if (size < Layout::MinSize || bytes[0] != Packet::Type)
+		return false;
+
+	size_t count = size >= Layout::MaxSize ? Layout::Fields::Count : Layout::RequiredFields;
+	Layout::Fields::read(bytes + 1, out, count);
+	return true;
+}
+
+template <typename Packet>
+constexpr bool hasOptional(size_t size)
+{
+	return PacketLayout<Packet>::RequiredFields < PacketLayout<Packet>::Fields::Count && size >= PacketLayout<Packet>::MaxSize;
+}
@@ -0,0 +1,73 @@
+#include "PaddlePredictor.h"
+#include <cmath>
+#include "NetProtocol.h"
+#include "PongSim.h"
+
+PaddlePredictor::PaddlePredictor()
+{
+	reset(0.f);
+}
+
+void PaddlePredictor::reset(float paddleY)
+{
+	for (Entry& entry : m_history)
+		entry.valid = false;
+
+	m_predictedY = paddleY;
+	m_newestTick = 0;
+	m_lastAckTick = 0;
+	m_hasInput = false;
+	m_hasAck = false;
+}
+
+void PaddlePredictor::applyInput(uint16_t tick, int8_t input, float dt)
+{
+	Entry& entry = m_history[tick % HistorySize];
+	entry.tick = tick;
+	entry.input = input;
+	entry.dt = dt;
+	entry.valid = true;
+
+	m_newestTick = tick;
+	m_hasInput = true;
+
+	PongSim::stepPaddle(m_predictedY, input, dt);
+}
+
+void PaddlePredictor::reconcile(uint16_t ackTick, float authoritativeY)
+{
+	// A reordered snapshot older than one we already used
+	if (m_hasAck && sequenceDelta(m_lastAckTick, ackTick) < 0)
+		return;
+	m_lastAckTick = ackTick;
+	m_hasAck = true;
+
+	float y = authoritativeY;
+
+	// Inputs sent after ackTick that the host hasn't applied yet. Anything beyond the
+	//  history (or an ack from before we started sending) just replays what we still have.
+	if (m_hasInput)
+	{
+		int pending = sequenceDelta(ackTick, m_newestTick);
+		if (pending > HistorySize)
+			pending = HistorySize;
+
+		for (int i = pending - 1; i >= 0; --i)
+		{
+			uint16_t tick = static_cast<uint16_t>(m_newestTick - i);
+			const Entry& entry = m_history[tick % HistorySize];
+			if (entry.valid && entry.tick == tick)
+				PongSim::stepPaddle(y, entry.input, entry.dt);
+		}
+	}
+
+	float correction = std::fabs(y - m_predictedY);
+	m_stats.reconciles++;
+	m_stats.lastCorrection = correction;
+	if (correction > m_stats.maxCorrection)
+		m_stats.maxCorrection = correction;
+	if (correction > CorrectionEpsilon)
+		m_stats.corrections++;
+
+	m_predictedY = y;
+}
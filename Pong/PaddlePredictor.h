@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+
+// Size of the corrections reconcile() has had to make, for the debug readout
+struct PredictionStats {
+	uint64_t reconciles = 0;		// authoritative states applied
+	uint64_t corrections = 0;		// reconciles that moved the paddle by more than CorrectionEpsilon
+	float lastCorrection = 0.f;		// pixels
+	float maxCorrection = 0.f;		// pixels
+};
+
+/// <summary>
+/// @brief Guest-side prediction of the guest's own paddle.
+///
+/// The guest moves its paddle straight away from its own input (using PongSim::stepPaddle,
+///  the same move the host makes) and keeps every input it sent by tick. Each authoritative
+///  snapshot says which input tick the host had applied; reconcile() restarts from the host's
+///  paddle position at that tick and replays the inputs the host hasn't seen yet.
+/// Example usage:
+///		predictor.applyInput(tick, input, dt);				// every tick, alongside sendInput
+///		predictor.reconcile(state.inputAckTick, state.p2Y);	// for every newer snapshot
+///		paddle.setPosition({ x, predictor.getPredictedY() });
+/// </summary>
+class PaddlePredictor
+{
+public:
+	static const uint16_t HistorySize = 128;
+	static constexpr float CorrectionEpsilon = 0.5f;
+
+	PaddlePredictor();
+
+	/// <summary>
+	/// @brief Forgets all inputs and puts the predicted paddle at paddleY.
+	/// </summary>
+	void reset(float paddleY);
+
+	/// <summary>
+	/// @brief Records the input sent for tick and moves the predicted paddle by it.
+	/// </summary>
+	void applyInput(uint16_t tick, int8_t input, float dt);
+
+	/// <summary>
+	/// @brief Rewinds to the host's paddle position after ackTick and replays the later inputs.
+	/// Acks older than one already reconciled are ignored.
+	/// </summary>
+	void reconcile(uint16_t ackTick, float authoritativeY);
+
+	float getPredictedY() const { return m_predictedY; }
+
+	const PredictionStats& getStats() const { return m_stats; }
+	void resetStats() { m_stats = PredictionStats(); }
+
+private:
+	struct Entry {
+		uint16_t tick = 0;
+		int8_t input = 0;
+		float dt = 0.f;
+		bool valid = false;
+	};
+
+	Entry m_history[HistorySize];
+	float m_predictedY{ 0.f };
+	uint16_t m_newestTick{ 0 };		// newest input applied locally
+	uint16_t m_lastAckTick{ 0 };	// newest input tick the host has confirmed
+	bool m_hasInput{ false };
+	bool m_hasAck{ false };
+
+	PredictionStats m_stats;
+};
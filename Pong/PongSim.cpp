@@ -0,0 +1,160 @@
+#include "PongSim.h"
+#include <cmath>
+#include <cstring>
+
+// Keep every multiply and add separately rounded, so an FMA-capable build steps the same as any other
+#if defined(_MSC_VER)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace
+{
+	// Place the ball in the centre of the arena with the given serve velocity
+	void serveBall(PongSimState& state, float velX, float velY)
+	{
+		state.ballX = (float)ScreenSize::s_width / 2.f - PongSim::BallRadius;
+		state.ballY = (float)ScreenSize::s_height / 2.f - PongSim::BallRadius;
+		state.ballVelX = velX;
+		state.ballVelY = velY;
+	}
+
+	// Low byte first, so the hash doesn't depend on the machine's byte order
+	void hashWord(uint64_t& hash, uint32_t word)
+	{
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			hash ^= (word >> shift) & 0xFF;
+			hash *= 1099511628211ull;
+		}
+	}
+
+	void hashFloat(uint64_t& hash, float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		hashWord(hash, bits);
+	}
+
+	// Keep paddles inside the screen
+	void clampPaddle(float& paddleY)
+	{
+		if (paddleY < 0.f)
+			paddleY = 0.f;
+		if (paddleY + PongSim::PaddleHeight > (float)ScreenSize::s_height)
+			paddleY = (float)ScreenSize::s_height - PongSim::PaddleHeight;
+	}
+}
+
+bool PongSim::ballIntersectsPaddle(const PongSimState& state, float paddleX, float paddleY)
+{
+	float ballSize = BallRadius * 2.f;
+	return !(state.ballX + ballSize < paddleX || state.ballX > paddleX + PaddleWidth ||
+		state.ballY + ballSize < paddleY || state.ballY > paddleY + PaddleHeight);
+}
+
+void PongSim::bounceOffPaddle(PongSimState& state, bool rightPaddle)
+{
+	if (rightPaddle)
+	{
+		state.ballX = RightPaddleX - BallRadius * 2.f - 0.1f;
+		state.ballVelX = -std::abs(state.ballVelX);
+	}
+	else
+	{
+		state.ballX = LeftPaddleX + PaddleWidth + 0.1f;
+		state.ballVelX = std::abs(state.ballVelX);
+	}
+}
+
+void PongSim::reset(PongSimState& state)
+{
+	state.leftScore = 0;
+	state.rightScore = 0;
+	state.gameOver = false;
+	state.leftPaddleY = (float)ScreenSize::s_height / 2.f - PaddleHeight / 2.f;
+	state.rightPaddleY = (float)ScreenSize::s_height / 2.f - PaddleHeight / 2.f;
+	serveBall(state, -400.f, -250.f);
+}
+
+void PongSim::stepPaddle(float& paddleY, int8_t input, float dt)
+{
+	paddleY += input * PaddleSpeed * dt;
+	clampPaddle(paddleY);
+}
+
+void PongSim::step(PongSimState& state, int8_t leftInput, int8_t rightInput, float dt)
+{
+	if (state.gameOver)
+		return;
+	state.tick++;
+
+	// Paddle movement
+	stepPaddle(state.leftPaddleY, leftInput, dt);
+	stepPaddle(state.rightPaddleY, rightInput, dt);
+
+	// Move ball
+	state.ballX += state.ballVelX * dt;
+	state.ballY += state.ballVelY * dt;
+
+	// Ball collision with top/bottom
+	float ballSize = BallRadius * 2.f;
+	if (state.ballY <= 0.f)
+	{
+		state.ballY = 0.f;
+		state.ballVelY = -state.ballVelY;
+	}
+	if (state.ballY + ballSize >= (float)ScreenSize::s_height)
+	{
+		state.ballY = (float)ScreenSize::s_height - ballSize;
+		state.ballVelY = -state.ballVelY;
+	}
+
+	// Ball collision with paddles (both tests use the position before either bounce)
+	bool intersectsLeft = ballIntersectsPaddle(state, LeftPaddleX, state.leftPaddleY);
+	bool intersectsRight = ballIntersectsPaddle(state, RightPaddleX, state.rightPaddleY);
+	if (intersectsLeft)
+		bounceOffPaddle(state, false);
+	if (intersectsRight)
+		bounceOffPaddle(state, true);
+
+	// Ball out of bounds - simple reset and score
+	if (state.ballX < -50.f)
+	{
+		// right player scores
+		state.rightScore++;
+		serveBall(state, -400.f, -250.f);
+	}
+	else if (state.ballX > (float)ScreenSize::s_width + 50.f)
+	{
+		// left player scores
+		state.leftScore++;
+		serveBall(state, 400.f, 250.f);
+	}
+
+	// Check win conditions
+	if (state.leftScore >= WinScore || state.rightScore >= WinScore)
+	{
+		state.gameOver = true;
+	}
+}
+
+uint64_t PongSim::checksum(const PongSimState& state)
+{
+	// Field by field, so padding never leaks in
+	uint64_t hash = 14695981039346656037ull;
+	hashFloat(hash, state.leftPaddleY);
+	hashFloat(hash, state.rightPaddleY);
+	hashFloat(hash, state.ballX);
+	hashFloat(hash, state.ballY);
+	hashFloat(hash, state.ballVelX);
+	hashFloat(hash, state.ballVelY);
+	hashWord(hash, static_cast<uint32_t>(state.leftScore));
+	hashWord(hash, static_cast<uint32_t>(state.rightScore));
+	hashWord(hash, state.gameOver ? 1u : 0u);
+	hashWord(hash, state.tick);
+	return hash;
+}
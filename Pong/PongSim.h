@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// @brief Graphics-free Pong rules shared by the windowed game and the headless server.
+///
+/// Everything the host needs to run a match lives in PongSimState as plain data,
+///  so the simulation can be stepped without an sf::RenderWindow, font or shapes.
+/// Game copies the state into its shapes for drawing after every step.
+/// </summary>
+
+struct ScreenSize
+{
+public:
+	static const int s_width{ 1440 };
+
+	static const int s_height{ 900 };
+};
+
+struct PongSimState
+{
+	float leftPaddleY = 0.f;
+	float rightPaddleY = 0.f;
+	float ballX = 0.f;
+	float ballY = 0.f;
+	float ballVelX = -400.f;
+	float ballVelY = -250.f;
+	int leftScore = 0;
+	int rightScore = 0;
+	bool gameOver = false;
+	uint32_t tick = 0;	// steps taken; keeps counting across reset() so snapshots stay ordered
+};
+
+// One step's paddle inputs: -1 (up), 0 (none) or 1 (down)
+struct PongSimInputs
+{
+	int8_t left = 0;
+	int8_t right = 0;
+};
+
+namespace PongSim
+{
+	// Object sizes and positions (top-left origin, same as the SFML shapes)
+	constexpr float PaddleWidth = 20.f;
+	constexpr float PaddleHeight = 120.f;
+	constexpr float PaddleInset = 50.f;
+	constexpr float LeftPaddleX = PaddleInset;
+	constexpr float RightPaddleX = (float)ScreenSize::s_width - PaddleInset - PaddleWidth;
+	constexpr float BallRadius = 10.f;
+	constexpr float PaddleSpeed = 600.f;
+	constexpr int WinScore = 5;
+	constexpr float TickRate = 60.f;	// steps per second in the windowed game (and the headless default)
+
+	/// <summary>
+	/// @brief Puts paddles and ball back in the centre and clears the scores.
+	/// </summary>
+	void reset(PongSimState& state);
+
+	/// <summary>
+	/// @brief Advances the match by one step.
+	/// Inputs are -1 (up), 0 (none) or 1 (down) for each paddle.
+	/// Does nothing once the match is over.
+	/// </summary>
+	/// <param name="dt">step length in seconds</param>
+	void step(PongSimState& state, int8_t leftInput, int8_t rightInput, float dt);
+	inline void step(PongSimState& state, const PongSimInputs& inputs, float dt) { step(state, inputs.left, inputs.right, dt); }
+
+	/// <summary>
+	/// @brief FNV-1a hash of every field's bit pattern. Equal states hash equal on every platform,
+	/// so two runs (or two machines) can compare a whole match by one number.
+	/// </summary>
+	uint64_t checksum(const PongSimState& state);
+
+	/// <summary>
+	/// @brief Moves one paddle by one step of input and keeps it on screen.
+	/// The guest predicts its own paddle with this, so it must stay the exact move step() makes.
+	/// </summary>
+	void stepPaddle(float& paddleY, int8_t input, float dt);
+
+	/// <summary>
+	/// @brief AABB test between the ball in state and a paddle whose top-left is (paddleX, paddleY).
+	/// </summary>
+	bool ballIntersectsPaddle(const PongSimState& state, float paddleX, float paddleY);
+
+	/// <summary>
+	/// @brief Sends the ball back off the left or right paddle, the same way step() does on contact.
+	/// </summary>
+	void bounceOffPaddle(PongSimState& state, bool rightPaddle);
+}
@@ -0,0 +1,224 @@
+#include "ReliableChannel.h"
+#include <cstring>
+#include "NetProtocol.h"
+
+namespace
+{
+	const uint8_t FlagHasAck = 1 << 0;
+}
+
+ReliableChannel::ReliableChannel()
+{
+	reset();
+}
+
+void ReliableChannel::reset()
+{
+	for (Outgoing& outgoing : m_outgoing)
+		outgoing.valid = false;
+	for (Incoming& incoming : m_incoming)
+		incoming.valid = false;
+	m_delivered.clear();
+
+	m_nextSeq = 0;
+	m_nextDeliver = 0;
+	m_remoteNewest = 0;
+	m_remoteBits = 0;
+	m_hasRemote = false;
+	m_ackOwed = false;
+	m_stats = ReliableChannelStats();
+}
+
+bool ReliableChannel::send(const uint8_t* payload, size_t size)
+{
+	if (size > MaxPayload)
+		return false;
+
+	Outgoing& slot = m_outgoing[m_nextSeq % WindowSize];
+	if (slot.valid)
+		return false; // WindowSize messages still unacknowledged
+
+	slot.seq = m_nextSeq++;
+	std::memcpy(slot.payload, payload, size);
+	slot.size = static_cast<uint8_t>(size);
+	slot.sent = false;
+	slot.valid = true;
+	return true;
+}
+
+size_t ReliableChannel::buildPacket(uint32_t nowMs, uint32_t retransmitMs, uint8_t* out, size_t capacity)
+{
+	if (capacity < HeaderSize)
+		return 0;
+
+	size_t size = HeaderSize;
+	uint8_t count = 0;
+
+	// Oldest first, so the receiver can deliver as early as possible
+	for (uint16_t i = 0; i < WindowSize; ++i)
+	{
+		Outgoing& slot = m_outgoing[static_cast<uint16_t>(m_nextSeq - WindowSize + i) % WindowSize];
+		if (!slot.valid)
+			continue;
+		if (slot.sent && nowMs - slot.lastSentMs < retransmitMs)
+			continue;
+		if (size + 3 + slot.size > capacity)
+			break;
+
+		out[size++] = (slot.seq >> 8) & 0xFF;
+		out[size++] = slot.seq & 0xFF;
+		out[size++] = slot.size;
+		std::memcpy(&out[size], slot.payload, slot.size);
+		size += slot.size;
+
+		if (slot.sent)
+			m_stats.retransmits++;
+		else
+			m_stats.messagesSent++;
+		slot.sent = true;
+		slot.lastSentMs = nowMs;
+		count++;
+	}
+
+	if (count == 0 && !m_ackOwed)
+		return 0;
+
+	out[0] = MessageTypes::RELIABLE;
+	out[1] = m_hasRemote ? FlagHasAck : 0;
+	out[2] = (m_remoteNewest >> 8) & 0xFF;
+	out[3] = m_remoteNewest & 0xFF;
+	writeUint32(&out[4], m_remoteBits);
+	out[8] = count;
+
+	m_ackOwed = false;
+	m_stats.packetsSent++;
+	return size;
+}
+
+bool ReliableChannel::recieve(const char* data, size_t size)
+{
+	if (size < HeaderSize)
+		return false;
+
+	// ---- Acks for what we sent ----
+	uint8_t flags = static_cast<uint8_t>(data[1]);
+	if (flags & FlagHasAck)
+	{
+		uint16_t ack = (static_cast<uint8_t>(data[2]) << 8) | static_cast<uint8_t>(data[3]);
+		uint32_t bits = readUint32(&data[4]);
+
+		acknowledge(ack);
+		for (uint16_t i = 0; i < 32; ++i)
+		{
+			if (bits & (1u << i))
+				acknowledge(static_cast<uint16_t>(ack - 1 - i));
+		}
+	}
+
+	// ---- Messages ----
+	uint8_t count = static_cast<uint8_t>(data[8]);
+	size_t offset = HeaderSize;
+	for (uint8_t i = 0; i < count; ++i)
+	{
+		if (offset + 3 > size)
+			return false;
+		uint16_t seq = (static_cast<uint8_t>(data[offset]) << 8) | static_cast<uint8_t>(data[offset + 1]);
+		uint8_t length = static_cast<uint8_t>(data[offset + 2]);
+		offset += 3;
+		if (offset + length > size)
+			return false;
+
+		// Every copy is acked, even one we already have, since the sender evidently lost our ack
+		recordRecieved(seq);
+
+		int16_t ahead = sequenceDelta(m_nextDeliver, seq);
+		if (ahead < 0)
+		{
+			m_stats.duplicates++;
+		}
+		else if (ahead < WindowSize)
+		{
+			Incoming& slot = m_incoming[seq % WindowSize];
+			if (!slot.valid || slot.seq != seq)
+			{
+				slot.seq = seq;
+				slot.payload.assign(&data[offset], &data[offset] + length);
+				slot.valid = true;
+			}
+		}
+		// else: beyond the window, which a well-behaved sender never does; drop it
+
+		offset += length;
+	}
+
+	// Hand out everything that is now contiguous
+	while (true)
+	{
+		Incoming& slot = m_incoming[m_nextDeliver % WindowSize];
+		if (!slot.valid || slot.seq != m_nextDeliver)
+			break;
+		m_delivered.push_back(std::move(slot.payload));
+		slot.valid = false;
+		m_nextDeliver++;
+		m_stats.delivered++;
+	}
+	return true;
+}
+
+bool ReliableChannel::popDelivered(std::vector<uint8_t>& payload)
+{
+	if (m_delivered.empty())
+		return false;
+	payload = std::move(m_delivered.front());
+	m_delivered.pop_front();
+	return true;
+}
+
+size_t ReliableChannel::getUnackedCount() const
+{
+	size_t count = 0;
+	for (const Outgoing& outgoing : m_outgoing)
+	{
+		if (outgoing.valid)
+			count++;
+	}
+	return count;
+}
+
+void ReliableChannel::acknowledge(uint16_t seq)
+{
+	Outgoing& slot = m_outgoing[seq % WindowSize];
+	if (slot.valid && slot.seq == seq && slot.sent)
+		slot.valid = false;
+}
+
+void ReliableChannel::recordRecieved(uint16_t seq)
+{
+	m_ackOwed = true;
+
+	if (!m_hasRemote)
+	{
+		m_remoteNewest = seq;
+		m_remoteBits = 0;
+		m_hasRemote = true;
+		return;
+	}
+
+	int16_t delta = sequenceDelta(m_remoteNewest, seq);
+	if (delta > 0)
+	{
+		// New newest: the old one becomes bit (delta - 1)
+		if (delta > 32)
+			m_remoteBits = 0;
+		else
+		{
+			m_remoteBits = delta == 32 ? 0 : m_remoteBits << delta;
+			m_remoteBits |= 1u << (delta - 1);
+		}
+		m_remoteNewest = seq;
+	}
+	else if (delta < 0 && delta >= -32)
+	{
+		m_remoteBits |= 1u << (-delta - 1);
+	}
+}
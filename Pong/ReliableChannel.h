@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Delivery counters for one channel
+struct ReliableChannelStats {
+	uint64_t messagesSent = 0;		// first transmissions
+	uint64_t retransmits = 0;
+	uint64_t delivered = 0;			// handed to the application, in order
+	uint64_t duplicates = 0;		// recieved again after delivery (our ack was lost)
+	uint64_t packetsSent = 0;		// RELIABLE datagrams, including ack-only ones
+};
+
+/// <summary>
+/// @brief Reliable, ordered delivery of small control messages over UDP.
+///
+/// Each message gets a 16-bit reliable sequence number and stays queued until the other end
+///  acknowledges it. Messages and acks travel together in RELIABLE datagrams:
+///		type (1) | flags (1) | ack (2) | ack bits (4) | count (1) | count x [ seq (2) | length (1) | payload ]
+/// ack is the newest sequence recieved and bit i of ack bits covers ack - 1 - i, so one
+///  datagram acknowledges the last 33 messages and a lost ack is repaired by the next one.
+/// Unacknowledged messages are resent every retransmit timeout; the receiver buffers anything
+///  that arrives early and hands messages out strictly in order.
+/// Snapshots and inputs don't go through here, so they pay nothing for it; a datagram is only
+///  built when a message is due or an ack is owed.
+/// Acks get a datagram of their own rather than a trailer on GUEST_INPUT or STATE_UPDATE. Only
+///  the host sends messages (a SCORE_EVENT per point, at most 9 a match), so the guest owes an
+///  ack about once a point against 3,600 inputs a minute. One 9-byte datagram each time costs
+///  about what a trailer would. A trailer wouldn't fit cleanly either. GUEST_INPUT's one
+///  optional tail already holds ackSeq/viewTick, and STATE_UPDATE is bit-packed by SnapshotCodec,
+///  so either would need a second, size-detected tail on every packet type the channel rides on.
+/// </summary>
+class ReliableChannel
+{
+public:
+	static const uint16_t WindowSize = 32;		// most messages in flight at once
+	static const size_t MaxPayload = 32;
+	static const size_t HeaderSize = 9;
+	static const uint32_t DefaultRetransmitMs = 100;
+
+	ReliableChannel();
+
+	/// <summary>
+	/// @brief Queues a message. Returns false if it is too big or the window is full.
+	/// </summary>
+	bool send(const uint8_t* payload, size_t size);
+
+	/// <summary>
+	/// @brief Writes a RELIABLE datagram carrying new and timed-out messages plus our acks.
+	/// Returns its size, or 0 if there is nothing to send right now.
+	/// </summary>
+	size_t buildPacket(uint32_t nowMs, uint32_t retransmitMs, uint8_t* out, size_t capacity);
+
+	/// <summary>
+	/// @brief Processes a recieved RELIABLE datagram: frees acknowledged messages and buffers new ones.
+	/// Returns false if it was malformed.
+	/// </summary>
+	bool recieve(const char* data, size_t size);
+
+	/// <summary>
+	/// @brief Pops the next in-order message. Returns false if none is ready.
+	/// </summary>
+	bool popDelivered(std::vector<uint8_t>& payload);
+
+	// Messages sent but not yet acknowledged
+	size_t getUnackedCount() const;
+
+	const ReliableChannelStats& getStats() const { return m_stats; }
+
+	void reset();
+
+private:
+	struct Outgoing {
+		uint16_t seq = 0;
+		uint8_t payload[MaxPayload];
+		uint8_t size = 0;
+		uint32_t lastSentMs = 0;
+		bool sent = false;
+		bool valid = false;
+	};
+
+	struct Incoming {
+		uint16_t seq = 0;
+		std::vector<uint8_t> payload;
+		bool valid = false;
+	};
+
+	void acknowledge(uint16_t seq);
+	void recordRecieved(uint16_t seq);
+
+	// Sending side
+	Outgoing m_outgoing[WindowSize];
+	uint16_t m_nextSeq{ 0 };
+
+	// Receiving side
+	Incoming m_incoming[WindowSize];
+	uint16_t m_nextDeliver{ 0 };		// next sequence to hand out
+	std::deque<std::vector<uint8_t>> m_delivered;
+
+	// Ack state we send back
+	uint16_t m_remoteNewest{ 0 };
+	uint32_t m_remoteBits{ 0 };
+	bool m_hasRemote{ false };
+	bool m_ackOwed{ false };
+
+	ReliableChannelStats m_stats;
+};
@@ -0,0 +1,192 @@
+#include "SnapshotCodec.h"
+
+namespace
+{
+	const int SeqBits = 16;
+	const int TickBits = 16;
+	const int BaselineOffsetBits = 5;	// offsets 1..31, always < SnapshotHistorySize
+	const int MaskBits = 8;
+
+	// Quantized form of every field, used both for writing and for change detection
+	struct QuantizedSnapshot
+	{
+		uint32_t p1Y, p2Y, ballX, ballY, ballVelX, ballVelY, p1Score, p2Score;
+	};
+
+	QuantizedSnapshot toQuantized(const NetLogicStates& state, const SnapshotQuantization& q)
+	{
+		uint32_t maxScore = (1u << q.scoreBits) - 1;
+
+		QuantizedSnapshot out;
+		out.p1Y = q.paddleY.quantize(state.p1Y);
+		out.p2Y = q.paddleY.quantize(state.p2Y);
+		out.ballX = q.ballX.quantize(state.ballX);
+		out.ballY = q.ballY.quantize(state.ballY);
+		out.ballVelX = q.ballVel.quantize(state.ballVelX);
+		out.ballVelY = q.ballVel.quantize(state.ballVelY);
+		out.p1Score = state.p1Score < maxScore ? state.p1Score : maxScore;
+		out.p2Score = state.p2Score < maxScore ? state.p2Score : maxScore;
+		return out;
+	}
+}
+
+void SnapshotHistory::store(const NetLogicStates& state)
+{
+	int index = state.seqNum % SnapshotHistorySize;
+	m_states[index] = state;
+	m_valid[index] = true;
+}
+
+const NetLogicStates* SnapshotHistory::find(uint16_t seq) const
+{
+	int index = seq % SnapshotHistorySize;
+	if (!m_valid[index] || m_states[index].seqNum != seq)
+		return nullptr;
+	return &m_states[index];
+}
+
+void SnapshotHistory::clear()
+{
+	for (int i = 0; i < SnapshotHistorySize; ++i)
+		m_valid[i] = false;
+}
+
+void SnapshotCodec::quantize(NetLogicStates& state, const SnapshotQuantization& quantization)
+{
+	QuantizedSnapshot q = toQuantized(state, quantization);
+	state.p1Y = quantization.paddleY.dequantize(q.p1Y);
+	state.p2Y = quantization.paddleY.dequantize(q.p2Y);
+	state.ballX = quantization.ballX.dequantize(q.ballX);
+	state.ballY = quantization.ballY.dequantize(q.ballY);
+	state.ballVelX = quantization.ballVel.dequantize(q.ballVelX);
+	state.ballVelY = quantization.ballVel.dequantize(q.ballVelY);
+	state.p1Score = q.p1Score;
+	state.p2Score = q.p2Score;
+}
+
+size_t SnapshotCodec::encode(const NetLogicStates& state, const NetLogicStates* baseline,
+	const SnapshotQuantization& quantization, uint8_t* out, size_t capacity)
+{
+	BitWriter writer(out, capacity);
+	QuantizedSnapshot current = toQuantized(state, quantization);
+
+	int paddleBits = quantization.paddleY.getBits();
+	int ballXBits = quantization.ballX.getBits();
+	int ballYBits = quantization.ballY.getBits();
+	int velBits = quantization.ballVel.getBits();
+	int scoreBits = quantization.scoreBits;
+
+	writer.write(baseline ? MessageTypes::STATE_DELTA : MessageTypes::STATE_UPDATE, 8);
+	writer.write(state.seqNum, SeqBits);
+	writer.write(state.tick, TickBits);
+	writer.write(state.inputAckTick, TickBits);
+
+	if (!baseline)
+	{
+		writer.write(current.p1Y, paddleBits);
+		writer.write(current.p2Y, paddleBits);
+		writer.write(current.ballX, ballXBits);
+		writer.write(current.ballY, ballYBits);
+		writer.write(current.ballVelX, velBits);
+		writer.write(current.ballVelY, velBits);
+		writer.write(current.p1Score, scoreBits);
+		writer.write(current.p2Score, scoreBits);
+	}
+	else
+	{
+		QuantizedSnapshot base = toQuantized(*baseline, quantization);
+
+		uint8_t mask = 0;
+		if (current.p1Y != base.p1Y) mask |= FIELD_P1_Y;
+		if (current.p2Y != base.p2Y) mask |= FIELD_P2_Y;
+		if (current.ballX != base.ballX) mask |= FIELD_BALL_X;
+		if (current.ballY != base.ballY) mask |= FIELD_BALL_Y;
+		if (current.ballVelX != base.ballVelX) mask |= FIELD_BALL_VEL_X;
+		if (current.ballVelY != base.ballVelY) mask |= FIELD_BALL_VEL_Y;
+		if (current.p1Score != base.p1Score) mask |= FIELD_P1_SCORE;
+		if (current.p2Score != base.p2Score) mask |= FIELD_P2_SCORE;
+
+		writer.write(static_cast<uint16_t>(state.seqNum - baseline->seqNum), BaselineOffsetBits);
+		writer.write(mask, MaskBits);
+
+		if (mask & FIELD_P1_Y) writer.write(current.p1Y, paddleBits);
+		if (mask & FIELD_P2_Y) writer.write(current.p2Y, paddleBits);
+		if (mask & FIELD_BALL_X) writer.write(current.ballX, ballXBits);
+		if (mask & FIELD_BALL_Y) writer.write(current.ballY, ballYBits);
+		if (mask & FIELD_BALL_VEL_X) writer.write(current.ballVelX, velBits);
+		if (mask & FIELD_BALL_VEL_Y) writer.write(current.ballVelY, velBits);
+		if (mask & FIELD_P1_SCORE) writer.write(current.p1Score, scoreBits);
+		if (mask & FIELD_P2_SCORE) writer.write(current.p2Score, scoreBits);
+	}
+
+	if (writer.hasOverflowed())
+		return 0;
+	return writer.getBytesWritten();
+}
+
+bool SnapshotCodec::decode(const uint8_t* data, size_t size, const SnapshotHistory& history,
+	const SnapshotQuantization& quantization, NetLogicStates& out)
+{
+	BitReader reader(data, size);
+
+	int paddleBits = quantization.paddleY.getBits();
+	int ballXBits = quantization.ballX.getBits();
+	int ballYBits = quantization.ballY.getBits();
+	int velBits = quantization.ballVel.getBits();
+	int scoreBits = quantization.scoreBits;
+
+	uint8_t msgType = static_cast<uint8_t>(reader.read(8));
+	uint16_t seq = static_cast<uint16_t>(reader.read(SeqBits));
+	uint16_t tick = static_cast<uint16_t>(reader.read(TickBits));
+	uint16_t inputAckTick = static_cast<uint16_t>(reader.read(TickBits));
+
+	NetLogicStates decoded;
+
+	if (msgType == MessageTypes::STATE_UPDATE)
+	{
+		decoded.p1Y = quantization.paddleY.dequantize(reader.read(paddleBits));
+		decoded.p2Y = quantization.paddleY.dequantize(reader.read(paddleBits));
+		decoded.ballX = quantization.ballX.dequantize(reader.read(ballXBits));
+		decoded.ballY = quantization.ballY.dequantize(reader.read(ballYBits));
+		decoded.ballVelX = quantization.ballVel.dequantize(reader.read(velBits));
+		decoded.ballVelY = quantization.ballVel.dequantize(reader.read(velBits));
+		decoded.p1Score = reader.read(scoreBits);
+		decoded.p2Score = reader.read(scoreBits);
+	}
+	else if (msgType == MessageTypes::STATE_DELTA)
+	{
+		uint16_t baseSeq = static_cast<uint16_t>(seq - reader.read(BaselineOffsetBits));
+		uint8_t mask = static_cast<uint8_t>(reader.read(MaskBits));
+		if (reader.hasOverflowed())
+			return false;
+
+		// The baseline must still be in our history, otherwise this delta can't be rebuilt
+		const NetLogicStates* baseline = history.find(baseSeq);
+		if (!baseline)
+			return false;
+		decoded = *baseline;
+
+		if (mask & FIELD_P1_Y) decoded.p1Y = quantization.paddleY.dequantize(reader.read(paddleBits));
+		if (mask & FIELD_P2_Y) decoded.p2Y = quantization.paddleY.dequantize(reader.read(paddleBits));
+		if (mask & FIELD_BALL_X) decoded.ballX = quantization.ballX.dequantize(reader.read(ballXBits));
+		if (mask & FIELD_BALL_Y) decoded.ballY = quantization.ballY.dequantize(reader.read(ballYBits));
+		if (mask & FIELD_BALL_VEL_X) decoded.ballVelX = quantization.ballVel.dequantize(reader.read(velBits));
+		if (mask & FIELD_BALL_VEL_Y) decoded.ballVelY = quantization.ballVel.dequantize(reader.read(velBits));
+		if (mask & FIELD_P1_SCORE) decoded.p1Score = reader.read(scoreBits);
+		if (mask & FIELD_P2_SCORE) decoded.p2Score = reader.read(scoreBits);
+	}
+	else
+	{
+		return false;
+	}
+
+	if (reader.hasOverflowed())
+		return false;
+
+	decoded.messageType = msgType;
+	decoded.seqNum = seq;
+	decoded.tick = tick;
+	decoded.inputAckTick = inputAckTick;
+	out = decoded;
+	return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "BitStream.h"
+#include "NetProtocol.h"
+#include "PongSim.h"
+
+/// <summary>
+/// @brief Fixed-point precision of every snapshot field on the wire.
+/// Host and guest must use the same settings.
+/// The defaults give 1/8 px positions and 1/4 px/s velocities inside the 1440x900 arena.
+/// </summary>
+struct SnapshotQuantization
+{
+	QuantizedRange paddleY{ 0.f, (float)ScreenSize::s_height - PongSim::PaddleHeight, 0.125f };
+	QuantizedRange ballX{ -128.f, (float)ScreenSize::s_width + 128.f, 0.125f };
+	QuantizedRange ballY{ 0.f, (float)ScreenSize::s_height - PongSim::BallRadius * 2.f, 0.125f };
+	QuantizedRange ballVel{ -1024.f, 1024.f, 0.25f };
+	int scoreBits = 5;
+};
+
+/// <summary>
+/// @brief The last SnapshotHistorySize snapshots, looked up by sequence number.
+/// Used for delta baselines on both ends.
+/// </summary>
+class SnapshotHistory
+{
+public:
+	void store(const NetLogicStates& state);
+
+	// nullptr if that sequence number was never stored or has been overwritten
+	const NetLogicStates* find(uint16_t seq) const;
+
+	void clear();
+
+private:
+	NetLogicStates m_states[SnapshotHistorySize];
+	bool m_valid[SnapshotHistorySize] = {};
+};
+
+/// <summary>
+/// @brief Bit-packed STATE_UPDATE / STATE_DELTA encoding.
+///
+/// Header: type (8) | seq (16) | tick (16) | input ack tick (16)
+/// Full:  header | p1Y | p2Y | ballX | ballY | velX | velY | p1Score | p2Score
+/// Delta: header | baseline offset (5) | changed mask (8) | changed fields in mask-bit order
+/// Field widths come from SnapshotQuantization (19 bytes full, 12 bytes for a typical rally delta).
+/// </summary>
+namespace SnapshotCodec
+{
+	/// <summary>
+	/// @brief Rounds every field onto the wire grid in place.
+	/// The sender stores the rounded state as its baseline so both ends hold identical values.
+	/// </summary>
+	void quantize(NetLogicStates& state, const SnapshotQuantization& quantization);
+
+	/// <summary>
+	/// @brief Encodes a full snapshot (no baseline) or a delta against baseline.
+	/// Returns the packet size in bytes, 0 if it didn't fit.
+	/// </summary>
+	size_t encode(const NetLogicStates& state, const NetLogicStates* baseline,
+		const SnapshotQuantization& quantization, uint8_t* out, size_t capacity);
+
+	/// <summary>
+	/// @brief Decodes a STATE_UPDATE or STATE_DELTA, looking delta baselines up in history.
+	/// Returns false if the packet is malformed or its baseline is no longer known.
+	/// </summary>
+	bool decode(const uint8_t* data, size_t size, const SnapshotHistory& history,
+		const SnapshotQuantization& quantization, NetLogicStates& out);
+}
@@ -0,0 +1,138 @@
+#include "SnapshotScheduler.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+	bool parseRate(const std::string& text, float& out)
+	{
+		char* end = nullptr;
+		out = std::strtof(text.c_str(), &end);
+		return end != text.c_str() && *end == '\0' && out > 0.f;
+	}
+}
+
+bool SnapshotRateConfig::parse(const std::string& spec, SnapshotRateConfig& out)
+{
+	SnapshotRateConfig config;
+	const std::string adaptive = "adaptive";
+
+	if (spec.compare(0, adaptive.size(), adaptive) != 0)
+	{
+		if (!parseRate(spec, config.rateHz))
+			return false;
+		out = config;
+		return true;
+	}
+
+	config.adaptive = true;
+	std::string range = spec.substr(adaptive.size());
+	if (!range.empty())
+	{
+		size_t dash = range.find('-');
+		if (range[0] != ':' || dash == std::string::npos ||
+			!parseRate(range.substr(1, dash - 1), config.minRateHz) ||
+			!parseRate(range.substr(dash + 1), config.maxRateHz) ||
+			config.minRateHz > config.maxRateHz)
+			return false;
+	}
+	out = config;
+	return true;
+}
+
+bool SnapshotRateConfig::fromEnvironment(SnapshotRateConfig& out)
+{
+	const char* spec = std::getenv("PONG_SNAPSHOT_RATE");
+	if (spec == nullptr || *spec == '\0')
+		return false;
+	return parse(spec, out);
+}
+
+std::string SnapshotRateConfig::describe() const
+{
+	std::ostringstream text;
+	if (adaptive)
+		text << "adaptive " << minRateHz << "-" << maxRateHz << " Hz";
+	else
+		text << rateHz << " Hz";
+	return text.str();
+}
+
+void SnapshotScheduler::configure(const SnapshotRateConfig& config, float tickRateHz)
+{
+	m_config = config;
+	m_tickRateHz = tickRateHz > 0.f ? tickRateHz : 60.f;
+	m_credit = 1.f;
+	m_cleanWindows = 0;
+	m_hasRtt = false;
+	m_decreases = 0;
+	m_increases = 0;
+	setRate(config.adaptive ? config.maxRateHz : config.rateHz);
+}
+
+void SnapshotScheduler::setRate(float rateHz)
+{
+	if (m_config.adaptive)
+	{
+		if (rateHz < m_config.minRateHz)
+			rateHz = m_config.minRateHz;
+		if (rateHz > m_config.maxRateHz)
+			rateHz = m_config.maxRateHz;
+	}
+	if (rateHz > m_tickRateHz)
+		rateHz = m_tickRateHz;
+	m_rateHz = rateHz;
+	m_perTick = rateHz / m_tickRateHz;
+}
+
+bool SnapshotScheduler::onTick()
+{
+	m_credit += m_perTick;
+	if (m_credit < 1.f)
+		return false;
+
+	m_credit -= 1.f;
+	return true;
+}
+
+void SnapshotScheduler::onWindow(const NetStatsWindow& window)
+{
+	if (!m_config.adaptive)
+		return;
+
+	float loss = window.getLossPercent();
+	float rttRise = 0.f;
+	if (window.hasRtt)
+	{
+		if (!m_hasRtt || window.rttMs < m_lowestRttMs)
+			m_lowestRttMs = window.rttMs;
+		m_hasRtt = true;
+		rttRise = window.rttMs - m_lowestRttMs;
+	}
+
+	// Back off at once on a bad window; creep back up only after a run of clean ones
+	if (loss >= m_config.lossBackoffPercent || rttRise >= m_config.rttRiseMs)
+	{
+		m_cleanWindows = 0;
+		float before = m_rateHz;
+		setRate(m_rateHz * m_config.backoffFactor);
+		if (m_rateHz < before)
+			m_decreases++;
+		return;
+	}
+
+	bool clean = loss < m_config.lossBackoffPercent / 2.f && rttRise < m_config.rttRiseMs / 2.f;
+	if (!clean)
+	{
+		m_cleanWindows = 0;
+		return;
+	}
+
+	if (++m_cleanWindows < m_config.cleanWindowsToIncrease)
+		return;
+	m_cleanWindows = 0;
+	float before = m_rateHz;
+	setRate(m_rateHz + m_config.increaseHz);
+	if (m_rateHz > before)
+		m_increases++;
+}
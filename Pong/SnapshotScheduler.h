@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "NetStats.h"
+
+/// <summary>
+/// @brief How often a host sends snapshots, independent of its sim tick rate.
+/// Parsed from "30" (fixed 30 Hz), "adaptive" (default range) or "adaptive:20-60".
+///
+/// In adaptive mode the rate starts at maxRateHz and is judged once per NetStats window:
+///  a window with lossBackoffPercent loss, or an RTT rttRiseMs above the lowest seen, cuts
+///  it by backoffFactor; cleanWindowsToIncrease clean windows in a row add increaseHz back.
+/// </summary>
+struct SnapshotRateConfig {
+	float rateHz = 60.f;		// fixed rate (ignored in adaptive mode)
+	bool adaptive = false;
+	float minRateHz = 20.f;
+	float maxRateHz = 60.f;
+
+	float lossBackoffPercent = 5.f;
+	float rttRiseMs = 60.f;
+	float backoffFactor = 0.7f;
+	float increaseHz = 5.f;
+	int cleanWindowsToIncrease = 2;
+
+	/// <summary>
+	/// @brief Parses a rate spec. Returns false on anything else or a rate that isn't positive.
+	/// </summary>
+	static bool parse(const std::string& spec, SnapshotRateConfig& out);
+
+	/// <summary>
+	/// @brief Reads the PONG_SNAPSHOT_RATE environment variable. False if it is unset or invalid.
+	/// </summary>
+	static bool fromEnvironment(SnapshotRateConfig& out);
+
+	std::string describe() const;
+};
+
+/// <summary>
+/// @brief Decides on which sim ticks one guest gets a snapshot.
+///
+/// Every tick adds rate / tickRate of a snapshot to a running credit and a snapshot goes out
+///  each time it reaches one, so 20 Hz on a 60 Hz sim sends every third tick and 45 Hz sends
+///  three ticks in four. Counting ticks rather than wall time keeps the spacing steady however
+///  late the loop runs. The rate never goes above the tick rate; every tick is the most there is.
+/// Example usage:
+///		scheduler.configure(config, PongSim::TickRate);
+///		if (scheduler.onTick()) { ... send a snapshot ... }		// once per sim tick
+///		if (stats.update(nowMs)) scheduler.onWindow(stats.getLastWindow());
+/// </summary>
+class SnapshotScheduler
+{
+public:
+	void configure(const SnapshotRateConfig& config, float tickRateHz);
+
+	/// <summary>
+	/// @brief Advances one sim tick. True if a snapshot is due on it.
+	/// </summary>
+	bool onTick();
+
+	/// <summary>
+	/// @brief Adaptive mode: adjusts the rate from a closed window of the peer's NetStats.
+	/// </summary>
+	void onWindow(const NetStatsWindow& window);
+
+	float getRateHz() const { return m_rateHz; }
+	uint32_t getDecreases() const { return m_decreases; }
+	uint32_t getIncreases() const { return m_increases; }
+
+private:
+	void setRate(float rateHz);
+
+	SnapshotRateConfig m_config;
+	float m_tickRateHz{ 60.f };
+	float m_rateHz{ 60.f };
+	float m_perTick{ 1.f };		// rate / tick rate
+	float m_credit{ 1.f };		// starts full so the first tick sends
+
+	int m_cleanWindows{ 0 };
+	float m_lowestRttMs{ 0.f };
+	bool m_hasRtt{ false };
+	uint32_t m_decreases{ 0 };
+	uint32_t m_increases{ 0 };
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// @brief Bounded lock-free queue between exactly one producer thread and one consumer thread.
+///
+/// Storage is allocated once in the constructor (capacity rounded up to a power of two);
+///  push and pop only copy an element and move one atomic index. A full queue refuses the
+///  push instead of waiting, so neither side can stall the other.
+/// Example usage:
+///		SpscQueue<Datagram> queue(1024);
+///		queue.tryPush(datagram);			// producer thread only
+///		while (queue.tryPop(datagram)) {}	// consumer thread only
+/// </summary>
+template <typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+		m_items.resize(size);
+		m_mask = size - 1;
+	}
+
+	bool tryPush(const T& item)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) > m_mask)
+			return false; // full
+
+		m_items[head & m_mask] = item;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool tryPop(T& out)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_head.load(std::memory_order_acquire))
+			return false; // empty
+
+		out = m_items[tail & m_mask];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool isEmpty() const { return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire); }
+	size_t getCapacity() const { return m_mask + 1; }
+
+	// Only while neither thread is using the queue
+	void clear()
+	{
+		m_head.store(0, std::memory_order_relaxed);
+		m_tail.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	std::vector<T> m_items;
+	size_t m_mask{ 0 };
+	alignas(64) std::atomic<size_t> m_head{ 0 };	// next slot the producer writes
+	alignas(64) std::atomic<size_t> m_tail{ 0 };	// next slot the consumer reads
+};
@@ -0,0 +1,164 @@
+#include "BotGuest.h"
+#include "AsyncLogger.h"
+#include "PongSim.h"
+
+BotGuest::BotGuest(unsigned short discoveryPort, BotInputMode mode, uint32_t seed)
+	: m_discoveryPort(discoveryPort),
+	m_mode(mode),
+	m_rng(seed)
+{
+	m_net.setIoThread(false);
+}
+
+void BotGuest::update()
+{
+	if (!m_bound)
+	{
+		startDiscovery();
+		if (!m_bound)
+			return;
+	}
+
+	m_net.poll();
+
+	sf::IpAddress address(sf::IpAddress::Any);
+	unsigned short port = 0;
+	switch (m_phase)
+	{
+	case Phase::Discovering:
+		m_net.sendFindHostIfDue(m_discoveryPort);
+		if (m_net.recieveHostHere(address, port))
+		{
+			m_net.sendHello();
+			m_phase = Phase::Joining;
+		}
+		break;
+
+	case Phase::Joining:
+		if (m_net.recieveHelloAck())
+		{
+			m_phase = Phase::Playing;
+			m_hasLatest = false;
+			m_lastSnapshot = DatagramSocket::now();
+			m_playStart = m_lastSnapshot;
+			m_inputsSent = 0;
+			m_firstFullWindow = m_net.getStats().getWindowCount() + 1;
+			m_counters.joins++;
+			m_joinTimesMs.push_back(m_joinClock.getElapsedTime().asMicroseconds() / 1000.f);
+		}
+		else if (!m_net.retryHelloIfDue())
+		{
+			// That host never answered; try the next one heard from, or discover again
+			m_net.forgetHost(m_net.getHostAddress(), m_net.getHostPort());
+			m_net.restartDiscovery();
+			m_phase = Phase::Discovering;
+		}
+		break;
+
+	case Phase::Playing:
+		play();
+		break;
+	}
+}
+
+void BotGuest::startDiscovery()
+{
+	// A new socket per join: the host's old session, still lingering on game over, can't mix in
+	m_net.reset();
+	m_bound = m_net.bind(0);
+	m_phase = Phase::Discovering;
+	m_joinClock.restart();
+	m_tick = 0;
+	m_lastWindow = 0;
+}
+
+void BotGuest::play()
+{
+	NetLogicStates state;
+	sf::Time arrival;
+	while (m_net.recieveStateUpdate(state, arrival))
+	{
+		m_latest = state;
+		m_hasLatest = true;
+		m_lastSnapshot = arrival;
+	}
+
+	bool finished = false;
+	ScoreEvent event;
+	while (m_net.recieveScoreEvent(event))
+		finished = finished || event.gameOver;
+
+	// One input per host tick since the join, at the rate HELLO_ACK gave, however often update() runs.
+	// After a stall the backlog is skipped rather than sent in a burst
+	uint64_t due = static_cast<uint64_t>((DatagramSocket::now() - m_playStart).asSeconds() * m_net.getHostTickRate()) + 1;
+	if (due - m_inputsSent > MaxInputBurst)
+	{
+		m_tick = static_cast<uint16_t>(m_tick + (due - MaxInputBurst - m_inputsSent));
+		m_inputsSent = due - MaxInputBurst;
+	}
+	for (; m_inputsSent < due; ++m_inputsSent)
+		m_net.sendInput(m_tick++, chooseInput(), m_latest.tick);
+	m_net.pingHostIfDue();
+	m_net.flushReliable();
+	m_net.updateStats();
+	recordWindow();
+
+	if (finished)
+	{
+		m_counters.matchesFinished++;
+		startDiscovery();
+	}
+	else if ((DatagramSocket::now() - m_lastSnapshot).asMilliseconds() > static_cast<int32_t>(StallMs))
+	{
+		LOG_WARN_EVERY(1000, "BotGuest: No snapshot for %u ms, joining again", StallMs);
+		m_counters.stalls++;
+		startDiscovery();
+	}
+}
+
+int8_t BotGuest::chooseInput()
+{
+	if (m_mode == BotInputMode::Sweep)
+	{
+		if (m_sweepTicksLeft <= 0)
+		{
+			m_sweepInput = static_cast<int8_t>(std::uniform_int_distribution<int>(-1, 1)(m_rng));
+			int ticksPerSecond = static_cast<int>(m_net.getHostTickRate());
+			m_sweepTicksLeft = std::uniform_int_distribution<int>(ticksPerSecond / 5, ticksPerSecond)(m_rng);
+		}
+		m_sweepTicksLeft--;
+		return m_sweepInput;
+	}
+
+	// Track the ball with the right paddle, with the same dead zone as the house paddle
+	if (!m_hasLatest)
+		return 0;
+	const float deadZone = 10.f;
+	float paddleCentre = m_latest.p2Y + PongSim::PaddleHeight / 2.f;
+	float ballCentre = m_latest.ballY + PongSim::BallRadius;
+	if (ballCentre < paddleCentre - deadZone)
+		return -1;
+	if (ballCentre > paddleCentre + deadZone)
+		return 1;
+	return 0;
+}
+
+void BotGuest::recordWindow()
+{
+	const NetStats& stats = m_net.getStats();
+	uint64_t window = stats.getWindowCount();
+	if (window == m_lastWindow)
+		return;
+	m_lastWindow = window;
+	if (!m_recording || window <= m_firstFullWindow)
+		return;
+
+	const NetStatsWindow& last = stats.getLastWindow();
+	BotSample sample;
+	sample.snapshots = last.types[MessageTypes::STATE_UPDATE].packetsReceived + last.types[MessageTypes::STATE_DELTA].packetsReceived;
+	sample.lossPercent = last.getLossPercent();
+	sample.jitterMs = last.jitterMs;
+	sample.rttMs = last.rttMs;
+	sample.hasRtt = last.hasRtt;
+	m_samples.push_back(sample);
+}
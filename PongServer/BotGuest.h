@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <SFML/System.hpp>
+
+#include "GuestNetworkController.h"
+
+// How a bot moves its paddle
+enum class BotInputMode : uint8_t {
+	Track,	// follow the ball in the newest snapshot, like HeadlessHost's house paddle
+	Sweep	// scripted: hold up, down or still for a seeded 0.2 to 1 s at a time
+};
+
+// One closed one-second NetStats window of a bot's host connection, taken while it was playing
+struct BotSample {
+	uint32_t snapshots = 0;		// STATE_UPDATE + STATE_DELTA recieved
+	float lossPercent = 0.f;
+	float jitterMs = 0.f;
+	float rttMs = 0.f;
+	bool hasRtt = false;
+};
+
+struct BotCounters {
+	uint64_t joins = 0;				// HELLO_ACKs recieved
+	uint64_t matchesFinished = 0;	// game over announced by the host, after which the bot joins again
+	uint64_t stalls = 0;			// no snapshot for StallMs while playing; also rejoined
+};
+
+/// <summary>
+/// @brief Headless guest for load tests: discovery, handshake and paddle input with no window or player.
+///
+/// Goes through the same GuestNetworkController steps as Game::lookingForHost and the guest
+///  half of Game::update: FIND_HOST (or LOBBY_FIND when PONG_LOBBY is set) on the backoff schedule,
+///  HELLO with retries, then one GUEST_INPUT per host tick (at the rate in HELLO_ACK, so several per
+///  update() against a faster host) and a PING and reliable ack flush per update(). A finished or
+///  stalled match is left and a new one joined, so a long run keeps every bot in play.
+/// Sockets are read on the caller's thread (no I/O thread), so thousands of bots can share a few threads.
+/// Example usage (once per sim tick):
+///		BotGuest bot(54000, BotInputMode::Track, 1);
+///		bot.update();
+/// </summary>
+class BotGuest
+{
+public:
+	static const uint32_t StallMs = 3000;
+	static const uint64_t MaxInputBurst = 8;	// most GUEST_INPUTs one update() sends to catch up
+
+	BotGuest(unsigned short discoveryPort, BotInputMode mode, uint32_t seed);
+
+	/// <summary>
+	/// @brief One sim tick: polls the socket and takes the next step of discovery, the handshake or play.
+	/// </summary>
+	void update();
+
+	bool isPlaying() const { return m_phase == Phase::Playing; }
+	// Tick rate of the host it last joined (PongSim::TickRate before the first HELLO_ACK)
+	float getHostTickRate() const { return m_net.getHostTickRate(); }
+
+	/// <summary>
+	/// @brief Start or stop keeping a BotSample per second of play. Join times are always kept.
+	/// </summary>
+	void setRecording(bool recording) { m_recording = recording; }
+
+	const std::vector<BotSample>& getSamples() const { return m_samples; }
+	const std::vector<float>& getJoinTimesMs() const { return m_joinTimesMs; }
+	const BotCounters& getCounters() const { return m_counters; }
+
+private:
+	enum class Phase { Discovering, Joining, Playing };
+
+	void startDiscovery();
+	void play();
+	int8_t chooseInput();
+	void recordWindow();
+
+	GuestNetworkController m_net;
+	unsigned short m_discoveryPort;
+	Phase m_phase{ Phase::Discovering };
+	bool m_bound{ false };
+	sf::Clock m_joinClock;			// since the first FIND_HOST of this join
+
+	// Newest snapshot, which is also the host tick the bot "sees" for lag compensation
+	NetLogicStates m_latest;
+	bool m_hasLatest{ false };
+	sf::Time m_lastSnapshot{ sf::Time::Zero };
+	uint16_t m_tick{ 0 };
+	sf::Time m_playStart{ sf::Time::Zero };	// when HELLO_ACK came in; inputs are due by the host tick from here
+	uint64_t m_inputsSent{ 0 };
+
+	BotInputMode m_mode;
+	std::mt19937 m_rng;
+	int8_t m_sweepInput{ 0 };
+	int m_sweepTicksLeft{ 0 };
+
+	bool m_recording{ false };
+	uint64_t m_firstFullWindow{ 0 };	// the window the join landed in is partial; skip it
+	uint64_t m_lastWindow{ 0 };
+	std::vector<BotSample> m_samples;
+	std::vector<float> m_joinTimesMs;
+	BotCounters m_counters;
+};
@@ -0,0 +1,296 @@
+#include "ConnectBenchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <SFML/System.hpp>
+
+#include "AsyncLogger.h"
+#include "GuestNetworkController.h"
+#include "HostNetworkController.h"
+#include "InputRingBuffer.h"
+#include "NetConditioner.h"
+#include "ReliableChannel.h"
+
+namespace
+{
+	const unsigned short BenchPort = 54090;
+	const sf::Time TrialTimeout = sf::seconds(20.f);
+
+	struct DiscoverySchedule
+	{
+		const char* name;
+		uint32_t initialDelayMs;
+		uint32_t maxDelayMs;
+		bool beacons;
+	};
+
+	struct ConnectResult
+	{
+		float ms = -1.f;			// first FIND_HOST to HELLO_ACK, negative on timeout
+		float handshakeMs = -1.f;	// first HELLO to HELLO_ACK, negative if no HELLO was acked
+		bool sentHello = false;
+		bool exhaustedHello = false;	// MaxHelloAttempts went unanswered and the guest had to rediscover
+	};
+
+	ConnectResult connectOnce(HostNetworkController& host, const DiscoverySchedule& schedule, const NetConditionerConfig& netem)
+	{
+		ConnectResult result;
+		GuestNetworkController guest;
+		guest.setNetConditioner(netem);
+		if (!guest.bind(0))
+			return result;
+		if (schedule.beacons)
+			guest.listenForBeacons(BenchPort);
+		guest.setDiscoveryBackoff(schedule.initialDelayMs, schedule.maxDelayMs);
+
+		// Same steps as Game::lookingForHost
+		bool sentHello = false;
+		sf::Time firstHello = sf::Time::Zero;
+		sf::Clock clock;
+		while (clock.getElapsedTime() < TrialTimeout)
+		{
+			host.poll();
+			SessionId id;
+			while (host.acceptNewSession(id))
+				host.closeSession(id);
+
+			guest.poll();
+			if (!sentHello)
+			{
+				guest.sendFindHostIfDue(BenchPort);
+				sf::IpAddress address(sf::IpAddress::Any);
+				unsigned short port = 0;
+				if (guest.recieveHostHere(address, port))
+				{
+					guest.sendHello();
+					if (!result.sentHello)
+						firstHello = clock.getElapsedTime();
+					result.sentHello = true;
+					sentHello = true;
+				}
+			}
+			else if (guest.recieveHelloAck())
+			{
+				result.ms = clock.getElapsedTime().asMicroseconds() / 1000.f;
+				result.handshakeMs = (clock.getElapsedTime() - firstHello).asMicroseconds() / 1000.f;
+				return result;
+			}
+			else if (!guest.retryHelloIfDue())
+			{
+				result.exhaustedHello = true;
+				sentHello = false;
+				guest.forgetHost(guest.getHostAddress(), guest.getHostPort());
+				guest.restartDiscovery();
+			}
+			sf::sleep(sf::milliseconds(1));
+		}
+		return result;
+	}
+
+	float percentile(const std::vector<float>& sorted, float fraction)
+	{
+		size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5f);
+		return sorted[index];
+	}
+
+	// ---- ReliableChannel under loss and reordering ----
+	const uint32_t ReliableMessages = 2000;
+	const uint32_t ReliableDeadlineMs = 120000;
+
+	// Passes every datagram from one channel to the other through a NetConditioner, on a simulated clock
+	void carry(ReliableChannel& from, ReliableChannel& to, NetConditioner& link, uint32_t nowMs)
+	{
+		Datagram datagram;
+		datagram.size = from.buildPacket(nowMs, ReliableChannel::DefaultRetransmitMs,
+			reinterpret_cast<uint8_t*>(datagram.data), sizeof(datagram.data));
+		if (datagram.size > 0)
+			link.submit(datagram, sf::milliseconds(static_cast<int32_t>(nowMs)));
+
+		Datagram arrived[DatagramSocket::BatchSize];
+		size_t count;
+		while ((count = link.release(sf::milliseconds(static_cast<int32_t>(nowMs)), arrived, DatagramSocket::BatchSize)) > 0)
+		{
+			for (size_t i = 0; i < count; ++i)
+				to.recieve(arrived[i].data, arrived[i].size);
+		}
+	}
+
+	// Streams numbered messages one way over a 30% loss link that also reorders and delays, with the
+	//  acks coming back over another, and checks that every message comes out exactly once and in order
+	void checkReliableOrdering()
+	{
+		NetConditionerConfig netem;
+		netem.delayMs = 20.f;
+		netem.jitterMs = 5.f;
+		netem.lossPercent = 30.f;
+		netem.reorderPercent = 20.f;
+		NetConditioner forward(netem);
+		netem.seed = 2;
+		NetConditioner back(netem);
+
+		ReliableChannel sender;
+		ReliableChannel receiver;
+		uint32_t nextToSend = 0;
+		uint32_t nextExpected = 0;
+		size_t outOfOrder = 0;
+		uint32_t nowMs = 0;
+		std::vector<uint8_t> payload;
+		for (; nowMs < ReliableDeadlineMs && nextExpected < ReliableMessages; ++nowMs)
+		{
+			// A message every other millisecond, whenever the window has room
+			if (nextToSend < ReliableMessages && (nowMs & 1) == 0)
+			{
+				uint8_t message[4];
+				writeUint32(message, nextToSend);
+				if (sender.send(message, sizeof(message)))
+					nextToSend++;
+			}
+
+			carry(sender, receiver, forward, nowMs);
+			while (receiver.popDelivered(payload))
+			{
+				if (payload.size() != 4 || readUint32(reinterpret_cast<const char*>(payload.data())) != nextExpected)
+					outOfOrder++;
+				nextExpected++;
+			}
+			carry(receiver, sender, back, nowMs);
+		}
+
+		const ReliableChannelStats& stats = sender.getStats();
+		const NetConditionerStats& impaired = forward.getStats();
+		bool ok = nextExpected == ReliableMessages && outOfOrder == 0;
+		std::printf("Reliable channel, %u messages over 30%% loss, 20%% reordering, 20+-5 ms delay each way:\n", ReliableMessages);
+		std::printf("  %u delivered in %.1f s, %zu out of order, %llu retransmits, %llu duplicates, %llu of %llu datagrams lost and %llu reordered   %s\n",
+			nextExpected, nowMs / 1000.f, outOfOrder, static_cast<unsigned long long>(stats.retransmits),
+			static_cast<unsigned long long>(receiver.getStats().duplicates),
+			static_cast<unsigned long long>(impaired.dropped), static_cast<unsigned long long>(impaired.submitted),
+			static_cast<unsigned long long>(impaired.reordered), ok ? "ok" : "FAILED");
+	}
+
+	// ---- InputRingBuffer after the guest stops sending ----
+	const int WarmupInputs = 60;
+	const int StallTicks = 30;
+	const int ResumedInputs = 300;
+
+	// The host's side of one tick: the guest's GUEST_INPUT (with its repeats) if it sent one, then
+	//  one consume(). True if that step applied an input rather than repeating the last one
+	bool stepHost(InputRingBuffer& buffer, uint16_t* guestTick)
+	{
+		if (guestTick)
+		{
+			int8_t input = static_cast<int8_t>(*guestTick % 3) - 1;
+			buffer.insert(*guestTick, input, 0, false);
+			for (int ago = 1; ago <= GuestInputPacket::MaxPrevious; ++ago)
+			{
+				uint16_t previous = static_cast<uint16_t>(*guestTick - ago);
+				buffer.fill(previous, static_cast<int8_t>(previous % 3) - 1);
+			}
+			++*guestTick;
+		}
+		uint64_t missed = buffer.getStats().missed;
+		buffer.consume();
+		return buffer.getStats().missed == missed;
+	}
+
+	// The guest's loop stalls for StallTicks host ticks and then carries on from the tick it stopped
+	//  at, so it is now behind the host's cursor. Every input after that has to be applied, apart
+	//  from the late ones it takes the host to notice
+	void checkInputResume()
+	{
+		InputRingBuffer buffer;
+		uint16_t guestTick = 65530;	// wraps during the run
+		for (int i = 0; i < WarmupInputs; ++i)
+			stepHost(buffer, &guestTick);
+		for (int i = 0; i < StallTicks; ++i)
+			stepHost(buffer, nullptr);
+		int applied = 0;
+		for (int i = 0; i < ResumedInputs; ++i)
+			applied += stepHost(buffer, &guestTick) ? 1 : 0;
+
+		bool ok = applied + InputRingBuffer::MaxLateInserts - 1 >= ResumedInputs;
+		std::printf("Guest inputs after a %d-tick stall on the guest:\n", StallTicks);
+		std::printf("  %d of %d resumed inputs applied (up to %d late ones allowed)   %s\n",
+			applied, ResumedInputs, InputRingBuffer::MaxLateInserts - 1, ok ? "ok" : "FAILED");
+	}
+}
+
+void runConnectBenchmark(size_t trials)
+{
+	if (trials == 0)
+		trials = 1;
+	AsyncLogger::instance().setLevel(LogLevel::Warning);
+
+	HostNetworkController host;
+	host.setMaxSessions(1024);
+	if (!host.bind(BenchPort))
+	{
+		std::printf("Could not bind the benchmark host on port %u\n", BenchPort);
+		return;
+	}
+
+	const DiscoverySchedule schedules[] = {
+		{ "fixed 5 s", 5000, 5000, false },
+		{ "backoff", GuestNetworkController::FindHostInitialDelayMs, GuestNetworkController::FindHostMaxDelayMs, false },
+		{ "backoff+beacons", GuestNetworkController::FindHostInitialDelayMs, GuestNetworkController::FindHostMaxDelayMs, true }
+	};
+	const float losses[] = { 0.f, 20.f, 30.f };
+	const float BudgetLoss = 30.f;
+	const float HandshakeBudgetMs = static_cast<float>(GuestNetworkController::MaxHelloAttempts * GuestNetworkController::HelloRetryMs);
+	size_t handshakes = 0;
+	size_t budgetMisses = 0;
+	float slowestHandshake = 0.f;
+
+	std::printf("Time to connect over loopback, %zu trials each (ms):\n", trials);
+	for (float loss : losses)
+	{
+		for (const DiscoverySchedule& schedule : schedules)
+		{
+			host.setBeaconInterval(schedule.beacons ? HostBeaconIntervalMs : 0);
+
+			std::vector<float> times;
+			size_t failed = 0;
+			size_t exhausted = 0;
+			for (size_t trial = 0; trial < trials; ++trial)
+			{
+				NetConditionerConfig netem;
+				netem.lossPercent = loss;
+				netem.direction = ConditionerDirection::Both;
+				netem.seed = static_cast<uint32_t>(trial + 1);
+
+				ConnectResult result = connectOnce(host, schedule, netem);
+				if (result.ms < 0.f)
+					failed++;
+				else
+					times.push_back(result.ms);
+				if (result.exhaustedHello)
+					exhausted++;
+
+				// Once a host is found, the handshake must get through BudgetLoss on its HELLO retries alone
+				if (loss == BudgetLoss && result.sentHello)
+				{
+					handshakes++;
+					if (result.handshakeMs < 0.f || result.handshakeMs > HandshakeBudgetMs || result.exhaustedHello)
+						budgetMisses++;
+					if (result.handshakeMs > slowestHandshake)
+						slowestHandshake = result.handshakeMs;
+				}
+			}
+
+			std::printf("  loss %4.0f%%  %-16s", loss, schedule.name);
+			if (times.empty())
+			{
+				std::printf(" all %zu timed out\n", failed);
+				continue;
+			}
+			std::sort(times.begin(), times.end());
+			std::printf(" p50 %7.1f  p90 %7.1f  p99 %7.1f  max %7.1f  timeouts %zu  HELLO retries exhausted %zu\n",
+				percentile(times, 0.5f), percentile(times, 0.9f), percentile(times, 0.99f), times.back(), failed, exhausted);
+		}
+	}
+	std::printf("  handshake at %.0f%% loss: %zu of %zu HELLO_ACKs within the retry budget of %d HELLOs %u ms apart, slowest %.1f ms   %s\n",
+		BudgetLoss, handshakes - budgetMisses, handshakes, GuestNetworkController::MaxHelloAttempts,
+		GuestNetworkController::HelloRetryMs, slowestHandshake, budgetMisses == 0 ? "ok" : "FAILED");
+
+	checkReliableOrdering();
+	checkInputResume();
+}
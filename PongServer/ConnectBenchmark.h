@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+
+/// <summary>
+/// @brief Measures time-to-connect (first FIND_HOST to HELLO_ACK) over loopback and prints percentiles.
+///
+/// A host and a fresh guest per trial run in this process on BenchPort, so a host already
+///  running on the default port doesn't answer. Each discovery schedule (the old fixed 5 s
+///  rebroadcast, exponential backoff, backoff plus host beacons) is timed with no loss and
+///  with 20% and 30% loss added both ways on the guest by its NetConditioner.
+/// Three checks follow, each printing ok or FAILED: at 30% loss every HELLO must be acknowledged
+///  within the guest's retry budget (MaxHelloAttempts x HelloRetryMs); a ReliableChannel
+///  must deliver 2,000 messages exactly once and in order across a simulated link with 30% loss,
+///  reordering and jitter each way; and the host's InputRingBuffer must apply a guest's inputs
+///  again once it resumes after a stall that left it behind the host's tick cursor.
+/// Run with PongServer --bench-connect [TRIALS].
+/// </summary>
+void runConnectBenchmark(size_t trials);
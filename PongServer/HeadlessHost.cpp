@@ -0,0 +1,328 @@
+#include "HeadlessHost.h"
+#include <algorithm>
+#include "AsyncLogger.h"
+
+HeadlessHost::HeadlessHost(unsigned short port, double tickRate, size_t maxMatches)
+	: m_port(port),
+	m_tickRate(static_cast<float>(tickRate)),
+	m_timestep(tickRate),
+	m_timePerTick(m_timestep.getStepTime())
+{
+	m_hostNet.setMaxSessions(maxMatches);
+	m_hostNet.setSnapshotRate(m_hostNet.getSnapshotRate(), m_tickRate);
+	m_matches.reserve(maxMatches);
+}
+
+bool HeadlessHost::start()
+{
+	if (!m_hostNet.bind(m_port))
+		return false;
+
+	m_running = true;
+	LOG_INFO("HeadlessHost: Waiting for guests on port %u", m_port);
+	return true;
+}
+
+bool HeadlessHost::openStatsCsv(const std::string& path)
+{
+	m_statsCsv.open(path, std::ios::out | std::ios::trunc);
+	if (!m_statsCsv.is_open())
+	{
+		LOG_ERROR("HeadlessHost: Could not open %s for network statistics", path.c_str());
+		return false;
+	}
+	NetStats::writeCsvHeader(m_statsCsv);
+	LOG_INFO("HeadlessHost: Writing network statistics to %s", path.c_str());
+	return true;
+}
+
+void HeadlessHost::run()
+{
+	// CPU time is counted from here, so whatever this thread did before run() isn't charged to the host
+	m_cpuAtStart = DatagramSocket::threadCpuTime();
+	m_timestep.restart();
+	uint64_t droppedSteps = 0;
+
+	while (m_running)
+	{
+		for (int steps = m_timestep.advance(); steps > 0; --steps)
+			measuredTick(m_timestep.getDt());
+
+		if (m_timestep.getDroppedSteps() != droppedSteps)
+		{
+			LOG_WARN("HeadlessHost: Fell more than %d ticks behind; skipped %llu ticks so far",
+				FixedTimestep::MaxStepsPerAdvance, static_cast<unsigned long long>(m_timestep.getDroppedSteps()));
+			droppedSteps = m_timestep.getDroppedSteps();
+		}
+
+		// Nothing to render, so give the CPU back until the next tick is due
+		sf::sleep(m_timestep.getTimeToNextStep());
+	}
+
+	// Closes the socket, and takes this host off the lobby's list if it registered with one
+	m_hostNet.reset();
+}
+
+void HeadlessHost::measuredTick(float dt)
+{
+	sf::Time start = DatagramSocket::now();
+	tick(dt);
+	sf::Time busy = DatagramSocket::now() - start;
+
+	m_busyMicros.fetch_add(busy.asMicroseconds(), std::memory_order_relaxed);
+	if (busy > m_timePerTick)
+		m_overruns.fetch_add(1, std::memory_order_relaxed);
+	m_tickCpuMicros.store((DatagramSocket::threadCpuTime() - m_cpuAtStart).asMicroseconds(), std::memory_order_relaxed);
+	m_matchCount.store(m_matches.size(), std::memory_order_relaxed);
+	m_ticks.fetch_add(1, std::memory_order_relaxed);
+}
+
+HostTickLoad HeadlessHost::getTickLoad() const
+{
+	HostTickLoad load;
+	load.ticks = m_ticks.load(std::memory_order_relaxed);
+	load.overruns = m_overruns.load(std::memory_order_relaxed);
+	load.busyMicros = m_busyMicros.load(std::memory_order_relaxed);
+	load.tickCpuMicros = m_tickCpuMicros.load(std::memory_order_relaxed);
+	load.ioCpuMicros = m_hostNet.getIoThreadCpuTime().asMicroseconds();
+	load.matches = m_matchCount.load(std::memory_order_relaxed);
+	return load;
+}
+
+void HeadlessHost::tick(float dt)
+{
+	// One drain serves discovery, handshakes and the inputs of every match
+	m_hostNet.poll();
+
+	SessionId newSession;
+	while (m_hostNet.acceptNewSession(newSession))
+	{
+		Match& match = m_matches[newSession];
+		PongSim::reset(match.sim);
+		match.lagCompensator.setMaxRewindTime(LagCompensator::DefaultMaxRewindMs, m_tickRate);
+		m_matchOrder.push_back(newSession);
+		LOG_INFO("HeadlessHost: Match started (%zu running)", m_matches.size());
+	}
+
+	// A guest that went silent forfeits its match
+	SessionId expiredSession;
+	while (m_hostNet.acceptExpiredSession(expiredSession))
+	{
+		if (m_matches.erase(expiredSession) != 0)
+		{
+			removeFromMatchOrder(expiredSession);
+			LOG_INFO("HeadlessHost: Match abandoned by its guest (%zu running)", m_matches.size());
+		}
+	}
+
+	for (auto it = m_matches.begin(); it != m_matches.end();)
+	{
+		if (tickMatch(it->first, it->second, dt))
+		{
+			++it;
+			continue;
+		}
+
+		LOG_INFO("HeadlessHost: Match finished %d - %d", it->second.sim.leftScore, it->second.sim.rightScore);
+		m_hostNet.closeSession(it->first);
+		removeFromMatchOrder(it->first);
+		it = m_matches.erase(it);
+	}
+
+	sendSpectatorState();
+
+	// Every match's STATE_UPDATE, and the spectators' copies, leave in one batch
+	m_hostNet.flush();
+
+	if (m_statsCsv.is_open())
+		writeStatsCsv();
+
+	m_ticksSinceReport++;
+	if (m_ticksSinceReport * m_timePerTick >= m_reportInterval)
+		reportIoCounters();
+}
+
+void HeadlessHost::reportIoCounters()
+{
+	DatagramIoCounters io = m_hostNet.getIoCounters();
+	float seconds = (m_ticksSinceReport * m_timePerTick).asSeconds();
+
+	if (!m_matches.empty())
+	{
+		LOG_INFO("HeadlessHost: %zu matches, %d pkt/s in, %d pkt/s out, %.2f recv calls/tick, %.2f send calls/tick, %llu queue drops",
+			m_matches.size(),
+			static_cast<int>(io.packetsReceived / seconds), static_cast<int>(io.packetsSent / seconds),
+			static_cast<float>(io.receiveCalls) / m_ticksSinceReport, static_cast<float>(io.sendCalls) / m_ticksSinceReport,
+			static_cast<unsigned long long>(io.queueDrops));
+
+		// The current tick is still running, so its time lands in the next report
+		HostTickLoad load = getTickLoad();
+		uint64_t ticks = load.ticks - m_lastReportLoad.ticks;
+		if (ticks > 0)
+		{
+			LOG_INFO("HeadlessHost: tick busy %.1f%% of budget, %llu overruns, CPU %.1f%% tick thread + %.1f%% I/O thread",
+				100.0 * (load.busyMicros - m_lastReportLoad.busyMicros) / (ticks * m_timePerTick.asMicroseconds()),
+				static_cast<unsigned long long>(load.overruns - m_lastReportLoad.overruns),
+				100.0 * (load.tickCpuMicros - m_lastReportLoad.tickCpuMicros) / (seconds * 1e6),
+				100.0 * (load.ioCpuMicros - m_lastReportLoad.ioCpuMicros) / (seconds * 1e6));
+		}
+
+		const StateBandwidthCounters& state = m_hostNet.getStateBandwidth();
+		if (state.snapshots > 0)
+		{
+			LOG_INFO("HeadlessHost: state %.1f B/snapshot (full format %.1f B/snapshot), %.1f snapshots/s and %.0f B/s per match",
+				static_cast<float>(state.bytesSent) / state.snapshots, static_cast<float>(state.bytesIfFull) / state.snapshots,
+				state.snapshots / seconds / m_matches.size(), state.bytesSent / seconds / m_matches.size());
+		}
+
+		uint64_t rewinds = 0;
+		InputBufferStats inputs;
+		float rateSum = 0.f;
+		float lowestRate = 0.f;
+		float rttSum = 0.f;
+		float worstRtt = 0.f;
+		int measured = 0;
+		for (const auto& match : m_matches)
+		{
+			rewinds += match.second.lagCompensator.getStats().rewinds;
+
+			InputBufferStats matchInputs;
+			if (m_hostNet.getInputStats(match.first, matchInputs))
+			{
+				inputs.consumed += matchInputs.consumed;
+				inputs.recovered += matchInputs.recovered;
+				inputs.missed += matchInputs.missed;
+			}
+
+			float rate = m_hostNet.getSnapshotRateHz(match.first);
+			rateSum += rate;
+			if (lowestRate == 0.f || rate < lowestRate)
+				lowestRate = rate;
+
+			LinkEstimator link;
+			if (m_hostNet.getLinkEstimate(match.first, link) && link.hasSample())
+			{
+				rttSum += link.getRttMs();
+				if (link.getRttMs() > worstRtt)
+					worstRtt = link.getRttMs();
+				measured++;
+			}
+		}
+		LOG_INFO("HeadlessHost: %llu guest hits restored by lag compensation in running matches",
+			static_cast<unsigned long long>(rewinds));
+		if (inputs.consumed > 0)
+		{
+			LOG_INFO("HeadlessHost: guest input ticks in running matches: %llu stepped, %llu recovered from repeats, %llu missed (%.2f%%)",
+				static_cast<unsigned long long>(inputs.consumed), static_cast<unsigned long long>(inputs.recovered),
+				static_cast<unsigned long long>(inputs.missed), 100.0 * inputs.missed / inputs.consumed);
+		}
+		if (m_hostNet.getSnapshotRate().adaptive)
+		{
+			LOG_INFO("HeadlessHost: snapshot rate %.1f Hz average, %.1f Hz lowest", rateSum / m_matches.size(), lowestRate);
+		}
+
+		const SpectatorFanoutCounters& fanout = m_hostNet.getSpectatorFanout();
+		if (m_hostNet.getSpectatorCount() > 0 && fanout.snapshots > 0)
+		{
+			LOG_INFO("HeadlessHost: %zu spectators (%zu by multicast), %.1f datagrams and %.0f B per snapshot encoded",
+				m_hostNet.getSpectatorCount(), m_hostNet.getMulticastSpectatorCount(),
+				static_cast<float>(fanout.datagrams) / fanout.snapshots, static_cast<float>(fanout.bytesSent) / fanout.snapshots);
+		}
+		if (measured > 0)
+		{
+			LOG_INFO("HeadlessHost: rtt %.1f ms average, %.1f ms worst", rttSum / measured, worstRtt);
+		}
+	}
+
+	m_hostNet.resetIoCounters();
+	m_lastReportLoad = getTickLoad();
+	m_ticksSinceReport = 0;
+}
+
+void HeadlessHost::writeStatsCsv()
+{
+	bool wrote = false;
+	for (auto& entry : m_matches)
+	{
+		NetStats stats;
+		if (!m_hostNet.getNetStats(entry.first, stats) || stats.getWindowCount() == entry.second.statsWindow)
+			continue;
+		entry.second.statsWindow = stats.getWindowCount();
+
+		// Name the connection by the guest's endpoint, which is what the session id encodes
+		sf::IpAddress address(static_cast<uint32_t>(entry.first >> 16));
+		unsigned short port = static_cast<unsigned short>(entry.first & 0xFFFF);
+		stats.writeCsvRow(m_statsCsv, address.toString() + ":" + std::to_string(port));
+		wrote = true;
+	}
+
+	if (wrote)
+		m_statsCsv.flush();
+}
+
+bool HeadlessHost::tickMatch(SessionId id, Match& match, float dt)
+{
+	PongSimState& sim = match.sim;
+
+	if (!sim.gameOver)
+	{
+		int8_t guestInput = m_hostNet.consumeGuestInput(id);
+		uint16_t viewTick = 0;
+		bool hasViewTick = m_hostNet.getGuestViewTick(id, viewTick);
+		match.lagCompensator.step(sim, houseInput(sim), guestInput, dt, viewTick, hasViewTick);
+		m_hostNet.announceScore(id, sim);
+	}
+	else
+	{
+		match.gameOverTime += sf::seconds(dt);
+		if (match.gameOverTime >= m_gameOverLinger)
+			return false;
+	}
+
+	NetLogicStates state = makeState(sim);
+	m_hostNet.sendStateUpdate(id, state);
+	return true;
+}
+
+void HeadlessHost::removeFromMatchOrder(SessionId id)
+{
+	m_matchOrder.erase(std::remove(m_matchOrder.begin(), m_matchOrder.end(), id), m_matchOrder.end());
+}
+
+void HeadlessHost::sendSpectatorState()
+{
+	// Matches leave the queue as they end, so the front is always the oldest still running
+	if (m_matchOrder.empty())
+		return;
+
+	m_hostNet.sendSpectatorState(makeState(m_matches[m_matchOrder.front()].sim));
+}
+
+NetLogicStates HeadlessHost::makeState(const PongSimState& sim)
+{
+	NetLogicStates state;
+	state.messageType = MessageTypes::STATE_UPDATE;
+	state.tick = static_cast<uint16_t>(sim.tick);
+	state.p1Y = sim.leftPaddleY;
+	state.p2Y = sim.rightPaddleY;
+	state.ballX = sim.ballX;
+	state.ballY = sim.ballY;
+	state.ballVelX = sim.ballVelX;
+	state.ballVelY = sim.ballVelY;
+	state.p1Score = sim.leftScore;
+	state.p2Score = sim.rightScore;
+	return state;
+}
+
+int8_t HeadlessHost::houseInput(const PongSimState& sim)
+{
+	const float deadZone = 10.f;
+	float paddleCentre = sim.leftPaddleY + PongSim::PaddleHeight / 2.f;
+	float ballCentre = sim.ballY + PongSim::BallRadius;
+
+	if (ballCentre < paddleCentre - deadZone)
+		return -1;
+	if (ballCentre > paddleCentre + deadZone)
+		return 1;
+	return 0;
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <SFML/System.hpp>
+
+#include "FixedTimestep.h"
+#include "HostNetworkController.h"
+#include "LagCompensator.h"
+#include "PongSim.h"
+
+/// <summary>
+/// @brief Running totals of the host's work since start(), readable from any thread.
+/// </summary>
+struct HostTickLoad
+{
+	uint64_t ticks = 0;
+	uint64_t overruns = 0;		// ticks that took longer than the tick budget
+	int64_t busyMicros = 0;		// wall time spent inside tick()
+	int64_t tickCpuMicros = 0;	// CPU time of the thread running the ticks
+	int64_t ioCpuMicros = 0;	// CPU time of the socket I/O thread, zero when it is disabled
+	size_t matches = 0;			// matches running after the last tick
+};
+
+/// <summary>
+/// @brief Dedicated host that runs matches with no window, font or vsync.
+///
+/// Runs the same PongSim rules and HostNetworkController traffic as a windowed host.
+/// Every connected guest gets its own independent match on the single bound port.
+/// The left paddle is driven by a simple ball-tracking bot since there is no local player.
+/// Spectators all watch one featured match, the oldest still running.
+/// Example usage:
+///		HeadlessHost host(54000, 60.0, 256);
+///		if (host.start())
+///			host.run();
+/// </summary>
+class HeadlessHost
+{
+public:
+	HeadlessHost(unsigned short port, double tickRate, size_t maxMatches);
+
+	/// <summary>
+	/// @brief Binds the host socket. Returns false if the port is unavailable.
+	/// </summary>
+	bool start();
+
+	/// <summary>
+	/// @brief Fixed-step server loop. Sleeps between ticks and returns after stop().
+	/// </summary>
+	void run();
+
+	/// <summary>
+	/// @brief Asks run() to return at the end of the current tick. Safe to call from a signal handler.
+	/// </summary>
+	void stop() { m_running = false; }
+
+	/// <summary>
+	/// @brief Writes every match's per-second NetStats to a CSV file. Returns false if it can't be opened.
+	/// </summary>
+	bool openStatsCsv(const std::string& path);
+
+	/// <summary>
+	/// @brief Read and send on the caller's thread instead of a dedicated I/O thread. Call before start().
+	/// </summary>
+	void disableIoThread() { m_hostNet.setIoThread(false); }
+
+	/// <summary>
+	/// @brief Make one socket call per datagram even where recvmmsg/sendmmsg are built in. Call before start().
+	/// </summary>
+	void disableBatchedIo() { m_hostNet.setBatchedIo(false); }
+
+	/// <summary>
+	/// @brief Adds delay, loss, duplication or reordering to the host's traffic. Call before start().
+	/// </summary>
+	void setNetConditioner(const NetConditionerConfig& config) { m_hostNet.setNetConditioner(config); }
+
+	/// <summary>
+	/// @brief Snapshots per second sent to each guest, fixed or adaptive, independent of the tick rate.
+	/// </summary>
+	void setSnapshotRate(const SnapshotRateConfig& config) { m_hostNet.setSnapshotRate(config, m_tickRate); }
+
+	/// <summary>
+	/// @brief Spectator limit, and the multicast group their snapshots go to (see HostNetworkController).
+	/// </summary>
+	void setMaxSpectators(size_t maxSpectators) { m_hostNet.setMaxSpectators(maxSpectators); }
+	void setSpectatorMulticast(const SpectatorMulticastConfig& config) { m_hostNet.setSpectatorMulticast(config); }
+
+	/// <summary>
+	/// @brief Lobby service to register with and report load to (see LobbyService). Call before start().
+	/// </summary>
+	void setLobby(const LobbyConfig& config) { m_hostNet.setLobby(config); }
+
+	/// <summary>
+	/// @brief Tick and CPU totals since start(). Safe to call from another thread while run() is going.
+	/// </summary>
+	HostTickLoad getTickLoad() const;
+
+private:
+	struct Match
+	{
+		PongSimState sim;
+		LagCompensator lagCompensator;
+		sf::Time gameOverTime{ sf::Time::Zero };
+		uint64_t statsWindow = 0;	// last NetStats window written to the CSV
+	};
+
+	void tick(float dt);
+
+	/// <summary>
+	/// @brief Runs one tick and adds its wall and CPU time to the load totals.
+	/// </summary>
+	void measuredTick(float dt);
+
+	/// <summary>
+	/// @brief Steps one match and sends its state. Returns false once the match should be torn down.
+	/// </summary>
+	bool tickMatch(SessionId id, Match& match, float dt);
+
+	// Called wherever a match is erased, so m_matchOrder only holds running matches
+	void removeFromMatchOrder(SessionId id);
+
+	/// <summary>
+	/// @brief Sends the featured match (the oldest still running) to every spectator.
+	/// </summary>
+	void sendSpectatorState();
+
+	static NetLogicStates makeState(const PongSimState& sim);
+
+	/// <summary>
+	/// @brief Input for the host-side paddle: follow the ball with a small dead zone.
+	/// </summary>
+	static int8_t houseInput(const PongSimState& sim);
+
+	/// <summary>
+	/// @brief Prints packets/sec and socket calls per tick since the last report, then clears the counters.
+	/// </summary>
+	void reportIoCounters();
+
+	/// <summary>
+	/// @brief Appends a CSV row for every match whose NetStats closed a new window.
+	/// </summary>
+	void writeStatsCsv();
+
+	HostNetworkController m_hostNet;
+	unsigned short m_port;
+	float m_tickRate;
+	FixedTimestep m_timestep;
+	sf::Time m_timePerTick;		// the step as an sf::Time, for budgets and reports
+
+	std::unordered_map<SessionId, Match> m_matches;
+	std::deque<SessionId> m_matchOrder;	// running matches, oldest first; the front one is featured
+
+	// how long the final score keeps being sent before the match is torn down
+	sf::Time m_gameOverLinger{ sf::seconds(5.f) };
+
+	// socket I/O summary interval
+	sf::Time m_reportInterval{ sf::seconds(10.f) };
+	int64_t m_ticksSinceReport{ 0 };
+
+	// load totals, written by the tick thread and read by getTickLoad()
+	std::atomic<uint64_t> m_ticks{ 0 };
+	std::atomic<uint64_t> m_overruns{ 0 };
+	std::atomic<int64_t> m_busyMicros{ 0 };
+	std::atomic<int64_t> m_tickCpuMicros{ 0 };
+	std::atomic<size_t> m_matchCount{ 0 };
+	sf::Time m_cpuAtStart;			// tick thread's CPU time when run() began
+	HostTickLoad m_lastReportLoad;	// totals at the previous report
+
+	// per-second connection statistics, when requested on the command line
+	std::ofstream m_statsCsv;
+
+	std::atomic<bool> m_running{ false };
+};
@@ -0,0 +1,204 @@
+#include "IoBenchmark.h"
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <SFML/System.hpp>
+
+#include "AsyncLogger.h"
+#include "GuestNetworkController.h"
+#include "HostNetworkController.h"
+
+namespace
+{
+	const unsigned short BenchPort = 54096;
+	const int WarmupTicks = 60;
+	const int MeasuredTicks = 300;
+	const sf::Time JoinTimeout = sf::seconds(20.f);
+
+	struct Guest
+	{
+		GuestNetworkController net;
+		bool sentHello = false;
+		bool connected = false;
+		uint16_t tick = 0;
+		uint64_t snapshots = 0;
+	};
+
+	// A rally: the ball moves every tick, the paddles now and then
+	NetLogicStates makeState(uint32_t tick)
+	{
+		NetLogicStates state;
+		state.messageType = MessageTypes::STATE_UPDATE;
+		state.tick = static_cast<uint16_t>(tick);
+		state.p1Y = 300.f + static_cast<float>(tick % 64);
+		state.p2Y = 420.f - static_cast<float>(tick % 32);
+		state.ballX = static_cast<float>((tick * 7) % 1400);
+		state.ballY = static_cast<float>((tick * 5) % 860);
+		state.ballVelX = 400.f;
+		state.ballVelY = 250.f;
+		state.p1Score = 3;
+		state.p2Score = 5;
+		return state;
+	}
+
+	// Discovery and handshake for every guest, the same steps as Game::lookingForHost
+	bool joinAll(HostNetworkController& host, std::vector<std::unique_ptr<Guest>>& guests, std::vector<SessionId>& sessions)
+	{
+		sf::Clock clock;
+		size_t connected = 0;
+		while (connected < guests.size() && clock.getElapsedTime() < JoinTimeout)
+		{
+			host.poll();
+			SessionId id;
+			while (host.acceptNewSession(id))
+				sessions.push_back(id);
+
+			for (auto& guest : guests)
+			{
+				if (guest->connected)
+					continue;
+				GuestNetworkController& net = guest->net;
+				net.poll();
+				sf::IpAddress address(sf::IpAddress::Any);
+				unsigned short port = 0;
+				if (!guest->sentHello)
+				{
+					net.sendFindHostIfDue(BenchPort);
+					if (net.recieveHostHere(address, port))
+					{
+						net.sendHello();
+						guest->sentHello = true;
+					}
+				}
+				else if (net.recieveHelloAck())
+				{
+					guest->connected = true;
+					connected++;
+				}
+				else if (!net.retryHelloIfDue())
+				{
+					guest->sentHello = false;
+					net.restartDiscovery();
+				}
+			}
+			sf::sleep(sf::milliseconds(1));
+		}
+		return connected == guests.size();
+	}
+
+	// The guests' side of one tick: read the host's snapshots, send the next input
+	void tickGuests(std::vector<std::unique_ptr<Guest>>& guests, uint32_t hostTick)
+	{
+		NetLogicStates state;
+		sf::Time arrival;
+		for (auto& guest : guests)
+		{
+			guest->net.poll();
+			while (guest->net.recieveStateUpdate(state, arrival))
+				guest->snapshots++;
+			guest->net.sendInput(guest->tick++, static_cast<int8_t>(hostTick % 3) - 1, static_cast<uint16_t>(hostTick));
+		}
+	}
+
+	void runCase(size_t guestCount, bool batched)
+	{
+		const sf::Time timePerTick = sf::seconds(1.f / PongSim::TickRate);
+		const char* backend = batched ? "recvmmsg/sendmmsg" : "per datagram";
+
+		HostNetworkController host;
+		host.setIoThread(false);
+		host.setBatchedIo(batched);
+		host.setBeaconInterval(0);
+		host.setMaxSessions(guestCount);
+		if (!host.bind(BenchPort))
+		{
+			std::printf("  could not bind the benchmark host on port %u\n", BenchPort);
+			return;
+		}
+
+		std::vector<std::unique_ptr<Guest>> guests;
+		for (size_t i = 0; i < guestCount; ++i)
+		{
+			std::unique_ptr<Guest> guest(new Guest());
+			guest->net.setIoThread(false);
+			if (!guest->net.bind(0))
+			{
+				std::printf("  could not bind guest %zu\n", i);
+				return;
+			}
+			guests.push_back(std::move(guest));
+		}
+
+		std::vector<SessionId> sessions;
+		if (!joinAll(host, guests, sessions))
+		{
+			std::printf("  %4zu guests  %-18s not every guest joined\n", guestCount, backend);
+			return;
+		}
+
+		sf::Clock clock;
+		sf::Time hostTime = sf::Time::Zero;
+		sf::Time measureStart = sf::Time::Zero;
+		uint32_t tick = 0;
+		for (int i = 0; i < WarmupTicks + MeasuredTicks; ++i)
+		{
+			if (i == WarmupTicks)
+			{
+				host.resetIoCounters();
+				measureStart = clock.getElapsedTime();
+				for (auto& guest : guests)
+					guest->snapshots = 0;
+			}
+			sf::Time tickStart = clock.getElapsedTime();
+
+			// ---- The host's part of one tick: drain every input, answer every guest, send ----
+			host.poll();
+			NetLogicStates state = makeState(tick++);
+			for (SessionId id : sessions)
+			{
+				host.consumeGuestInput(id);
+				NetLogicStates copy = state;
+				host.sendStateUpdate(id, copy);
+			}
+			host.flush();
+			if (i >= WarmupTicks)
+				hostTime += clock.getElapsedTime() - tickStart;
+
+			tickGuests(guests, tick);
+
+			sf::Time elapsed = clock.getElapsedTime() - tickStart;
+			if (elapsed < timePerTick)
+				sf::sleep(timePerTick - elapsed);
+		}
+		double seconds = (clock.getElapsedTime() - measureStart).asSeconds();
+		DatagramIoCounters counters = host.getIoCounters();
+
+		uint64_t delivered = 0;
+		for (const auto& guest : guests)
+			delivered += guest->snapshots;
+
+		std::printf("  %4zu guests  %-18s %8.0f pkt/s in %8.0f pkt/s out  %6.1f recv calls/tick  %6.1f send calls/tick  host %7.1f us/tick  delivered %5.1f%%\n",
+			guestCount, backend, counters.packetsReceived / seconds, counters.packetsSent / seconds,
+			static_cast<double>(counters.receiveCalls) / MeasuredTicks, static_cast<double>(counters.sendCalls) / MeasuredTicks,
+			hostTime.asMicroseconds() / static_cast<double>(MeasuredTicks),
+			100.0 * delivered / (static_cast<double>(guestCount) * MeasuredTicks));
+	}
+}
+
+void runIoBenchmark()
+{
+	AsyncLogger::instance().setLevel(LogLevel::Warning);
+
+	const size_t guestCounts[] = { 1, 10, 100 };
+
+	std::printf("Host socket I/O over loopback, %d ticks at %.0f Hz (host time = poll + snapshots + flush):\n",
+		MeasuredTicks, PongSim::TickRate);
+	if (!DatagramSocket::hasBatchedIo())
+		std::printf("  (this build has no recvmmsg/sendmmsg backend; build on Linux with PONG_BATCHED_IO=1 to compare it)\n");
+	for (size_t guestCount : guestCounts)
+	{
+		runCase(guestCount, false);
+		if (DatagramSocket::hasBatchedIo())
+			runCase(guestCount, true);
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+/// <summary>
+/// @brief Compares the host's socket backends: packets/sec and socket calls per tick at 1, 10 and 100 guests.
+///
+/// A host on BenchPort and every guest run in this process over loopback, all with their sockets
+///  on this thread, so the counters are exactly the calls the host's poll() and flush() make. Each
+///  tick every guest sends a GUEST_INPUT and the host steps no sim, just drains the inputs and
+///  answers every guest with a STATE_UPDATE. Each guest count runs once per backend: one
+///  UdpSocket call per datagram, and recvmmsg/sendmmsg when the build has them (PONG_BATCHED_IO,
+///  on by default on Linux; see DatagramSocket.h).
+/// Run with PongServer --bench-io.
+/// </summary>
+void runIoBenchmark();
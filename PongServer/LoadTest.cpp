@@ -0,0 +1,271 @@
+#include "LoadTest.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <SFML/System.hpp>
+
+#include "AsyncLogger.h"
+#include "HeadlessHost.h"
+
+namespace
+{
+	const unsigned short LoadTestPort = 54095;
+	const sf::Time MaxWarmup = sf::seconds(60.f);
+	const sf::Time ProgressInterval = sf::seconds(5.f);
+
+	// New bots each thread lets in per tick, so the first FIND_HOSTs don't all land in one burst
+	const size_t RampPerTick = 16;
+
+	enum class Stage { WarmingUp, Measuring, Stopping };
+
+	struct BotThread
+	{
+		std::vector<std::unique_ptr<BotGuest>> bots;
+		std::thread thread;
+		std::atomic<size_t> playing{ 0 };
+		uint64_t measuredTicks = 0;
+		uint64_t lateTicks = 0;		// measured ticks that started after the next one was due
+	};
+
+	// Ticks one thread's bots at the fastest rate any of their hosts ticks at, until told to stop
+	void runBots(BotThread& worker, const std::atomic<Stage>& stage)
+	{
+		sf::Time timePerTick = sf::seconds(1.f / PongSim::TickRate);
+		size_t active = 0;
+		bool recording = false;
+		sf::Time nextTick = DatagramSocket::now();
+
+		while (stage != Stage::Stopping)
+		{
+			bool measuring = stage == Stage::Measuring;
+			if (measuring != recording)
+			{
+				for (auto& bot : worker.bots)
+					bot->setRecording(measuring);
+				recording = measuring;
+			}
+
+			active = std::min(active + RampPerTick, worker.bots.size());
+			size_t playing = 0;
+			float tickRate = PongSim::TickRate;
+			for (size_t i = 0; i < active; ++i)
+			{
+				worker.bots[i]->update();
+				if (worker.bots[i]->isPlaying())
+					playing++;
+				tickRate = std::max(tickRate, worker.bots[i]->getHostTickRate());
+			}
+			worker.playing = playing;
+			timePerTick = sf::seconds(1.f / tickRate);
+
+			if (recording)
+				worker.measuredTicks++;
+			nextTick += timePerTick;
+			sf::Time now = DatagramSocket::now();
+			if (now < nextTick)
+			{
+				sf::sleep(nextTick - now);
+			}
+			else
+			{
+				if (recording)
+					worker.lateTicks++;
+				// Behind by more than a tick: drop the backlog rather than run the bots in a burst
+				if (now - nextTick > timePerTick)
+					nextTick = now;
+			}
+		}
+	}
+
+	size_t countPlaying(const std::vector<std::unique_ptr<BotThread>>& workers)
+	{
+		size_t playing = 0;
+		for (const auto& worker : workers)
+			playing += worker->playing;
+		return playing;
+	}
+
+	float percentile(const std::vector<float>& sorted, float fraction)
+	{
+		size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5f);
+		return sorted[index];
+	}
+
+	float mean(const std::vector<float>& values)
+	{
+		double sum = 0.0;
+		for (float value : values)
+			sum += value;
+		return static_cast<float>(sum / values.size());
+	}
+}
+
+void runLoadTest(const LoadTestConfig& config)
+{
+	AsyncLogger::instance().setLevel(LogLevel::Warning);
+
+	size_t threadCount = config.threads;
+	if (threadCount == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = cores > 2 ? cores - 1 : 1;
+	}
+	threadCount = std::max<size_t>(1, std::min(threadCount, config.bots));
+
+	// ---- The host, unless one is already running ----
+	unsigned short port = config.externalHost ? config.port : LoadTestPort;
+	std::unique_ptr<HeadlessHost> host;
+	std::thread hostThread;
+	if (!config.externalHost)
+	{
+		// Finished matches linger for the final score while their bots already play the next one
+		host.reset(new HeadlessHost(port, PongSim::TickRate, config.bots * 2));
+		if (!host->start())
+		{
+			std::printf("Could not bind the load test host on port %u\n", port);
+			return;
+		}
+		hostThread = std::thread([&host]() { host->run(); });
+	}
+
+	std::printf("Load test: %zu bots on %zu threads against %s host on port %u, %s input\n",
+		config.bots, threadCount, config.externalHost ? "an external" : "an in-process", port,
+		config.input == BotInputMode::Track ? "ball-tracking" : "scripted sweep");
+
+	// ---- Bots, dealt round-robin over the threads ----
+	std::atomic<Stage> stage{ Stage::WarmingUp };
+	std::vector<std::unique_ptr<BotThread>> workers;
+	for (size_t i = 0; i < threadCount; ++i)
+		workers.emplace_back(new BotThread());
+	for (size_t i = 0; i < config.bots; ++i)
+		workers[i % threadCount]->bots.emplace_back(new BotGuest(port, config.input, static_cast<uint32_t>(i + 1)));
+	for (auto& worker : workers)
+		worker->thread = std::thread(runBots, std::ref(*worker), std::cref(stage));
+
+	// ---- Warm up until everyone is in a match ----
+	sf::Clock clock;
+	sf::Time lastProgress = sf::Time::Zero;
+	while (countPlaying(workers) < config.bots && clock.getElapsedTime() < MaxWarmup)
+	{
+		sf::sleep(sf::milliseconds(100));
+		if (clock.getElapsedTime() - lastProgress >= ProgressInterval)
+		{
+			lastProgress = clock.getElapsedTime();
+			std::printf("  warming up: %zu of %zu bots playing after %.0f s\n",
+				countPlaying(workers), config.bots, lastProgress.asSeconds());
+		}
+	}
+	std::printf("  %zu of %zu bots playing after %.1f s; measuring for %.0f s\n",
+		countPlaying(workers), config.bots, clock.getElapsedTime().asSeconds(), config.seconds);
+
+	// ---- Measure ----
+	HostTickLoad loadBefore;
+	if (host)
+		loadBefore = host->getTickLoad();
+	stage = Stage::Measuring;
+	clock.restart();
+	sf::sleep(sf::seconds(config.seconds));
+	sf::Time measured = clock.getElapsedTime();
+	HostTickLoad loadAfter;
+	if (host)
+		loadAfter = host->getTickLoad();
+	size_t playingAtEnd = countPlaying(workers);
+
+	// The host goes first, so it isn't left sending into sockets nobody reads any more
+	if (host)
+	{
+		host->stop();
+		hostThread.join();
+	}
+	stage = Stage::Stopping;
+	for (auto& worker : workers)
+		worker->thread.join();
+
+	// ---- Report ----
+	std::vector<float> snapshotRates;
+	std::vector<float> losses;
+	std::vector<float> jitters;
+	std::vector<float> rtts;
+	std::vector<float> joinTimes;
+	BotCounters totals;
+	uint64_t measuredTicks = 0;
+	uint64_t lateTicks = 0;
+	for (const auto& worker : workers)
+	{
+		measuredTicks += worker->measuredTicks;
+		lateTicks += worker->lateTicks;
+		for (const auto& bot : worker->bots)
+		{
+			for (const BotSample& sample : bot->getSamples())
+			{
+				snapshotRates.push_back(static_cast<float>(sample.snapshots));
+				losses.push_back(sample.lossPercent);
+				jitters.push_back(sample.jitterMs);
+				if (sample.hasRtt)
+					rtts.push_back(sample.rttMs);
+			}
+			joinTimes.insert(joinTimes.end(), bot->getJoinTimesMs().begin(), bot->getJoinTimesMs().end());
+
+			const BotCounters& counters = bot->getCounters();
+			totals.joins += counters.joins;
+			totals.matchesFinished += counters.matchesFinished;
+			totals.stalls += counters.stalls;
+		}
+	}
+
+	std::printf("  %zu bots playing at the end; %llu joins, %llu matches finished and %llu stalls over the whole run\n",
+		playingAtEnd, static_cast<unsigned long long>(totals.joins),
+		static_cast<unsigned long long>(totals.matchesFinished), static_cast<unsigned long long>(totals.stalls));
+	if (totals.joins == 0 || playingAtEnd + config.bots / 10 < config.bots)
+		std::printf("  (bots that never get into a match may have run out of sockets; check the open file limit)\n");
+
+	if (snapshotRates.empty())
+	{
+		std::printf("  no full second of play was recorded\n");
+	}
+	else
+	{
+		std::sort(snapshotRates.begin(), snapshotRates.end());
+		std::sort(losses.begin(), losses.end());
+		std::sort(jitters.begin(), jitters.end());
+		std::printf("  snapshots/s per bot:  p50 %5.1f  p10 %5.1f  p1 %5.1f  min %5.1f  (%zu bot-seconds)\n",
+			percentile(snapshotRates, 0.5f), percentile(snapshotRates, 0.1f), percentile(snapshotRates, 0.01f),
+			snapshotRates.front(), snapshotRates.size());
+		std::printf("  loss %%:               mean %5.2f  p99 %5.2f  max %5.2f\n",
+			mean(losses), percentile(losses, 0.99f), losses.back());
+		std::printf("  jitter ms:            p50 %5.2f  p99 %5.2f  max %5.2f\n",
+			percentile(jitters, 0.5f), percentile(jitters, 0.99f), jitters.back());
+	}
+	if (!rtts.empty())
+	{
+		std::sort(rtts.begin(), rtts.end());
+		std::printf("  rtt ms:               p50 %5.2f  p90 %5.2f  p99 %5.2f  max %5.2f\n",
+			percentile(rtts, 0.5f), percentile(rtts, 0.9f), percentile(rtts, 0.99f), rtts.back());
+	}
+	if (!joinTimes.empty())
+	{
+		std::sort(joinTimes.begin(), joinTimes.end());
+		std::printf("  join ms:              p50 %5.1f  p90 %5.1f  p99 %5.1f  max %5.1f  (%zu joins)\n",
+			percentile(joinTimes, 0.5f), percentile(joinTimes, 0.9f), percentile(joinTimes, 0.99f),
+			joinTimes.back(), joinTimes.size());
+	}
+
+	if (host)
+	{
+		uint64_t ticks = loadAfter.ticks - loadBefore.ticks;
+		double wallMicros = static_cast<double>(measured.asMicroseconds());
+		double tickCpu = 100.0 * (loadAfter.tickCpuMicros - loadBefore.tickCpuMicros) / wallMicros;
+		double ioCpu = 100.0 * (loadAfter.ioCpuMicros - loadBefore.ioCpuMicros) / wallMicros;
+		std::printf("  host: %zu matches, %.1f ticks/s, tick busy %.1f%% of budget, %llu overruns, CPU %.1f%% tick thread + %.1f%% I/O thread = %.1f%% of a core\n",
+			loadAfter.matches, ticks / measured.asSeconds(),
+			ticks > 0 ? 100.0 * (loadAfter.busyMicros - loadBefore.busyMicros) / (ticks * 1e6 / PongSim::TickRate) : 0.0,
+			static_cast<unsigned long long>(loadAfter.overruns - loadBefore.overruns), tickCpu, ioCpu, tickCpu + ioCpu);
+	}
+	if (measuredTicks > 0)
+	{
+		std::printf("  bot threads: %.1f%% of ticks late\n", 100.0 * lateTicks / measuredTicks);
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+
+#include "BotGuest.h"
+
+struct LoadTestConfig
+{
+	size_t bots = 100;
+	float seconds = 30.f;		// measured, after every bot has joined (or the warm-up ran out)
+	size_t threads = 0;			// bot threads; 0 picks one per core, leaving one for the host
+	BotInputMode input = BotInputMode::Track;
+	bool externalHost = false;	// load a host already running on port instead of starting one here
+	unsigned short port = 54000;
+};
+
+/// <summary>
+/// @brief Capacity test: thousands of BotGuests in this process against one host over loopback.
+///
+/// Unless externalHost is set, a HeadlessHost runs on its own thread on LoadTestPort with its
+///  usual I/O thread, so its CPU can be read separately from the bots'. The bots are split over
+///  a few threads that each tick their share at the host's tick rate. Once every bot is playing the
+///  test records for config.seconds and prints per-bot snapshot rate, loss, jitter and RTT
+///  percentiles over one-second windows, join times, and the host's tick load and CPU.
+/// Run with PongServer --load-test N [--load-seconds S] [--load-threads T] [--load-input track|sweep] [--load-external].
+/// </summary>
+void runLoadTest(const LoadTestConfig& config);
@@ -0,0 +1,291 @@
+#include "LobbyBenchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <SFML/System.hpp>
+
+#include "AsyncLogger.h"
+#include "GuestNetworkController.h"
+#include "HostNetworkController.h"
+#include "LobbyService.h"
+
+namespace
+{
+	const unsigned short LobbyPort = 54093;
+	const unsigned short BroadcastPort = 54094;
+	const size_t HostCapacity = 256;	// HeadlessHost's default --max-matches
+	const size_t Requests = 20000;
+	const size_t Clients = 16;
+	const size_t RequestsPerClient = 8;	// per round; 128 in flight stays inside the lobby's receive buffer
+	const size_t Joins = 100;
+	const sf::Time JoinTimeout = sf::seconds(5.f);
+	const sf::Time HeartbeatPoll = sf::milliseconds(250);
+
+	struct Hosts
+	{
+		std::vector<std::unique_ptr<HostNetworkController>> all;
+		std::unordered_map<unsigned short, HostNetworkController*> byPort;
+
+		bool add(size_t count, unsigned short port, const LobbyConfig& lobby)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				std::unique_ptr<HostNetworkController> host(new HostNetworkController());
+				host->setIoThread(false);
+				host->setBeaconInterval(0);
+				host->setMaxSessions(HostCapacity);
+				host->setLobby(lobby);
+				if (!host->bind(port))
+					return false;
+				byPort[host->getLocalPort()] = host.get();
+				all.push_back(std::move(host));
+			}
+			return true;
+		}
+
+		// Heartbeats and session bookkeeping, so none of them times out at the lobby
+		void pollAll()
+		{
+			for (auto& host : all)
+				pollOne(*host);
+		}
+
+		static void pollOne(HostNetworkController& host)
+		{
+			host.poll();
+			SessionId id;
+			while (host.acceptNewSession(id)) {}
+		}
+	};
+
+	float percentile(const std::vector<float>& sorted, float fraction)
+	{
+		size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5f);
+		return sorted[index];
+	}
+
+	// Registration arrives a batch at a time, so hundreds of hosts don't overflow the lobby's receive buffer
+	bool registerAll(LobbyService& lobby, Hosts& hosts)
+	{
+		for (size_t i = 0; i < hosts.all.size(); ++i)
+		{
+			Hosts::pollOne(*hosts.all[i]);
+			if ((i + 1) % DatagramSocket::BatchSize == 0)
+				lobby.poll();
+		}
+
+		sf::Clock clock;
+		while (lobby.getHostCount() < hosts.all.size() && clock.getElapsedTime() < JoinTimeout)
+		{
+			sf::sleep(sf::milliseconds(1));
+			lobby.poll();
+		}
+		return lobby.getHostCount() == hosts.all.size();
+	}
+
+	// LOBBY_FINDs from a few client sockets, in rounds; only the lobby's poll() is timed
+	void measureAssignments(LobbyService& lobby, double& usPerAssignment, size_t& answered)
+	{
+		std::vector<std::unique_ptr<DatagramSocket>> clients;
+		for (size_t i = 0; i < Clients; ++i)
+		{
+			std::unique_ptr<DatagramSocket> client(new DatagramSocket());
+			if (client->bind(0) != sf::Socket::Status::Done)
+				return;
+			clients.push_back(std::move(client));
+		}
+
+		std::vector<Datagram> batch(DatagramSocket::BatchSize);
+		sf::Time lobbyTime = sf::Time::Zero;
+		sf::Clock clock;
+		answered = 0;
+		lobby.resetCounters();
+		for (size_t sent = 0; sent < Requests;)
+		{
+			for (auto& client : clients)
+			{
+				for (size_t i = 0; i < RequestsPerClient && sent < Requests; ++i, ++sent)
+				{
+					Datagram& find = client->stageSend(sf::IpAddress::LocalHost, LobbyPort);
+					find.size = encodePacket(LobbyFindPacket(), find.data, sizeof(find.data));
+				}
+				client->flush();
+			}
+
+			sf::Time start = clock.getElapsedTime();
+			lobby.poll();
+			lobbyTime += clock.getElapsedTime() - start;
+
+			for (auto& client : clients)
+			{
+				size_t count;
+				while ((count = client->receiveBatch(batch.data(), batch.size())) > 0)
+				{
+					for (size_t i = 0; i < count; ++i)
+						if (batch[i].size > 0 && static_cast<uint8_t>(batch[i].data[0]) == MessageTypes::LOBBY_ASSIGN)
+							answered++;
+				}
+			}
+		}
+
+		uint64_t assignments = lobby.getCounters().assignments;
+		usPerAssignment = assignments > 0 ? lobbyTime.asMicroseconds() / static_cast<double>(assignments) : 0.0;
+	}
+
+	// Guests join one after another, the same steps as Game::lookingForHost; ms from the first find to HELLO_ACK
+	std::vector<float> measureJoins(LobbyService* lobby, Hosts& hosts, unsigned short discoveryPort, size_t& failed)
+	{
+		std::vector<float> times;
+		failed = 0;
+		sf::Clock sinceHeartbeats;
+		for (size_t join = 0; join < Joins; ++join)
+		{
+			// Keep every host's registration fresh between joins, outside the measured time
+			if (sinceHeartbeats.getElapsedTime() >= HeartbeatPoll)
+			{
+				hosts.pollAll();
+				if (lobby)
+					lobby->poll();
+				sinceHeartbeats.restart();
+			}
+
+			GuestNetworkController guest;
+			guest.setIoThread(false);
+			if (lobby)
+			{
+				LobbyConfig config;
+				config.address = sf::IpAddress::LocalHost;
+				config.port = LobbyPort;
+				guest.setLobby(config);
+			}
+			if (!guest.bind(0))
+			{
+				failed++;
+				continue;
+			}
+
+			HostNetworkController* target = hosts.all.size() == 1 ? hosts.all.front().get() : nullptr;
+			bool sentHello = false;
+			bool joined = false;
+			sf::Clock clock;
+			while (!joined && clock.getElapsedTime() < JoinTimeout)
+			{
+				if (lobby)
+					lobby->poll();
+				if (target)
+					Hosts::pollOne(*target);
+
+				guest.poll();
+				sf::IpAddress address(sf::IpAddress::Any);
+				unsigned short port = 0;
+				if (!sentHello)
+				{
+					guest.sendFindHostIfDue(discoveryPort);
+					if (guest.recieveHostHere(address, port))
+					{
+						auto it = hosts.byPort.find(port);
+						target = it != hosts.byPort.end() ? it->second : nullptr;
+						guest.sendHello();
+						sentHello = true;
+					}
+				}
+				else if (guest.recieveHelloAck())
+				{
+					times.push_back(clock.getElapsedTime().asMicroseconds() / 1000.f);
+					joined = true;
+				}
+				else
+				{
+					guest.retryHelloIfDue();
+				}
+			}
+			if (!joined)
+				failed++;
+
+			// Let the host see this guest in its next report
+			if (target)
+				Hosts::pollOne(*target);
+		}
+		return times;
+	}
+
+	void printJoins(std::vector<float>& times, size_t failed)
+	{
+		if (times.empty())
+		{
+			std::printf("  connect: all %zu timed out\n", failed);
+			return;
+		}
+		std::sort(times.begin(), times.end());
+		std::printf("  connect p50 %6.3f  p90 %6.3f  p99 %6.3f  max %6.3f ms  timeouts %zu\n",
+			percentile(times, 0.5f), percentile(times, 0.9f), percentile(times, 0.99f), times.back(), failed);
+	}
+
+	void runCase(size_t hostCount)
+	{
+		LobbyService lobby;
+		if (!lobby.bind(LobbyPort))
+		{
+			std::printf("  could not bind the benchmark lobby on port %u\n", LobbyPort);
+			return;
+		}
+
+		LobbyConfig config;
+		config.address = sf::IpAddress::LocalHost;
+		config.port = LobbyPort;
+		Hosts hosts;
+		if (!hosts.add(hostCount, 0, config) || !registerAll(lobby, hosts))
+		{
+			std::printf("  %4zu hosts: could not register every host (%zu did)\n", hostCount, lobby.getHostCount());
+			return;
+		}
+
+		// ---- Connect latency first, while every host has room ----
+		size_t failed = 0;
+		std::vector<float> times = measureJoins(&lobby, hosts, 0, failed);
+
+		// ---- Then the raw assignment rate, and how evenly it spread the guests ----
+		double usPerAssignment = 0.0;
+		size_t answered = 0;
+		measureAssignments(lobby, usPerAssignment, answered);
+
+		uint16_t minLoad = 0xFFFF;
+		uint16_t maxLoad = 0;
+		for (const auto& entry : lobby.getHosts())
+		{
+			minLoad = std::min(minLoad, entry.second.load);
+			maxLoad = std::max(maxLoad, entry.second.load);
+		}
+
+		std::printf("  %4zu hosts  lobby %5.2f us/assignment (%8.0f assignments/s)  %zu/%zu answered  load %u-%u per host\n",
+			hostCount, usPerAssignment, usPerAssignment > 0.0 ? 1e6 / usPerAssignment : 0.0,
+			answered, Requests, minLoad, maxLoad);
+		printJoins(times, failed);
+	}
+}
+
+void runLobbyBenchmark()
+{
+	AsyncLogger::instance().setLevel(LogLevel::Warning);
+
+	std::printf("Lobby over loopback, %zu sessions per host, %zu requests, %zu one-at-a-time joins:\n",
+		HostCapacity, Requests, Joins);
+
+	const size_t hostCounts[] = { 100, 250, 500 };
+	for (size_t hostCount : hostCounts)
+		runCase(hostCount);
+
+	// The same joins by broadcast FIND_HOST, which can only reach one host per port on a machine
+	Hosts single;
+	if (!single.add(1, BroadcastPort, LobbyConfig()))
+	{
+		std::printf("  could not bind the broadcast host on port %u\n", BroadcastPort);
+		return;
+	}
+	size_t failed = 0;
+	std::vector<float> times = measureJoins(nullptr, single, BroadcastPort, failed);
+	std::printf("     1 host   broadcast FIND_HOST\n");
+	printJoins(times, failed);
+}
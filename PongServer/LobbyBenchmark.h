@@ -0,0 +1,13 @@
+#pragma once
+
+/// <summary>
+/// @brief Measures the lobby service with hundreds of registered hosts: assignments per second and time to connect.
+///
+/// The lobby, every host and every guest run in this process over loopback with their sockets on
+///  this thread. For 100, 250 and 500 hosts it times a stream of LOBBY_FINDs through the lobby's
+///  poll() (its own time only, so the clients' sends are not counted) and reports how evenly the
+///  assignments spread, then times guests joining one at a time, first LOBBY_FIND to HELLO_ACK.
+///  A broadcast FIND_HOST to a single host is timed the same way for comparison.
+/// Run with PongServer --bench-lobby.
+/// </summary>
+void runLobbyBenchmark();
@@ -0,0 +1,203 @@
+#include "LobbyService.h"
+#include "AsyncLogger.h"
+
+namespace
+{
+	uint32_t getTimeMs() { return static_cast<uint32_t>(DatagramSocket::now().asMilliseconds()); }
+}
+
+LobbyService::LobbyService()
+	: m_recvBatch(DatagramSocket::BatchSize)
+{
+}
+
+LobbyHostId LobbyService::makeHostId(const sf::IpAddress& address, unsigned short port)
+{
+	return (static_cast<LobbyHostId>(address.toInteger()) << 16) | port;
+}
+
+bool LobbyService::bind(unsigned short port)
+{
+	if (m_socket.bind(port) != sf::Socket::Status::Done)
+	{
+		LOG_ERROR("LobbyService: Failed to bind on port %u", port);
+		return false;
+	}
+	LOG_INFO("LobbyService: Waiting for hosts and guests on port %u", m_socket.getLocalPort());
+	return true;
+}
+
+void LobbyService::run()
+{
+	sf::SocketSelector selector;
+	selector.add(m_socket);
+	m_lastReportMs = getTimeMs();
+
+	m_running = true;
+	while (m_running)
+	{
+		// Wake for the next datagram, or in time to drop hosts that went quiet
+		selector.wait(sf::milliseconds(ExpiryCheckMs));
+		poll();
+
+		if (getTimeMs() - m_lastReportMs >= ReportIntervalMs)
+			report();
+	}
+}
+
+void LobbyService::poll()
+{
+	static constexpr MessageRoute<LobbyService> Routes[] = {
+		{ MessageTypes::LOBBY_REGISTER, &LobbyService::handleRegister },
+		{ MessageTypes::LOBBY_FIND, &LobbyService::handleFind }
+	};
+	static constexpr MessageRouter<LobbyService> Router(Routes);
+
+	while (true)
+	{
+		size_t count = m_socket.receiveBatch(m_recvBatch.data(), m_recvBatch.size());
+		for (size_t i = 0; i < count; ++i)
+			Router.dispatch(*this, m_recvBatch[i]);
+
+		// Answers leave a batch at a time, before the next drain
+		m_socket.flush();
+		if (count < m_recvBatch.size())
+			break;
+	}
+
+	uint32_t now = getTimeMs();
+	if (now - m_lastExpiryMs >= ExpiryCheckMs)
+	{
+		m_lastExpiryMs = now;
+		expireHosts();
+	}
+}
+
+void LobbyService::handleRegister(const Datagram& datagram)
+{
+	LobbyRegisterPacket report;
+	if (!decodePacket(datagram.data, datagram.size, report) || report.gamePort == 0)
+	{
+		LOG_WARN("LobbyService: Invalid LOBBY_REGISTER packet recieved");
+		return;
+	}
+	m_counters.registrations++;
+
+	LobbyHostId id = makeHostId(datagram.address, report.gamePort);
+	auto it = m_hosts.find(id);
+
+	// ---- Capacity 0: the host is shutting down ----
+	if (report.capacity == 0)
+	{
+		if (it == m_hosts.end())
+			return;
+		unindexHost(id, it->second);
+		m_hosts.erase(it);
+		LOG_INFO("LobbyService: Host " LOG_IPV4_FMT ":%u left (%zu registered)",
+			LOG_IPV4_ARGS(datagram.address), report.gamePort, m_hosts.size());
+		return;
+	}
+
+	if (it == m_hosts.end())
+	{
+		LobbyHost host;
+		host.address = datagram.address;
+		host.port = report.gamePort;
+		it = m_hosts.emplace(id, host).first;
+		LOG_INFO("LobbyService: Host " LOG_IPV4_FMT ":%u registered, capacity %u (%zu registered)",
+			LOG_IPV4_ARGS(datagram.address), report.gamePort, report.capacity, m_hosts.size());
+	}
+	else
+	{
+		unindexHost(id, it->second);
+	}
+
+	// The host's own count replaces ours, including any guest we sent that never turned up
+	LobbyHost& host = it->second;
+	host.capacity = report.capacity;
+	host.load = report.load;
+	host.lastHeardMs = getTimeMs();
+	indexHost(id, host);
+}
+
+void LobbyService::handleFind(const Datagram& datagram)
+{
+	m_counters.requests++;
+	if (m_freeHosts.empty())
+	{
+		m_counters.unanswered++;
+		LOG_WARN_EVERY(1000, "LobbyService: No host has a free session (%zu registered)", m_hosts.size());
+		return;
+	}
+
+	// ---- Least loaded host; count the guest now so the next request sees it ----
+	LobbyHostId id = m_freeHosts.begin()->second;
+	LobbyHost& host = m_hosts[id];
+	unindexHost(id, host);
+	host.load++;
+	host.assigned++;
+	indexHost(id, host);
+
+	LobbyAssignPacket assign;
+	assign.hostAddress = host.address.toInteger();
+	assign.gamePort = host.port;
+	Datagram& reply = m_socket.stageSend(datagram.address, datagram.port);
+	reply.size = encodePacket(assign, reply.data, sizeof(reply.data));
+	m_counters.assignments++;
+
+	LOG_DEBUG("LobbyService: " LOG_IPV4_FMT ":%u -> host " LOG_IPV4_FMT ":%u (%u/%u)",
+		LOG_IPV4_ARGS(datagram.address), datagram.port, LOG_IPV4_ARGS(host.address), host.port, host.load, host.capacity);
+}
+
+void LobbyService::expireHosts()
+{
+	uint32_t now = getTimeMs();
+	for (auto it = m_hosts.begin(); it != m_hosts.end();)
+	{
+		if (now - it->second.lastHeardMs <= LobbyHostTimeoutMs)
+		{
+			++it;
+			continue;
+		}
+		LOG_INFO("LobbyService: Host " LOG_IPV4_FMT ":%u timed out", LOG_IPV4_ARGS(it->second.address), it->second.port);
+		unindexHost(it->first, it->second);
+		it = m_hosts.erase(it);
+	}
+}
+
+void LobbyService::report()
+{
+	uint32_t now = getTimeMs();
+	float seconds = (now - m_lastReportMs) / 1000.f;
+	m_lastReportMs = now;
+
+	size_t capacity = 0;
+	size_t load = 0;
+	for (const auto& entry : m_hosts)
+	{
+		capacity += entry.second.capacity;
+		load += entry.second.load < entry.second.capacity ? entry.second.load : entry.second.capacity;
+	}
+	LOG_INFO("LobbyService: %zu hosts (%zu free), %zu/%zu sessions, %.1f requests/s, %llu assigned, %llu unanswered",
+		m_hosts.size(), m_freeHosts.size(), load, capacity, m_counters.requests / seconds,
+		static_cast<unsigned long long>(m_counters.assignments), static_cast<unsigned long long>(m_counters.unanswered));
+	resetCounters();
+}
+
+LobbyService::LoadKey LobbyService::makeLoadKey(LobbyHostId id, const LobbyHost& host)
+{
+	uint32_t fraction = static_cast<uint32_t>((static_cast<uint64_t>(host.load) << 16) / host.capacity);
+	return LoadKey(fraction, id);
+}
+
+void LobbyService::indexHost(LobbyHostId id, const LobbyHost& host)
+{
+	if (host.capacity > 0 && host.load < host.capacity)
+		m_freeHosts.insert(makeLoadKey(id, host));
+}
+
+void LobbyService::unindexHost(LobbyHostId id, const LobbyHost& host)
+{
+	if (host.capacity > 0 && host.load < host.capacity)
+		m_freeHosts.erase(makeLoadKey(id, host));
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <SFML/Network.hpp>
+
+#include "DatagramSocket.h"
+#include "MessageRouter.h"
+#include "NetProtocol.h"
+
+// Identifies a registered host by its endpoint: IPv4 address in the high bits, game port in the low 16
+using LobbyHostId = uint64_t;
+
+// A host as last reported in LOBBY_REGISTER, plus the guests sent to it since
+struct LobbyHost {
+	sf::IpAddress address = sf::IpAddress::Any;
+	unsigned short port = 0;
+	uint16_t capacity = 0;
+	uint16_t load = 0;			// reported sessions, plus assignments made after that report
+	uint32_t lastHeardMs = 0;
+	uint64_t assigned = 0;		// guests sent here in total
+};
+
+struct LobbyCounters {
+	uint64_t registrations = 0;	// LOBBY_REGISTERs handled
+	uint64_t requests = 0;		// LOBBY_FINDs handled
+	uint64_t assignments = 0;	// LOBBY_ASSIGNs sent
+	uint64_t unanswered = 0;	// LOBBY_FINDs that came while every host was full
+};
+
+/// <summary>
+/// @brief Matchmaking service: hosts register their capacity and load, guests are sent to the least loaded.
+///
+/// Hosts send LOBBY_REGISTER every LobbyHeartbeatMs (HostNetworkController does this once given a
+///  LobbyConfig) and are dropped after LobbyHostTimeoutMs without one. A guest's LOBBY_FIND is answered
+///  with a LOBBY_ASSIGN naming the host with the lowest load / capacity; that host's load is counted
+///  up straight away, so a burst of guests is spread out before the next report arrives. Hosts with
+///  a free session are kept ordered by load, so picking one costs O(log hosts).
+/// One socket, no game loop to protect, so it reads the socket directly and sleeps on it between datagrams.
+/// Example usage:
+///		LobbyService lobby;
+///		if (lobby.bind(DefaultLobbyPort))
+///			lobby.run();
+/// </summary>
+class LobbyService
+{
+public:
+	LobbyService();
+
+	/// <summary>
+	/// @brief Binds the lobby socket. Returns false if the port is unavailable.
+	/// </summary>
+	bool bind(unsigned short port);
+
+	/// <summary>
+	/// @brief Drains the socket, answers every LOBBY_FIND, records every LOBBY_REGISTER, drops silent hosts and flushes.
+	/// </summary>
+	void poll();
+
+	/// <summary>
+	/// @brief Waits on the socket and polls until stop(). Prints a summary every ReportIntervalMs.
+	/// </summary>
+	void run();
+
+	/// <summary>
+	/// @brief Asks run() to return. Safe to call from a signal handler.
+	/// </summary>
+	void stop() { m_running = false; }
+
+	size_t getHostCount() const { return m_hosts.size(); }
+	const std::unordered_map<LobbyHostId, LobbyHost>& getHosts() const { return m_hosts; }
+	const LobbyCounters& getCounters() const { return m_counters; }
+	void resetCounters() { m_counters = LobbyCounters(); }
+	DatagramIoCounters getIoCounters() const { return m_socket.getCounters(); }
+
+	static LobbyHostId makeHostId(const sf::IpAddress& address, unsigned short port);
+
+private:
+	static const uint32_t ExpiryCheckMs = 250;
+	static const uint32_t ReportIntervalMs = 10000;
+
+	void handleRegister(const Datagram& datagram);
+	void handleFind(const Datagram& datagram);
+	void expireHosts();
+	void report();
+
+	// ---- Free-host index: (load / capacity as 16.16 fixed point, host id), least loaded first ----
+	using LoadKey = std::pair<uint32_t, LobbyHostId>;
+	static LoadKey makeLoadKey(LobbyHostId id, const LobbyHost& host);
+	void indexHost(LobbyHostId id, const LobbyHost& host);
+	void unindexHost(LobbyHostId id, const LobbyHost& host);
+
+	DatagramSocket m_socket;
+	std::vector<Datagram> m_recvBatch;
+
+	std::unordered_map<LobbyHostId, LobbyHost> m_hosts;
+	std::set<LoadKey> m_freeHosts;	// only hosts with load < capacity
+
+	uint32_t m_lastExpiryMs{ 0 };
+	uint32_t m_lastReportMs{ 0 };
+	LobbyCounters m_counters;
+
+	std::atomic<bool> m_running{ false };
+};
@@ -0,0 +1,337 @@
+#include "PacketBenchmark.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+#include "DatagramSocket.h"
+#include "NetProtocol.h"
+#include "SnapshotCodec.h"
+
+namespace
+{
+	using BenchClock = std::chrono::steady_clock;
+
+	// Keeps the optimiser from discarding the work being timed
+	volatile uint32_t g_sink = 0;
+
+	double nsPerCall(BenchClock::time_point start, size_t iterations)
+	{
+		std::chrono::duration<double, std::nano> elapsed = BenchClock::now() - start;
+		return elapsed.count() / static_cast<double>(iterations);
+	}
+
+	void report(const char* name, size_t size, double encodeNs, double decodeNs)
+	{
+		std::printf("  %-14s %3zu B   encode %6.2f ns   decode %6.2f ns\n", name, size, encodeNs, decodeNs);
+	}
+
+	// Packets are encoded into, and decoded from, a ring of datagrams with fields varied per slot,
+	//  so nothing folds to a constant and no read waits on the write just before it
+	const size_t RingSize = 256;
+
+	template <typename Packet, typename Mutate, typename Checksum>
+	void benchPacket(const char* name, size_t iterations, Packet packet, Mutate mutate, Checksum checksum)
+	{
+		static Datagram ring[RingSize];
+		uint32_t sum = 0;
+
+		BenchClock::time_point start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			mutate(packet, static_cast<uint32_t>(i));
+			Datagram& datagram = ring[i % RingSize];
+			datagram.size = encodePacket(packet, datagram.data, sizeof(datagram.data));
+		}
+		double encodeNs = nsPerCall(start, iterations);
+
+		Packet decoded;
+		start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			const Datagram& datagram = ring[i % RingSize];
+			if (decodePacket(datagram.data, datagram.size, decoded))
+				sum += checksum(decoded);
+		}
+		double decodeNs = nsPerCall(start, iterations);
+
+		for (const Datagram& datagram : ring)
+			sum += static_cast<uint8_t>(datagram.data[datagram.size - 1]);
+		g_sink = g_sink + sum;
+		report(name, ring[0].size, encodeNs, decodeNs);
+	}
+
+	NetLogicStates makeState(uint32_t i)
+	{
+		NetLogicStates state;
+		state.seqNum = static_cast<uint16_t>(i);
+		state.tick = static_cast<uint16_t>(i);
+		state.inputAckTick = static_cast<uint16_t>(i - 3);
+		state.p1Y = 300.f + static_cast<float>(i % 64);
+		state.p2Y = 420.f - static_cast<float>(i % 32);
+		state.ballX = static_cast<float>(i % 1400);
+		state.ballY = static_cast<float>((i * 7) % 860);
+		state.ballVelX = (i & 1) ? 400.f : -400.f;
+		state.ballVelY = 250.f;
+		state.p1Score = 3;
+		state.p2Score = 5;
+		return state;
+	}
+
+	void benchSnapshots(size_t iterations)
+	{
+		SnapshotQuantization quantization;
+		SnapshotHistory history;
+		Datagram datagram;
+		uint32_t sum = 0;
+
+		// Full snapshots
+		BenchClock::time_point start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			NetLogicStates state = makeState(static_cast<uint32_t>(i));
+			SnapshotCodec::quantize(state, quantization);
+			datagram.size = SnapshotCodec::encode(state, nullptr, quantization, reinterpret_cast<uint8_t*>(datagram.data), sizeof(datagram.data));
+			sum += static_cast<uint8_t>(datagram.data[datagram.size - 1]);
+		}
+		double encodeNs = nsPerCall(start, iterations);
+
+		NetLogicStates decoded;
+		start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			if (SnapshotCodec::decode(reinterpret_cast<const uint8_t*>(datagram.data), datagram.size, history, quantization, decoded))
+				sum += decoded.tick;
+		}
+		report("STATE_UPDATE", datagram.size, encodeNs, nsPerCall(start, iterations));
+
+		// Deltas against the previous snapshot, as during a rally
+		NetLogicStates baseline = makeState(0);
+		SnapshotCodec::quantize(baseline, quantization);
+		history.store(baseline);
+		start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			NetLogicStates state = makeState(1);
+			state.ballX += static_cast<float>(i & 7);
+			SnapshotCodec::quantize(state, quantization);
+			datagram.size = SnapshotCodec::encode(state, &baseline, quantization, reinterpret_cast<uint8_t*>(datagram.data), sizeof(datagram.data));
+			sum += static_cast<uint8_t>(datagram.data[datagram.size - 1]);
+		}
+		encodeNs = nsPerCall(start, iterations);
+
+		start = BenchClock::now();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			if (SnapshotCodec::decode(reinterpret_cast<const uint8_t*>(datagram.data), datagram.size, history, quantization, decoded))
+				sum += decoded.tick;
+		}
+		report("STATE_DELTA", datagram.size, encodeNs, nsPerCall(start, iterations));
+
+		g_sink = g_sink + sum;
+	}
+
+	// ---- Snapshot round-trip self-check ----
+	const size_t RoundTripCases = 100000;
+
+	uint32_t randomBelow(std::mt19937& rng, uint32_t limit)
+	{
+		// mt19937 output is fixed by the standard; the distributions are not, so map it by hand
+		return static_cast<uint32_t>((static_cast<uint64_t>(rng()) * limit) >> 32);
+	}
+
+	// Anywhere in the range, both ends included now and then
+	float randomIn(std::mt19937& rng, const QuantizedRange& range)
+	{
+		uint32_t pick = rng();
+		if ((pick & 0xFF) == 0)
+			return range.min;
+		if ((pick & 0xFF) == 1)
+			return range.max;
+		return static_cast<float>(range.min + (pick / 4294967296.0) * (range.max - range.min));
+	}
+
+	NetLogicStates randomState(std::mt19937& rng, const SnapshotQuantization& quantization)
+	{
+		NetLogicStates state;
+		state.seqNum = static_cast<uint16_t>(rng());
+		state.tick = static_cast<uint16_t>(rng());
+		state.inputAckTick = static_cast<uint16_t>(rng());
+		state.p1Y = randomIn(rng, quantization.paddleY);
+		state.p2Y = randomIn(rng, quantization.paddleY);
+		state.ballX = randomIn(rng, quantization.ballX);
+		state.ballY = randomIn(rng, quantization.ballY);
+		state.ballVelX = randomIn(rng, quantization.ballVel);
+		state.ballVelY = randomIn(rng, quantization.ballVel);
+		state.p1Score = randomBelow(rng, 1u << quantization.scoreBits);
+		state.p2Score = randomBelow(rng, 1u << quantization.scoreBits);
+		return state;
+	}
+
+	// Worst |decoded - sent| seen for a field, and how often it exceeded half a quantization step
+	struct FieldError
+	{
+		const char* name;
+		QuantizedRange range;
+		float worst = 0.f;
+		size_t failures = 0;
+
+		FieldError(const char* fieldName, const QuantizedRange& fieldRange) : name(fieldName), range(fieldRange) {}
+
+		void check(float sent, float decoded)
+		{
+			float error = std::fabs(decoded - sent);
+			if (error > worst)
+				worst = error;
+			if (error > range.precision * 0.5f)
+				failures++;
+		}
+	};
+
+	bool sameHeader(const NetLogicStates& a, const NetLogicStates& b)
+	{
+		return a.seqNum == b.seqNum && a.tick == b.tick && a.inputAckTick == b.inputAckTick;
+	}
+
+	bool sameFields(const NetLogicStates& a, const NetLogicStates& b)
+	{
+		return a.p1Y == b.p1Y && a.p2Y == b.p2Y && a.ballX == b.ballX && a.ballY == b.ballY &&
+			a.ballVelX == b.ballVelX && a.ballVelY == b.ballVelY && a.p1Score == b.p1Score && a.p2Score == b.p2Score;
+	}
+
+	const char* verdict(size_t failures)
+	{
+		return failures == 0 ? "ok" : "FAILED";
+	}
+
+	// Encodes random states spread over every SnapshotQuantization range and decodes them back:
+	//  full snapshots must land within half a step of what was sent with an exact header, and
+	//  deltas must rebuild the quantized state from their baseline, or be refused once it is gone
+	void checkSnapshotRoundTrip()
+	{
+		SnapshotQuantization quantization;
+		SnapshotHistory history;
+		std::mt19937 rng(1);
+		uint8_t buffer[Datagram::MaxSize];
+
+		FieldError paddle("paddle Y", quantization.paddleY);
+		FieldError ballX("ball X", quantization.ballX);
+		FieldError ballY("ball Y", quantization.ballY);
+		FieldError velocity("ball velocity", quantization.ballVel);
+		size_t headerFailures = 0;
+		size_t scoreFailures = 0;
+		for (size_t i = 0; i < RoundTripCases; ++i)
+		{
+			NetLogicStates sent = randomState(rng, quantization);
+			NetLogicStates decoded;
+			size_t size = SnapshotCodec::encode(sent, nullptr, quantization, buffer, sizeof(buffer));
+			if (size == 0 || !SnapshotCodec::decode(buffer, size, history, quantization, decoded))
+			{
+				headerFailures++;
+				continue;
+			}
+
+			paddle.check(sent.p1Y, decoded.p1Y);
+			paddle.check(sent.p2Y, decoded.p2Y);
+			ballX.check(sent.ballX, decoded.ballX);
+			ballY.check(sent.ballY, decoded.ballY);
+			velocity.check(sent.ballVelX, decoded.ballVelX);
+			velocity.check(sent.ballVelY, decoded.ballVelY);
+			if (decoded.messageType != MessageTypes::STATE_UPDATE || !sameHeader(sent, decoded))
+				headerFailures++;
+			if (decoded.p1Score != sent.p1Score || decoded.p2Score != sent.p2Score)
+				scoreFailures++;
+		}
+
+		size_t deltaFailures = 0;
+		size_t staleAccepted = 0;
+		for (size_t i = 0; i < RoundTripCases; ++i)
+		{
+			// The baseline both ends hold is the quantized one
+			NetLogicStates baseline = randomState(rng, quantization);
+			SnapshotCodec::quantize(baseline, quantization);
+			history.store(baseline);
+
+			// A newer snapshot up to 31 sequence numbers on, with any subset of the fields changed
+			NetLogicStates sent = baseline;
+			NetLogicStates other = randomState(rng, quantization);
+			uint32_t changed = rng();
+			sent.seqNum = static_cast<uint16_t>(baseline.seqNum + 1 + randomBelow(rng, SnapshotHistorySize - 1));
+			sent.tick = other.tick;
+			sent.inputAckTick = other.inputAckTick;
+			if (changed & FIELD_P1_Y) sent.p1Y = other.p1Y;
+			if (changed & FIELD_P2_Y) sent.p2Y = other.p2Y;
+			if (changed & FIELD_BALL_X) sent.ballX = other.ballX;
+			if (changed & FIELD_BALL_Y) sent.ballY = other.ballY;
+			if (changed & FIELD_BALL_VEL_X) sent.ballVelX = other.ballVelX;
+			if (changed & FIELD_BALL_VEL_Y) sent.ballVelY = other.ballVelY;
+			if (changed & FIELD_P1_SCORE) sent.p1Score = other.p1Score;
+			if (changed & FIELD_P2_SCORE) sent.p2Score = other.p2Score;
+
+			NetLogicStates expected = sent;
+			SnapshotCodec::quantize(expected, quantization);
+
+			NetLogicStates decoded;
+			size_t size = SnapshotCodec::encode(sent, &baseline, quantization, buffer, sizeof(buffer));
+			if (size == 0 || !SnapshotCodec::decode(buffer, size, history, quantization, decoded) ||
+				decoded.messageType != MessageTypes::STATE_DELTA || !sameHeader(expected, decoded) || !sameFields(expected, decoded))
+			{
+				deltaFailures++;
+			}
+
+			// Overwrite the baseline's history slot with a later snapshot: the same delta must now be refused
+			NetLogicStates overwrite = baseline;
+			overwrite.seqNum = static_cast<uint16_t>(baseline.seqNum + SnapshotHistorySize);
+			history.store(overwrite);
+			if (size != 0 && SnapshotCodec::decode(buffer, size, history, quantization, decoded))
+				staleAccepted++;
+		}
+
+		std::printf("Snapshot round trip, %zu random states per check:\n", RoundTripCases);
+		for (const FieldError* field : { &paddle, &ballX, &ballY, &velocity })
+		{
+			std::printf("  %-14s max error %.4f (limit %.4f)   %s\n", field->name, field->worst,
+				field->range.precision * 0.5f, verdict(field->failures));
+		}
+		std::printf("  %-14s seq, tick and input ack tick exact   %s\n", "full header", verdict(headerFailures));
+		std::printf("  %-14s exact   %s\n", "scores", verdict(scoreFailures));
+		std::printf("  %-14s quantized state rebuilt from its baseline   %s\n", "delta", verdict(deltaFailures));
+		std::printf("  %-14s refused once its baseline is overwritten   %s\n", "stale delta", verdict(staleAccepted));
+	}
+}
+
+void runPacketBenchmark(size_t iterations)
+{
+	if (iterations == 0)
+		iterations = 1;
+	std::printf("Packet encode/decode, %zu iterations each:\n", iterations);
+
+	benchPacket("HOST_HERE", iterations, HostHerePacket(),
+		[](HostHerePacket& p, uint32_t i) { p.gamePort = static_cast<uint16_t>(i); },
+		[](const HostHerePacket& p) { return static_cast<uint32_t>(p.gamePort); });
+
+	benchPacket("HELLO", iterations, HelloPacket(),
+		[](HelloPacket& p, uint32_t i) { p.guestPort = static_cast<uint16_t>(i); },
+		[](const HelloPacket& p) { return static_cast<uint32_t>(p.guestPort); });
+
+	benchPacket("GUEST_INPUT", iterations, GuestInputPacket(),
+		[](GuestInputPacket& p, uint32_t i) { p.tick = static_cast<uint16_t>(i); p.input = static_cast<int8_t>(i % 3) - 1; p.previousCount = GuestInputPacket::MaxPrevious; p.previous = i * 2654435761u; p.ackSeq = p.tick - 4; p.viewTick = p.tick - 6; },
+		[](const GuestInputPacket& p) { return static_cast<uint32_t>(p.tick + p.input + p.previous + p.ackSeq + p.viewTick); });
+
+	benchPacket("PING", iterations, PingPacket(),
+		[](PingPacket& p, uint32_t i) { p.timeMs = i; },
+		[](const PingPacket& p) { return p.timeMs; });
+
+	benchPacket("PONG", iterations, PongPacket(),
+		[](PongPacket& p, uint32_t i) { p.echoMs = i; p.timeMs = i * 3; },
+		[](const PongPacket& p) { return p.echoMs + p.timeMs; });
+
+	benchPacket("SCORE_EVENT", iterations, ScoreEvent(),
+		[](ScoreEvent& p, uint32_t i) { p.tick = static_cast<uint16_t>(i); p.leftScore = i & 7; p.rightScore = (i >> 3) & 7; p.gameOver = (i & 63) == 0; },
+		[](const ScoreEvent& p) { return static_cast<uint32_t>(p.tick + p.leftScore + p.rightScore + p.gameOver); });
+
+	benchSnapshots(iterations);
+
+	checkSnapshotRoundTrip();
+}
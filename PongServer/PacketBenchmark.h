@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+/// <summary>
+/// @brief Times encode and decode of every message type and prints ns per message.
+///
+/// Each packet is encoded into a Datagram the way the controllers do it (straight into the
+///  send slot) and decoded back from it; STATE_UPDATE / STATE_DELTA go through SnapshotCodec.
+/// Then checks the snapshot codec on random states spread over every SnapshotQuantization range:
+///  full snapshots must decode within half a step of what was sent, with seq, tick and scores
+///  exact, and deltas must rebuild the quantized state from their baseline (or be refused once
+///  the baseline has been overwritten). Each check prints ok or FAILED.
+/// Run with PongServer --bench-packets [ITERATIONS].
+/// </summary>
+void runPacketBenchmark(size_t iterations);
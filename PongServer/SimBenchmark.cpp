@@ -0,0 +1,89 @@
+#include "SimBenchmark.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "PongSim.h"
+
+namespace
+{
+	using BenchClock = std::chrono::steady_clock;
+
+	// Keeps the optimiser from discarding the work being timed
+	volatile uint64_t g_sink = 0;
+
+	// Inputs are read from a seeded table, so generating them isn't timed and every run sees the same ones
+	const size_t InputTableSize = 4096;
+
+	std::vector<PongSimInputs> makeInputs()
+	{
+		std::mt19937 rng(1);
+		std::vector<PongSimInputs> inputs(InputTableSize);
+		for (PongSimInputs& input : inputs)
+		{
+			// mt19937 output is fixed by the standard; the distributions are not, so map it by hand
+			input.left = static_cast<int8_t>(static_cast<int>(rng() % 3) - 1);
+			input.right = static_cast<int8_t>(static_cast<int>(rng() % 3) - 1);
+		}
+		return inputs;
+	}
+
+	// Steps every match stepsPerMatch times from a fresh reset and returns a checksum over the end states
+	uint64_t runMatches(size_t matchCount, size_t stepsPerMatch, const std::vector<PongSimInputs>& inputs,
+		double& nsPerStep, uint64_t& matchesFinished)
+	{
+		const float dt = 1.f / PongSim::TickRate;
+		std::vector<PongSimState> sims(matchCount);
+		for (PongSimState& sim : sims)
+			PongSim::reset(sim);
+
+		matchesFinished = 0;
+		BenchClock::time_point start = BenchClock::now();
+		for (size_t step = 0; step < stepsPerMatch; ++step)
+		{
+			for (size_t i = 0; i < matchCount; ++i)
+			{
+				PongSimState& sim = sims[i];
+				PongSim::step(sim, inputs[(step + i * 7) % InputTableSize], dt);
+				if (sim.gameOver)
+				{
+					PongSim::reset(sim);
+					matchesFinished++;
+				}
+			}
+		}
+		std::chrono::duration<double, std::nano> elapsed = BenchClock::now() - start;
+		nsPerStep = elapsed.count() / static_cast<double>(matchCount * stepsPerMatch);
+
+		uint64_t checksum = 0;
+		for (const PongSimState& sim : sims)
+			checksum = checksum * 31 + PongSim::checksum(sim);
+		return checksum;
+	}
+}
+
+void runSimBenchmark(size_t steps)
+{
+	const size_t matchCounts[] = { 1, 1000, 100000 };
+	std::vector<PongSimInputs> inputs = makeInputs();
+
+	std::printf("PongSim::step, %zu match steps per case at %.0f Hz, seeded random inputs:\n", steps, PongSim::TickRate);
+	for (size_t matchCount : matchCounts)
+	{
+		size_t stepsPerMatch = steps / matchCount > 0 ? steps / matchCount : 1;
+
+		double firstNs = 0.0;
+		double secondNs = 0.0;
+		uint64_t finished = 0;
+		uint64_t first = runMatches(matchCount, stepsPerMatch, inputs, firstNs, finished);
+		uint64_t second = runMatches(matchCount, stepsPerMatch, inputs, secondNs, finished);
+		g_sink = g_sink + first;
+
+		double nsPerStep = firstNs < secondNs ? firstNs : secondNs;
+		std::printf("  %6zu matches x %8zu steps   %6.2f ns/step   %6.1f M steps/s   %8llu matches finished   checksum %016llx %s\n",
+			matchCount, stepsPerMatch, nsPerStep, 1000.0 / nsPerStep, static_cast<unsigned long long>(finished),
+			static_cast<unsigned long long>(first), first == second ? "(repeatable)" : "(MISMATCH between runs)");
+	}
+}
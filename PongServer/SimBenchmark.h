@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+
+/// <summary>
+/// @brief Times PongSim::step and checks that it is deterministic.
+///
+/// Steps 1, 1,000 and 100,000 independent matches (the last one well past the L2 cache) with
+///  seeded inputs, restarting each match when it ends, and prints ns per match step. Every case
+///  runs twice from the same start and must end on the same PongSim::checksum; the checksum is
+///  printed so builds from different compilers or machines can be compared too.
+/// Run with PongServer --bench-sim [STEPS].
+/// </summary>
+void runSimBenchmark(size_t steps);
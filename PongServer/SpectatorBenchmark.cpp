@@ -0,0 +1,257 @@
+#include "SpectatorBenchmark.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <SFML/System.hpp>
+
+#include "AsyncLogger.h"
+#include "GuestNetworkController.h"
+#include "HostNetworkController.h"
+
+namespace
+{
+	const unsigned short BenchPort = 54091;
+	const unsigned short GroupPort = 54092;
+	const int MeasuredTicks = 300;
+	const int MaxWarmupTicks = 600;
+	const sf::Time JoinTimeout = sf::seconds(20.f);
+
+	enum class FanoutMode
+	{
+		PerRecipient,	// every viewer is a player session with its own sendStateUpdate
+		EncodeOnce,		// spectators, one encode, a unicast copy each
+		Multicast		// spectators on the group, one encode, one copy
+	};
+
+	struct FanoutCase
+	{
+		const char* name;
+		FanoutMode mode;
+	};
+
+	struct Viewer
+	{
+		GuestNetworkController net;
+		bool sentHello = false;
+		bool connected = false;
+		uint64_t snapshots = 0;
+	};
+
+	// A rally: the ball moves every tick, the paddles now and then
+	NetLogicStates makeState(uint32_t tick)
+	{
+		NetLogicStates state;
+		state.messageType = MessageTypes::STATE_UPDATE;
+		state.tick = static_cast<uint16_t>(tick);
+		state.p1Y = 300.f + static_cast<float>(tick % 64);
+		state.p2Y = 420.f - static_cast<float>(tick % 32);
+		state.ballX = static_cast<float>((tick * 7) % 1400);
+		state.ballY = static_cast<float>((tick * 5) % 860);
+		state.ballVelX = 400.f;
+		state.ballVelY = 250.f;
+		state.p1Score = 3;
+		state.p2Score = 5;
+		return state;
+	}
+
+	void drainViewers(std::vector<std::unique_ptr<Viewer>>& viewers)
+	{
+		NetLogicStates state;
+		sf::Time arrival;
+		for (auto& viewer : viewers)
+		{
+			viewer->net.poll();
+			while (viewer->net.recieveStateUpdate(state, arrival))
+				viewer->snapshots++;
+			viewer->net.pingHostIfDue();
+		}
+	}
+
+	// Discovery and handshake for every viewer, the same steps as Game::lookingForHost.
+	// A burst of hundreds of FIND_HOSTs overflows the host's receive buffer; the backoff retries the lost ones
+	bool joinAll(HostNetworkController& host, std::vector<std::unique_ptr<Viewer>>& viewers, std::vector<SessionId>& sessions)
+	{
+		sf::Clock clock;
+		size_t connected = 0;
+		while (connected < viewers.size() && clock.getElapsedTime() < JoinTimeout)
+		{
+			host.poll();
+			SessionId id;
+			while (host.acceptNewSession(id))
+				sessions.push_back(id);
+
+			for (auto& viewer : viewers)
+			{
+				if (viewer->connected)
+					continue;
+				GuestNetworkController& net = viewer->net;
+				net.poll();
+				sf::IpAddress address(sf::IpAddress::Any);
+				unsigned short port = 0;
+				if (!viewer->sentHello)
+				{
+					net.sendFindHostIfDue(BenchPort);
+					if (net.recieveHostHere(address, port))
+					{
+						net.sendHello();
+						viewer->sentHello = true;
+					}
+				}
+				else if (net.recieveHelloAck())
+				{
+					viewer->connected = true;
+					connected++;
+				}
+				else if (!net.retryHelloIfDue())
+				{
+					viewer->sentHello = false;
+					net.restartDiscovery();
+				}
+			}
+			sf::sleep(sf::milliseconds(1));
+		}
+		return connected == viewers.size();
+	}
+
+	void runCase(size_t viewerCount, const FanoutCase& fanout)
+	{
+		const sf::Time timePerTick = sf::seconds(1.f / PongSim::TickRate);
+
+		HostNetworkController host;
+		host.setIoThread(false);
+		host.setBeaconInterval(0);
+		host.setMaxSessions(viewerCount);
+		host.setMaxSpectators(viewerCount);
+		SpectatorMulticastConfig group;
+		if (fanout.mode == FanoutMode::Multicast)
+			SpectatorMulticastConfig::parse("239.255.42.99:" + std::to_string(GroupPort), group);
+		host.setSpectatorMulticast(group);
+		if (!host.bind(BenchPort))
+		{
+			std::printf("  could not bind the benchmark host on port %u\n", BenchPort);
+			return;
+		}
+
+		std::vector<std::unique_ptr<Viewer>> viewers;
+		for (size_t i = 0; i < viewerCount; ++i)
+		{
+			std::unique_ptr<Viewer> viewer(new Viewer());
+			viewer->net.setIoThread(false);
+			viewer->net.setSpectator(fanout.mode != FanoutMode::PerRecipient);
+			if (!viewer->net.bind(0))
+			{
+				std::printf("  could not bind viewer %zu\n", i);
+				return;
+			}
+			viewers.push_back(std::move(viewer));
+		}
+
+		std::vector<SessionId> sessions;
+		if (!joinAll(host, viewers, sessions))
+		{
+			std::printf("  %5zu viewers  %-22s not every viewer joined\n", viewerCount, fanout.name);
+			return;
+		}
+
+		sf::Clock clock;
+		sf::Time hostTime = sf::Time::Zero;
+		uint32_t tick = 0;
+		int measured = -1;
+		int warmup = 0;
+		while (measured < MeasuredTicks)
+		{
+			sf::Time tickStart = clock.getElapsedTime();
+
+			// ---- The host's part of one tick: drain, snapshot, fan out, send ----
+			host.poll();
+			NetLogicStates state = makeState(tick++);
+			if (fanout.mode == FanoutMode::PerRecipient)
+			{
+				for (SessionId id : sessions)
+				{
+					NetLogicStates copy = state;
+					host.sendStateUpdate(id, copy);
+				}
+			}
+			else
+			{
+				host.sendSpectatorState(state);
+			}
+			host.flush();
+			if (measured >= 0)
+			{
+				hostTime += clock.getElapsedTime() - tickStart;
+				measured++;
+			}
+
+			drainViewers(viewers);
+
+			// Start measuring once every multicast spectator has told the host it listens there
+			bool settled = fanout.mode != FanoutMode::Multicast || host.getMulticastSpectatorCount() == viewerCount;
+			if (measured < 0 && ((++warmup >= PongSim::TickRate && settled) || warmup >= MaxWarmupTicks))
+			{
+				measured = 0;
+				host.resetIoCounters();
+				for (auto& viewer : viewers)
+					viewer->snapshots = 0;
+			}
+
+			sf::Time elapsed = clock.getElapsedTime() - tickStart;
+			if (elapsed < timePerTick)
+				sf::sleep(timePerTick - elapsed);
+		}
+
+		// Pick up the last tick's datagrams
+		sf::sleep(sf::milliseconds(20));
+		drainViewers(viewers);
+
+		uint64_t encodes;
+		uint64_t datagrams;
+		uint64_t bytes;
+		if (fanout.mode == FanoutMode::PerRecipient)
+		{
+			const StateBandwidthCounters& state = host.getStateBandwidth();
+			encodes = state.snapshots;
+			datagrams = state.snapshots;
+			bytes = state.bytesSent;
+		}
+		else
+		{
+			const SpectatorFanoutCounters& counters = host.getSpectatorFanout();
+			encodes = counters.snapshots;
+			datagrams = counters.datagrams;
+			bytes = counters.bytesSent;
+		}
+
+		uint64_t delivered = 0;
+		for (const auto& viewer : viewers)
+			delivered += viewer->snapshots;
+
+		std::printf("  %5zu viewers  %-22s host %8.1f us/tick  %6.1f encodes/tick  %6.1f datagrams/tick  %7.0f state B/tick  delivered %5.1f%%\n",
+			viewerCount, fanout.name, hostTime.asMicroseconds() / static_cast<double>(MeasuredTicks),
+			static_cast<double>(encodes) / MeasuredTicks, static_cast<double>(datagrams) / MeasuredTicks,
+			static_cast<double>(bytes) / MeasuredTicks,
+			100.0 * delivered / (static_cast<double>(viewerCount) * MeasuredTicks));
+	}
+}
+
+void runSpectatorBenchmark()
+{
+	AsyncLogger::instance().setLevel(LogLevel::Warning);
+
+	const size_t viewerCounts[] = { 1, 50, 500 };
+	const FanoutCase cases[] = {
+		{ "session per viewer", FanoutMode::PerRecipient },
+		{ "spectators, unicast", FanoutMode::EncodeOnce },
+		{ "spectators, multicast", FanoutMode::Multicast }
+	};
+
+	std::printf("Spectator fan-out over loopback, %d ticks at %.0f Hz (host time = poll + snapshots + flush):\n",
+		MeasuredTicks, PongSim::TickRate);
+	for (size_t viewerCount : viewerCounts)
+	{
+		for (const FanoutCase& fanout : cases)
+			runCase(viewerCount, fanout);
+	}
+}
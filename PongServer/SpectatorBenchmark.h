@@ -0,0 +1,13 @@
+#pragma once
+
+/// <summary>
+/// @brief Measures what spectators cost the host: time and bytes per tick at 1, 50 and 500 viewers.
+///
+/// A host on BenchPort and every viewer run in this process over loopback, all with their
+///  sockets on this thread, so the host's share is just its poll + send + flush. Three ways
+///  of feeding the viewers are compared: each one as a player session with its own
+///  sendStateUpdate (the only way before spectators), spectators sharing one encode with a
+///  unicast copy each, and spectators on a multicast group with a single copy per tick.
+/// Run with PongServer --bench-spectators.
+/// </summary>
+void runSpectatorBenchmark();
@@ -0,0 +1,266 @@
+#ifdef _DEBUG
+#pragma comment(lib,"sfml-system-d.lib")
+#pragma comment(lib,"sfml-network-d.lib")
+#else
+#pragma comment(lib,"sfml-system.lib")
+#pragma comment(lib,"sfml-network.lib")
+#endif
+
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "AsyncLogger.h"
+#include "ConnectBenchmark.h"
+#include "HeadlessHost.h"
+#include "IoBenchmark.h"
+#include "LobbyBenchmark.h"
+#include "LobbyService.h"
+#include "LoadTest.h"
+#include "PacketBenchmark.h"
+#include "SimBenchmark.h"
+#include "SpectatorBenchmark.h"
+
+namespace
+{
+	HeadlessHost* g_host = nullptr;
+	LobbyService* g_lobby = nullptr;
+
+	void onSignal(int)
+	{
+		if (g_host)
+			g_host->stop();
+		if (g_lobby)
+			g_lobby->stop();
+	}
+
+	int runLobbyService(unsigned short port)
+	{
+		LobbyService lobby;
+		if (!lobby.bind(port))
+			return 1;
+
+		g_lobby = &lobby;
+		std::signal(SIGINT, onSignal);
+		std::signal(SIGTERM, onSignal);
+
+		lobby.run();
+		return 0;
+	}
+
+	bool parseLogLevel(const char* name, LogLevel& out)
+	{
+		if (std::strcmp(name, "debug") == 0) out = LogLevel::Debug;
+		else if (std::strcmp(name, "info") == 0) out = LogLevel::Info;
+		else if (std::strcmp(name, "warn") == 0) out = LogLevel::Warning;
+		else if (std::strcmp(name, "error") == 0) out = LogLevel::Error;
+		else return false;
+		return true;
+	}
+}
+
+/// <summary>
+/// @brief Entry point for the dedicated (headless) host.
+///
+/// Usage: PongServer [--port N] [--tick-rate HZ] [--snapshot-rate SPEC] [--max-matches N] [--max-spectators N] [--spectator-group ADDR:PORT]
+///		[--lobby ADDR[:PORT]] [--stats-csv FILE] [--log-level LEVEL] [--no-io-thread] [--no-batched-io] [--netem SPEC]
+///		[--bench-packets [N]] [--bench-connect [N]] [--bench-spectators] [--bench-lobby] [--bench-sim [N]] [--bench-io]
+///	   PongServer --lobby-service [PORT] [--log-level LEVEL]
+///	   PongServer --load-test N [--load-seconds S] [--load-threads T] [--load-input track|sweep] [--load-external] [--port N]
+/// --tick-rate is rounded to whole Hz; guests learn it from HELLO_ACK and step at it too.
+/// --lobby-service runs the matchmaking lobby on PORT (default 54100) instead of a host.
+/// --lobby registers this host with a lobby service and overrides PONG_LOBBY.
+/// --load-test runs N bot guests against an in-process host (or, with --load-external, the host on --port),
+///  prints per-bot snapshot rate, loss and latency percentiles and the host's CPU, and exits.
+/// --bench-lobby measures lobby assignments/sec and connect time with 100, 250 and 500 hosts, and exits.
+/// --bench-sim [N] times PongSim::step over N match steps per case, checks it repeats bit for bit, and exits.
+/// --bench-packets [N] times encode/decode of every message type, checks the snapshot round trip, and exits.
+/// --bench-connect [N] times discovery + handshake over loopback, N trials per case, and exits.
+/// --bench-spectators measures host time and bytes per tick at 1, 50 and 500 loopback spectators, and exits.
+/// --bench-io measures host packets/sec and socket calls per tick at 1, 10 and 100 loopback guests on each
+///  socket backend, and exits. --no-batched-io makes the host use one socket call per datagram.
+/// --spectator-group multicasts spectator snapshots to an IPv4 group and overrides PONG_SPECTATOR_GROUP.
+/// --snapshot-rate is "HZ" or "adaptive[:MIN-MAX]" and overrides PONG_SNAPSHOT_RATE (default: every tick).
+/// --netem takes a NetConditioner spec (e.g. "delay=40,jitter=10,loss=2") and overrides PONG_NETEM.
+/// Only the System and Network SFML modules are linked; no window or assets are needed.
+/// </summary>
+int main(int argc, char* argv[])
+{
+	unsigned short port = 54000;
+	double tickRate = 60.0;
+	size_t maxMatches = 256;
+	const char* statsCsv = nullptr;
+	LogLevel logLevel = LogLevel::Info;
+	bool ioThread = true;
+	bool batchedIo = true;
+	NetConditionerConfig conditioner;
+	bool hasConditioner = false;
+	SnapshotRateConfig snapshotRate;
+	bool hasSnapshotRate = false;
+	size_t maxSpectators = HostNetworkController::DefaultMaxSpectators;
+	SpectatorMulticastConfig spectatorGroup;
+	bool hasSpectatorGroup = false;
+	LobbyConfig lobby;
+	bool hasLobby = false;
+	bool lobbyService = false;
+	unsigned short lobbyServicePort = DefaultLobbyPort;
+	LoadTestConfig loadTest;
+	bool runLoad = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--bench-packets") == 0)
+		{
+			size_t iterations = 10000000;
+			if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+				iterations = static_cast<size_t>(std::atoi(argv[i + 1]));
+			runPacketBenchmark(iterations);
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--bench-sim") == 0)
+		{
+			size_t steps = 10000000;
+			if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+				steps = static_cast<size_t>(std::atoi(argv[i + 1]));
+			runSimBenchmark(steps);
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--bench-connect") == 0)
+		{
+			size_t trials = 50;
+			if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+				trials = static_cast<size_t>(std::atoi(argv[i + 1]));
+			runConnectBenchmark(trials);
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--bench-spectators") == 0)
+		{
+			runSpectatorBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--bench-lobby") == 0)
+		{
+			runLobbyBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--bench-io") == 0)
+		{
+			runIoBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(argv[i], "--load-test") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+		{
+			runLoad = true;
+			loadTest.bots = static_cast<size_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--load-seconds") == 0 && i + 1 < argc && std::atof(argv[i + 1]) > 0.0)
+			loadTest.seconds = static_cast<float>(std::atof(argv[++i]));
+		else if (std::strcmp(argv[i], "--load-threads") == 0 && i + 1 < argc)
+			loadTest.threads = static_cast<size_t>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--load-input") == 0 && i + 1 < argc && std::strcmp(argv[i + 1], "track") == 0)
+		{
+			loadTest.input = BotInputMode::Track;
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--load-input") == 0 && i + 1 < argc && std::strcmp(argv[i + 1], "sweep") == 0)
+		{
+			loadTest.input = BotInputMode::Sweep;
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--load-external") == 0)
+			loadTest.externalHost = true;
+		else if (std::strcmp(argv[i], "--lobby-service") == 0)
+		{
+			lobbyService = true;
+			if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+				lobbyServicePort = static_cast<unsigned short>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--lobby") == 0 && i + 1 < argc && LobbyConfig::parse(argv[i + 1], lobby))
+		{
+			hasLobby = true;
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+			port = static_cast<unsigned short>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+			tickRate = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--snapshot-rate") == 0 && i + 1 < argc && SnapshotRateConfig::parse(argv[i + 1], snapshotRate))
+		{
+			hasSnapshotRate = true;
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--max-matches") == 0 && i + 1 < argc)
+			maxMatches = static_cast<size_t>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--max-spectators") == 0 && i + 1 < argc)
+			maxSpectators = static_cast<size_t>(std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--spectator-group") == 0 && i + 1 < argc && SpectatorMulticastConfig::parse(argv[i + 1], spectatorGroup))
+		{
+			hasSpectatorGroup = true;
+			++i;
+		}
+		else if (std::strcmp(argv[i], "--stats-csv") == 0 && i + 1 < argc)
+			statsCsv = argv[++i];
+		else if (std::strcmp(argv[i], "--log-level") == 0 && i + 1 < argc && parseLogLevel(argv[i + 1], logLevel))
+			++i;
+		else if (std::strcmp(argv[i], "--no-io-thread") == 0)
+			ioThread = false;
+		else if (std::strcmp(argv[i], "--no-batched-io") == 0)
+			batchedIo = false;
+		else if (std::strcmp(argv[i], "--netem") == 0 && i + 1 < argc && NetConditionerConfig::parse(argv[i + 1], conditioner))
+		{
+			hasConditioner = true;
+			++i;
+		}
+		else
+		{
+			std::cout << "Usage: " << argv[0] << " [--port N] [--tick-rate HZ] [--snapshot-rate HZ|adaptive[:MIN-MAX]] [--max-matches N]"
+				<< " [--max-spectators N] [--spectator-group ADDR:PORT] [--lobby ADDR[:PORT]] [--stats-csv FILE]"
+				<< " [--log-level debug|info|warn|error] [--no-io-thread] [--no-batched-io] [--lobby-service [PORT]]"
+				<< " [--bench-packets [N]] [--bench-connect [N]] [--bench-spectators] [--bench-lobby] [--bench-sim [N]] [--bench-io]"
+				<< " [--load-test N [--load-seconds S] [--load-threads T] [--load-input track|sweep] [--load-external]]"
+				<< " [--netem delay=MS,jitter=MS,loss=PCT,burst-enter=PCT,burst-exit=PCT,dup=PCT,reorder=PCT,seed=N]" << std::endl;
+			return 1;
+		}
+	}
+	// Guests are told the rate in whole Hz
+	tickRate = std::round(tickRate);
+	if (tickRate <= 0.0)
+		tickRate = 60.0;
+	AsyncLogger::instance().setLevel(logLevel);
+	if (lobbyService)
+		return runLobbyService(lobbyServicePort);
+	if (runLoad)
+	{
+		loadTest.port = port;
+		runLoadTest(loadTest);
+		return 0;
+	}
+
+	HeadlessHost host(port, tickRate, maxMatches);
+	if (!ioThread)
+		host.disableIoThread();
+	if (!batchedIo)
+		host.disableBatchedIo();
+	if (hasConditioner)
+		host.setNetConditioner(conditioner);
+	if (hasSnapshotRate)
+		host.setSnapshotRate(snapshotRate);
+	host.setMaxSpectators(maxSpectators);
+	if (hasSpectatorGroup)
+		host.setSpectatorMulticast(spectatorGroup);
+	if (hasLobby)
+		host.setLobby(lobby);
+	if (!host.start())
+		return 1;
+	if (statsCsv && !host.openStatsCsv(statsCsv))
+		return 1;
+
+	g_host = &host;
+	std::signal(SIGINT, onSignal);
+	std::signal(SIGTERM, onSignal);
+
+	host.run();
+	return 0;
+}